@@ -0,0 +1,126 @@
+#!/bin/bash
+#
+# VASM		VARCem Multi-Target Macro Assembler.
+#		A simple table-driven assembler for several 8-bit target
+#		devices, like the 6502, 6800, 80x, Signetics 2650 and the
+#		SC/MP processor series. The code is originally based on
+#		the "asm6502" project, but has been rewritten since.
+#
+#		Run the benchmark scenarios. For each of them, a source is
+#		generated (see gen.sh) and assembled, and we report the
+#		number of source lines and the output bytes per second of
+#		user+system time, and the peak memory (RSS) used.
+#
+#		The peak RSS comes from GNU or BSD time(1) if we have it,
+#		and otherwise from /proc (in a separate run, so polling it
+#		does not add to the time.)
+#
+#		Usage: bench/bench.sh [vasm] [scale] [scenario ...]
+#
+# Version:	@(#)bench.sh	1.0.1	2026/10/18
+#
+# Author:	Fred N. van Kempen, <waltje@varcem.com>
+#
+#		Copyright 2026 Fred N. van Kempen.
+#
+
+VASM=${1:-src/vasm}
+SCALE=${2:-1}
+shift $(($# < 2 ? $# : 2))
+SCENARIOS=${*:-labels include macro repeat blob cond ins8060 scn2650}
+BENCH=`dirname $0`
+TMP=${TMPDIR:-/tmp}/vasm-bench.$$
+
+trap 'rm -rf $TMP $TMP.time' 0 1 2 15
+
+# We run the assembler from the directory of the source.
+case $VASM in
+/*)	;;
+*)	VASM=`pwd`/$VASM ;;
+esac
+if [ ! -x $VASM ]; then
+	echo "$0: no assembler at $VASM" >&2
+	exit 1
+fi
+
+# See which kind of time(1) we have, if any.
+TIMER=
+if /usr/bin/time -f "%M" true >/dev/null 2>&1; then
+	TIMER=gnu
+elif /usr/bin/time -l true >/dev/null 2>&1; then
+	TIMER=bsd
+fi
+
+# Run the assembler, and report "seconds peak-KB" (or "seconds -".)
+run() {
+	local pid rss key val unit
+
+	case $TIMER in
+	gnu)
+		/usr/bin/time -f "%U %S %M %x" -o $TMP.time "$@" >/dev/null 2>&1
+		awk '{ if ($4 != 0) print "failed"; else printf("%.3f %i\n", $1 + $2, $3) }' $TMP.time
+		return
+		;;
+
+	bsd)
+		/usr/bin/time -l "$@" >/dev/null 2>$TMP.time || {
+			echo failed
+			return
+		}
+		# Note that BSD reports the RSS in bytes.
+		awk '/ real / { t = $3 + $5 }
+		     /maximum resident/ { m = $1 / 1024 }
+		     END { printf("%.3f %i\n", t, m) }' $TMP.time
+		return
+		;;
+	esac
+
+	TIMEFORMAT="%3U %3S"
+	{ time "$@" >/dev/null 2>&1 ; } 2>$TMP.time || {
+		echo failed
+		return
+	}
+
+	rss=-
+	if [ -d /proc/self ]; then
+		"$@" >/dev/null 2>&1 &
+		pid=$!
+		while [ -r /proc/$pid/status ]; do
+			while read key val unit; do
+				[ "$key" = "VmHWM:" ] && rss=$val
+			done </proc/$pid/status 2>/dev/null
+			sleep 0.01
+		done
+		wait $pid
+	fi
+	awk -v m=$rss '{ printf("%.3f %s\n", $1 + $2, m) }' $TMP.time
+}
+
+printf "%-10s %-8s %8s %9s %8s %10s %11s %9s\n" \
+	Scenario CPU Lines Bytes Seconds Lines/sec Bytes/sec "Peak KB"
+
+for s in $SCENARIOS; do
+	rm -rf $TMP
+	bash $BENCH/gen.sh $s $TMP $SCALE || exit 1
+
+	case $s in
+	ins8060|scn2650)	cpu=$s ;;
+	*)			cpu=6502 ;;
+	esac
+
+	lines=`cat $TMP/*.asm | wc -l`
+	res=`cd $TMP && run $VASM -q -o out.bin main.asm`
+	if [ "$res" = "failed" ]; then
+		printf "%-10s %-8s %8i  FAILED\n" $s $cpu $lines
+		continue
+	fi
+	bytes=`wc -c <$TMP/out.bin`
+
+	echo "$s $cpu $lines $bytes $res" | awk '{
+		t = ($5 > 0) ? $5 : 0.001
+		printf("%-10s %-8s %8i %9i %8.3f %10i %11i %9s\n",
+		       $1, $2, $3, $4, $5, $3 / t, $4 / t, $6)
+	}'
+done
+
+exit 0
@@ -0,0 +1,210 @@
+#!/bin/bash
+#
+# VASM		VARCem Multi-Target Macro Assembler.
+#		A simple table-driven assembler for several 8-bit target
+#		devices, like the 6502, 6800, 80x, Signetics 2650 and the
+#		SC/MP processor series. The code is originally based on
+#		the "asm6502" project, but has been rewritten since.
+#
+#		Generate a synthetic source for one of the benchmarks. The
+#		main file is always main.asm in the given directory; some
+#		of the scenarios add include files or binary blobs to it,
+#		so the assembler should be run from that directory. The
+#		scale multiplies the size of the source.
+#
+#		Note that awk does not do hex constants, so all of these
+#		are in decimal here.
+#
+#		Scenarios:
+#
+#		  labels	many labels, referenced back and forth (6502)
+#		  include	a tree of include files (6502)
+#		  macro		macro definitions and many expansions (6502)
+#		  repeat	large tables made with .repeat (6502)
+#		  blob		big binary files, using .blob (6502)
+#		  cond		long .if/.else/.endif blocks (6502)
+#		  ins8060	straight code for the SC/MP
+#		  scn2650	straight code for the Signetics 2650
+#
+#		Usage: bench/gen.sh scenario dir [scale]
+#
+# Version:	@(#)gen.sh	1.0.1	2026/10/18
+#
+# Author:	Fred N. van Kempen, <waltje@varcem.com>
+#
+#		Copyright 2026 Fred N. van Kempen.
+#
+
+SCEN=$1
+DIR=$2
+SCALE=${3:-1}
+
+if [ -z "$SCEN" -o -z "$DIR" ]; then
+	echo "Usage: $0 scenario dir [scale]" >&2
+	exit 2
+fi
+mkdir -p $DIR || exit 1
+
+case $SCEN in
+labels)
+	awk -v n=$((4000 * SCALE)) 'BEGIN {
+		print "\t.cpu\t6502"
+		print "\t.org\t$1000"
+		for (i = 0; i < n; i++) {
+			printf("lab%i:\tlda\tvar%i\n", i, (i * 7) % n)
+			printf("\tjmp\tlab%i\n", (n - i) % n)
+			printf("\t.word\tlab%i+%i\n", (i + 1) % n, i % 16)
+		}
+		for (i = 0; i < n; i++)
+			printf("var%i\t=\t$%04X\n", i, 512 + i % 4096)
+		print "\t.end"
+	}' >$DIR/main.asm
+	;;
+
+include)
+	# A tree of 3 levels, with 3 files included at each level.
+	awk -v n=$((250 * SCALE)) -v dir=$DIR 'function file(name, lvl,   f, i, k) {
+		f = dir "/" name ".asm"
+		for (i = 0; i < n; i++) {
+			printf("%s_%i:\tldx\t#%i\n", name, i, i % 256) >f
+			printf("\tlda\t%s_%i,x\n", name, i) >f
+			printf("\tsta\t$2000,y\n") >f
+		}
+		if (lvl < 3) for (k = 0; k < 3; k++) {
+			printf("\t.include \"%s%i.asm\"\n", name, k) >f
+			file(name k, lvl + 1)
+		}
+		close(f)
+	}
+	BEGIN {
+		f = dir "/main.asm"
+		print "\t.cpu\t6502" >f
+		print "\t.org\t$1000" >f
+		print "\t.include \"t.asm\"" >f
+		print "\t.end" >f
+		close(f)
+		file("t", 0)
+	}'
+	;;
+
+macro)
+	# Start over every 5000 expansions, to stay within 64K.
+	awk -v n=$((20000 * SCALE)) 'BEGIN {
+		print "\t.cpu\t6502"
+		for (m = 0; m < 16; m++) {
+			printf("mac%i\t.macro\tsrc,dst,cnt\n", m)
+			print "\tldx\t#cnt"
+			print "\tlda\tsrc,x"
+			print "\tsta\tdst,x"
+			print "\tdex"
+			print "\tbne\t*-7"
+			print "\t.endm"
+		}
+		for (i = 0; i < n; i++) {
+			if ((i % 5000) == 0)
+				print "\t.org\t$1000"
+			printf("\tmac%i\t$%04X,$%04X,%i\n",
+			       i % 16, 8192 + i % 256, 12288 + i % 512, i % 200 + 1)
+		}
+		print "\t.end"
+	}' >$DIR/main.asm
+	;;
+
+repeat)
+	awk -v n=$((80 * SCALE)) 'BEGIN {
+		print "\t.cpu\t6502"
+		print "\t.org\t$1000"
+		for (i = 0; i < n; i++) {
+			printf("tab%i:\n", i)
+			print "\t.repeat\t256"
+			printf("\t.byte\t((* - tab%i) / 2) ^ $%02X, <(* + %i)\n", i, i % 256, i)
+			print "\t.endrep"
+		}
+		print "\t.end"
+	}' >$DIR/main.asm
+	;;
+
+blob)
+	# The contents do not matter, so just repeat a pattern.
+	awk 'BEGIN {
+		for (i = 0; i < 1024; i++)
+			printf("VASM blob data, block %04i of the benchmark...\n", i)
+	}' >$DIR/blob.bin
+	for i in 1 2; do
+		cat $DIR/blob.bin $DIR/blob.bin $DIR/blob.bin $DIR/blob.bin >$DIR/blob.tmp
+		mv $DIR/blob.tmp $DIR/blob.bin
+	done
+	awk -v n=$((4 * SCALE)) 'BEGIN {
+		print "\t.cpu\t6502"
+		print "\t.org\t$1000"
+		for (i = 0; i < n; i++) {
+			printf("blob%i:\n", i)
+			print "\t.blob\t\"blob.bin\""
+			printf("\t.word\tblob%i\n", i)
+		}
+		print "\t.end"
+	}' >$DIR/main.asm
+	;;
+
+cond)
+	awk -v n=$((5000 * SCALE)) 'BEGIN {
+		print "\t.cpu\t6502"
+		print "\t.org\t$1000"
+		print "flag\t=\t1"
+		for (i = 0; i < n; i++) {
+			printf("\t.if\tflag == %i\n", i % 2)
+			for (k = 0; k < 8; k++)
+				printf("\tlda\t#%i\t\t; taken %i\n", k, i)
+			print "\t.if\tflag"
+			print "\tnop"
+			print "\t.endif"
+			print "\t.else"
+			for (k = 0; k < 8; k++)
+				printf("\tldx\t#%i\t\t; not taken %i\n", k, i)
+			print "\t.endif"
+		}
+		print "\t.end"
+	}' >$DIR/main.asm
+	;;
+
+ins8060)
+	# Keep each chunk of code within the first half of a 4K page.
+	awk -v n=$((10000 * SCALE)) 'BEGIN {
+		print "\t.cpu\tins8060"
+		for (i = 0; i < n; i++) {
+			if ((i % 200) == 0)
+				printf("\t.org\t$%04X\n", (i / 200) % 16 * 4096 + 256)
+			printf("l%i:\tldi\t$%02X\n", i, i % 256)
+			printf("\tst\t%i(p1)\n", i % 64)
+			printf("\tadd\t@1(p2)\n")
+			printf("\txae\n")
+			printf("\tjnz\tl%i\n", i)
+		}
+		print "\t.end"
+	}' >$DIR/main.asm
+	;;
+
+scn2650)
+	# Keep each chunk of code within an 8K page.
+	awk -v n=$((10000 * SCALE)) 'BEGIN {
+		print "\t.cpu\t2650"
+		for (i = 0; i < n; i++) {
+			if ((i % 800) == 0)
+				printf("\t.org\t$%04X\n", (i / 800) % 4 * 8192 + 256)
+			printf("l%i:\tlodi,r0\t$%02X\n", i, i % 256)
+			printf("\tstra,r0\t$%04X\n", 4096 + i % 4096)
+			printf("\taddz\tr1\n")
+			printf("\tbctr,un\tl%i\n", i)
+			printf("\teorz\tr0\n")
+		}
+		print "\t.end"
+	}' >$DIR/main.asm
+	;;
+
+*)
+	echo "$0: unknown scenario '$SCEN'" >&2
+	exit 1
+	;;
+esac
+
+exit 0
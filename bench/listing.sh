@@ -0,0 +1,56 @@
+#!/bin/bash
+#
+# VASM		VARCem Multi-Target Macro Assembler.
+#		A simple table-driven assembler for several 8-bit target
+#		devices, like the 6502, 6800, 80x, Signetics 2650 and the
+#		SC/MP processor series. The code is originally based on
+#		the "asm6502" project, but has been rewritten since.
+#
+#		Benchmark the cost of generating a listing, by assembling
+#		a large synthetic source with and without the -l option.
+#
+#		Usage: bench/listing.sh [vasm] [lines]
+#
+# Version:	@(#)listing.sh	1.0.1	2026/10/18
+#
+# Author:	Fred N. van Kempen, <waltje@varcem.com>
+#
+#		Copyright 2026 Fred N. van Kempen.
+#
+
+VASM=${1:-src/vasm}
+LINES=${2:-200000}
+TMP=${TMPDIR:-/tmp}/vasm-bench.$$
+
+trap 'rm -f $TMP.asm $TMP.bin $TMP.lst' 0 1 2 15
+
+# Generate the source file.
+awk -v n=$LINES 'BEGIN {
+	print "\t.cpu\t6502"
+	print "\t.org\t$1000"
+	for (i = 0; i < n; i += 8) {
+		if ((i % 512) == 0)
+			printf("l%i:\n", i)
+		printf("\tlda\t#$%02X\t\t; load\n", i % 256)
+		printf("\tsta\t$%04X,x\n", 0x2000 + (i % 4096))
+		printf("\tinx\n")
+		printf("\tbne\t@+2\n")
+		printf("\t.byte\t1,2,3,4,5,6,7,8\n")
+		printf("\t.word\tl%i, $1234\n", i - (i % 512))
+		printf("\tjmp\tl%i\n", i - (i % 512))
+		printf("\tnop\n")
+	}
+}' >$TMP.asm
+
+# Run the assembler and report the user+system time it used.
+TIMEFORMAT="%3U %3S"
+run() {
+	{ time "$@" >/dev/null 2>&1 ; } 2>&1 | \
+		awk '{ printf("%.3f\n", $1 + $2) }'
+}
+
+echo "Assembling $LINES lines:"
+echo "  without listing: `run $VASM -q -o $TMP.bin $TMP.asm` sec"
+echo "  with listing:    `run $VASM -q -o $TMP.bin -l $TMP.lst $TMP.asm` sec"
+
+exit 0
@@ -0,0 +1,1329 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Handle incremental reassembly.
+ *
+ *		With the -k option, we save checkpoints of the state of the
+ *		assembler in a file, every time we return to the top level
+ *		of the source from an included file, or move on to the next
+ *		source file. On the next run, we look for the last of these
+ *		checkpoints before anything changed, and run both passes
+ *		from there.
+ *
+ *		For Pass 1, a checkpoint is good if the source text before
+ *		it is the same, and none of the files included (or used as
+ *		binary blobs) before it have changed.
+ *
+ *		Pass 2 also needs the final values of all symbols it used
+ *		before that point to be the same, as the code it generated
+ *		there may depend on forward references. We keep track of
+ *		the first use of each symbol in Pass 2, and of any symbols
+ *		looked for but not found. If some of these changed after
+ *		Pass 1, we go back to an earlier checkpoint, and run Pass 1
+ *		again from there.
+ *
+ *		Checkpoints are not used if a listing, cross reference or
+ *		source map is requested, as these need all of Pass 2. They
+ *		are saved, though. Once the zero page allocator or a
+ *		.pagesafe block was used, no more checkpoints are taken,
+ *		as the places of these depend on all of Pass 1.
+ *
+ *		The file uses the layout from dbfile.c, with the "VCKP"
+ *		magic, and these sections (all values are uint32_t, and
+ *		strings are offsets plus one, so 0 is "none"):
+ *
+ *		  STRS	string table
+ *		  INFO	key of the options and input files
+ *		  CKPT	offset in the source text and hash of the text
+ *			before it, line, file index, first and number
+ *			of remaining files, and the state of both passes
+ *			(pc, org, sa, radix, locals, label, processor,
+ *			output size, output address and .org flag)
+ *		  HIST	name and first line of all files
+ *		  FUTR	name and first line of the remaining files
+ *		  SYM1	changes to symbols in Pass 1: name, parent,
+ *			value, type, file, line, and checkpoint
+ *		  SYM2	same, for variables in Pass 2
+ *		  MACS	name, parameters, definition, and checkpoint
+ *		  FILS	name and hash of the files used, and the number
+ *			of checkpoints passed before them
+ *		  USED	name, parent, value and type of symbols used in
+ *			Pass 2, and the number of checkpoints passed
+ *		  EVTS	type, address and output size of origin and
+ *			start address records, same
+ *		  IMAG	the generated code
+ *
+ * Version:	@(#)ckpt.c	1.0.8	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "error.h"
+#include "target.h"
+#include "writer.h"
+#include "dbfile.h"
+#include "ckpt.h"
+#include "zpage.h"
+#include "page.h"
+
+
+#define CKPT_VERSION	2		// version of the file format
+
+#define S_STRS		0		// the sections of the file
+#define S_INFO		1
+#define S_CKPT		2
+#define S_HIST		3
+#define S_FUTR		4
+#define S_SYM1		5
+#define S_SYM2		6
+#define S_MACS		7
+#define S_FILS		8
+#define S_USED		9
+#define S_EVTS		10
+#define S_IMAG		11
+#define S_MAX		12
+
+#define CK_STATE	10		// size of the state of one pass
+#define CK_PASS1	7		//  where it is in a checkpoint
+#define CK_PASS2	(CK_PASS1 + CK_STATE)
+#define CK_SIZE		(CK_PASS2 + CK_STATE)
+
+#define CK_SEED1	2166136261U	// seeds for the two hashes
+#define CK_SEED2	0x9e3779b9
+
+#define USED_MISSING	0x80000000	// symbol was not found
+
+
+static const char *ck_tags[S_MAX] = {
+    "STRS", "INFO", "CKPT", "HIST", "FUTR", "SYM1",
+    "SYM2", "MACS", "FILS", "USED", "EVTS", "IMAG"
+};
+
+/* Size of the entries (in uint32_t's, or 0 for bytes.) */
+static const int ck_sizes[S_MAX] = {
+    0, 2, CK_SIZE, 2, 2, 7, 7, 4, 4, 5, 4, 0
+};
+
+/* Which of their values are strings. */
+static const uint32_t ck_strs[S_MAX] = {
+    0, 0,
+    (1 << (CK_PASS1 + 5)) | (1 << (CK_PASS1 + 6)) |
+    (1 << (CK_PASS2 + 5)) | (1 << (CK_PASS2 + 6)),
+    0x01, 0x01, 0x03, 0x03, 0x07, 0x01, 0x03, 0, 0
+};
+
+
+static char	*ck_path;		// name of the checkpoint file
+static uint8_t	*ck_old;		// the old file,
+static dbsect_t	ck_osect[S_MAX];	//  and its sections
+static dbsect_t	ck_sect[S_MAX];		// the new file
+static uint32_t	*ck_hstr,		// hash table for the strings
+		ck_nhstr,
+		ck_nstrs;
+static uint32_t	*ck_hmiss,		// hash table for missed symbols
+		ck_nhmiss,
+		ck_misses;
+static uint32_t	*ck_xoff,		// offsets of checkpoints in Pass 1
+		ck_nxoff;
+
+static const char *ck_text;		// the unexpanded source text
+static uint32_t	ck_tlen;
+static uint32_t	ck_key[2];		// key of the options and inputs
+static const char *ck_cpu;		// initial processor
+static char	**ck_files;		//  and file names
+static int	ck_nfiles;
+static uint32_t	ck_start;		// checkpoint to start from
+static int	ck_ok,			// may we start from one?
+		ck_again,		// running Pass 1 again?
+		ck_bad;			// something went wrong
+
+/* Our state during a pass. */
+static uint32_t	ck_count;		// number of checkpoints passed
+static int	ck_depth,		// current include depth
+		ck_left;		// just left a file
+static uint32_t	ck_moff,		// offset of the text we started with
+		ck_expand;		// size of the included text
+static uint32_t	ck_hash[2],		// hash of the text
+		ck_hoff;		//  up to here
+static const char *ck_ptext;		// text we started Pass 2 with
+static uint32_t	ck_stamp,		// symbol stamp at last checkpoint
+		ck_pstamp;		//  and when Pass 2 started
+static int	ck_macros;		// macros at last checkpoint
+
+
+/* Update a (32-bit FNV-1a) hash with some data. */
+static uint32_t
+ck_hashbuf(uint32_t h, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    while (len-- > 0) {
+	h ^= *p++;
+	h *= 16777619;
+    }
+
+    return h;
+}
+
+
+/* Update both hashes. */
+static void
+ck_hash2(uint32_t *h, const void *data, size_t len)
+{
+    h[0] = ck_hashbuf(h[0], data, len);
+    h[1] = ck_hashbuf(h[1] ^ CK_SEED2, data, len);
+}
+
+
+static void
+ck_hashstr(uint32_t *h, const char *str)
+{
+    if (str == NULL)
+	str = "";
+
+    ck_hash2(h, str, strlen(str) + 1);
+}
+
+
+static void
+ck_hash32(uint32_t *h, uint32_t v)
+{
+    uint8_t b[4];
+
+    db_put32(b, v);
+    ck_hash2(h, b, 4);
+}
+
+
+/* Hash the contents of a file. */
+static int
+ck_hashfile(const char *fn, uint32_t *h)
+{
+    uint8_t buf[4096];
+    size_t n;
+    FILE *fp;
+
+    if ((fp = fopen(fn, "rb")) == NULL)
+	return 0;
+
+    h[0] = CK_SEED1;
+    h[1] = CK_SEED2;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+	ck_hash2(h, buf, n);
+    (void)fclose(fp);
+
+    return 1;
+}
+
+
+/* Return a string from the old or the new string table. */
+static const char *
+ck_ostr(uint32_t off)
+{
+    return off ? (const char *)ck_osect[S_STRS].data + off - 1 : NULL;
+}
+
+
+static const char *
+ck_nstr(uint32_t off)
+{
+    return off ? (const char *)ck_sect[S_STRS].data + off - 1 : NULL;
+}
+
+
+/* Grow an (open addressing) hash table. */
+static uint32_t *
+ck_grow(uint32_t *tab, uint32_t *size, uint32_t (*hash)(uint32_t))
+{
+    uint32_t *ntab, n, i, h;
+
+    n = *size ? (*size * 2) : 1024;
+    ntab = malloc(n * sizeof(uint32_t));
+    if (ntab == NULL)
+	error(ERR_MEM, "checkpoint");
+    memset(ntab, 0x00, n * sizeof(uint32_t));
+
+    for (i = 0; i < *size; i++) {
+	if (tab[i] == 0)
+		continue;
+
+	h = hash(tab[i]) & (n - 1);
+	while (ntab[h] != 0)
+		h = (h + 1) & (n - 1);
+	ntab[h] = tab[i];
+    }
+
+    if (tab != NULL)
+	free(tab);
+    *size = n;
+
+    return ntab;
+}
+
+
+static uint32_t
+ck_strkey(uint32_t off)
+{
+    const char *str = ck_nstr(off);
+
+    return ck_hashbuf(CK_SEED1, str, strlen(str));
+}
+
+
+/* Add a string to the new string table, only once. */
+static uint32_t
+ck_str(const char *str)
+{
+    uint32_t h;
+
+    if (str == NULL)
+	return 0;
+
+    if (ck_nstrs >= (ck_nhstr / 2))
+	ck_hstr = ck_grow(ck_hstr, &ck_nhstr, ck_strkey);
+
+    h = ck_hashbuf(CK_SEED1, str, strlen(str)) & (ck_nhstr - 1);
+    while (ck_hstr[h] != 0) {
+	if (! strcmp(ck_nstr(ck_hstr[h]), str))
+		return ck_hstr[h];
+	h = (h + 1) & (ck_nhstr - 1);
+    }
+
+    ck_hstr[h] = db_str(&ck_sect[S_STRS], str) + 1;
+    ck_nstrs++;
+
+    return ck_hstr[h];
+}
+
+
+/* Return entry n of a section. */
+static uint8_t *
+ck_get(dbsect_t *sect, int s, uint32_t n)
+{
+    return sect[s].data + (n * 4 * ck_sizes[s]);
+}
+
+
+/* Return one value of entry n of a section. */
+static uint32_t
+ck_val(dbsect_t *sect, int s, uint32_t n, int i)
+{
+    return db_get32(ck_get(sect, s, n) + (4 * i));
+}
+
+
+/* Add an entry to a section of the new file. */
+static void
+ck_add(int s, const uint32_t *v)
+{
+    uint8_t buf[4 * CK_SIZE];
+    int i;
+
+    for (i = 0; i < ck_sizes[s]; i++)
+	db_put32(buf + (4 * i), v[i]);
+
+    (void)db_append(&ck_sect[s], buf, 4 * ck_sizes[s]);
+}
+
+
+/* Copy an entry from the old file, with its strings. */
+static void
+ck_copyent(int s, uint32_t n, uint32_t *v)
+{
+    int i;
+
+    for (i = 0; i < ck_sizes[s]; i++) {
+	v[i] = ck_val(ck_osect, s, n, i);
+	if (ck_strs[s] & (1 << i))
+		v[i] = ck_str(ck_ostr(v[i]));
+    }
+}
+
+
+/* Set up the (empty) sections of the new file. */
+static void
+ck_reset(void)
+{
+    int s;
+
+    db_free(ck_sect, S_MAX);
+    for (s = 0; s < S_MAX; s++)
+	(void)db_alloc(&ck_sect[s], ck_tags[s], 0,
+		       ck_sizes[s] ? (4 * ck_sizes[s]) : 1);
+
+    if (ck_hstr != NULL)
+	free(ck_hstr);
+    ck_hstr = NULL;
+    ck_nhstr = ck_nstrs = 0;
+
+    if (ck_hmiss != NULL)
+	free(ck_hmiss);
+    ck_hmiss = NULL;
+    ck_nhmiss = ck_misses = 0;
+}
+
+
+/*
+ * Copy everything before checkpoint k from the old file. Symbols
+ * and macros are tagged with the checkpoint they belong to, the
+ * other entries with the number of checkpoints passed before them.
+ */
+static void
+ck_copy(uint32_t k)
+{
+    static const int lists[] = {
+	S_SYM1, S_SYM2, S_MACS, S_FILS, S_USED, S_EVTS
+    };
+    uint32_t v[CK_SIZE], f[2], i, j, t;
+    int l, s;
+
+    ck_reset();
+
+    for (i = 0; i < k; i++) {
+	ck_copyent(S_CKPT, i, v);
+
+	t = ck_sect[S_FUTR].count;
+	for (j = 0; j < v[6]; j++) {
+		ck_copyent(S_FUTR, v[5] + j, f);
+		ck_add(S_FUTR, f);
+	}
+	v[5] = t;
+
+	ck_add(S_CKPT, v);
+    }
+
+    for (l = 0; l < (int)(sizeof(lists) / sizeof(int)); l++) {
+	s = lists[l];
+
+	for (i = 0; i < ck_osect[s].count; i++) {
+		t = ck_val(ck_osect, s, i, ck_sizes[s] - 1);
+		if ((s <= S_MACS) ? (t > k) : (t >= k))
+			continue;
+
+		ck_copyent(s, i, v);
+		ck_add(s, v);
+	}
+    }
+}
+
+
+/* Read the old checkpoint file, and check it. */
+static int
+ck_open(void)
+{
+    uint32_t i, n;
+    int j, s;
+
+    for (s = 0; s < S_MAX; s++)
+	memcpy(ck_osect[s].tag, ck_tags[s], 4);
+
+    ck_old = db_read(ck_path, "VCKP", CKPT_VERSION, ck_osect, S_MAX);
+    if (ck_old == NULL)
+	return 0;
+
+    n = ck_osect[S_STRS].count;
+    if ((n == 0) || (ck_osect[S_STRS].data[n - 1] != '\0') ||
+	(ck_osect[S_INFO].count != 1))
+	goto bad;
+
+    for (s = 0; s < S_MAX; s++) {
+	if (ck_osect[s].esize != (uint32_t)(ck_sizes[s] ? (4 * ck_sizes[s]) : 1))
+		goto bad;
+
+	/* All strings must be in the table. */
+	for (i = 0; ck_strs[s] && (i < ck_osect[s].count); i++) {
+		for (j = 0; j < ck_sizes[s]; j++) {
+			if ((ck_strs[s] & (1 << j)) &&
+			    (ck_val(ck_osect, s, i, j) > n))
+				goto bad;
+		}
+	}
+    }
+
+    for (i = 0; i < ck_osect[S_CKPT].count; i++) {
+	if ((ck_val(ck_osect, S_CKPT, i, 5) + ck_val(ck_osect, S_CKPT, i, 6)) >
+							ck_osect[S_FUTR].count)
+		goto bad;
+    }
+
+    return 1;
+
+bad:
+    free(ck_old);
+    ck_old = NULL;
+
+    return 0;
+}
+
+
+/* Find the last checkpoint we can use for Pass 1. */
+static uint32_t
+ck_find(void)
+{
+    uint32_t h[2], k, n, off, t;
+
+    if ((ck_val(ck_osect, S_INFO, 0, 0) != ck_key[0]) ||
+	(ck_val(ck_osect, S_INFO, 0, 1) != ck_key[1]))
+	return 0;
+
+    /* See how much of the source text is the same. */
+    n = ck_osect[S_CKPT].count;
+    h[0] = CK_SEED1;
+    h[1] = CK_SEED2;
+    off = 0;
+    for (k = 0; k < n; k++) {
+	t = ck_val(ck_osect, S_CKPT, k, 0);
+	if ((t < off) || (t > ck_tlen))
+		break;
+
+	ck_hash2(h, ck_text + off, t - off);
+	off = t;
+	if ((h[0] != ck_val(ck_osect, S_CKPT, k, 1)) ||
+	    (h[1] != ck_val(ck_osect, S_CKPT, k, 2)))
+		break;
+    }
+
+    /* And if any of the files used before it have changed. */
+    for (n = 0; n < ck_osect[S_FILS].count; n++) {
+	t = ck_val(ck_osect, S_FILS, n, 3);
+	if (t >= k)
+		continue;
+
+	if (!ck_hashfile(ck_ostr(ck_val(ck_osect, S_FILS, n, 0)), h) ||
+	    (h[0] != ck_val(ck_osect, S_FILS, n, 1)) ||
+	    (h[1] != ck_val(ck_osect, S_FILS, n, 2)))
+		k = t;
+    }
+
+    /* We also need its file names, and the code generated before it. */
+    while ((k > 0) &&
+	   ((ck_val(ck_osect, S_CKPT, k - 1, 4) >= ck_osect[S_HIST].count) ||
+	    (ck_val(ck_osect, S_CKPT, k - 1, CK_PASS2 + 7) > ck_osect[S_IMAG].count)))
+	k--;
+
+    return k;
+}
+
+
+/* Return the state of the current pass. */
+static void
+ck_state(uint32_t *v)
+{
+    uint32_t base;
+    int orgdone;
+
+    output_state(&base, &orgdone);
+
+    v[0] = pc;
+    v[1] = org;
+    v[2] = sa;
+    v[3] = (uint8_t)radix;
+    v[4] = (uint8_t)auto_local;
+    v[5] = current_label ? ck_str(current_label->name) : 0;
+    v[6] = ck_str(trg_name());
+    v[7] = output_size;
+    v[8] = base;
+    v[9] = orgdone;
+}
+
+
+/* Continue from the state saved in checkpoint k. */
+static void
+ck_unstate(uint32_t k, int i)
+{
+    const uint8_t *p = ck_get(ck_sect, S_CKPT, k - 1) + (4 * i);
+
+    pc = db_get32(p);
+    org = db_get32(p + 4);
+    sa = db_get32(p + 8);
+    radix = (int8_t)db_get32(p + 12);
+    auto_local = (int8_t)db_get32(p + 16);
+    current_label = NULL;
+    if (db_get32(p + 20) != 0)
+	current_label = sym_lookup(ck_nstr(db_get32(p + 20)), NULL);
+    (void)trg_set_cpu(ck_nstr(db_get32(p + 24)));
+    output_size = db_get32(p + 28);
+    output_restore(db_get32(p + 32), db_get32(p + 36));
+}
+
+
+/* Save a changed symbol. */
+static void
+ck_sym(int s, const symbol_t *sym, const symbol_t *parent, uint32_t tag)
+{
+    uint32_t v[7];
+
+    v[0] = ck_str(sym->name);
+    v[1] = parent ? ck_str(parent->name) : 0;
+    v[2] = sym->value.v;
+    v[3] = sym->value.t | (sym->kind << 8) | ((uint8_t)sym->subkind << 16);
+    v[4] = (uint32_t)sym->filenr;
+    v[5] = sym->linenr;
+    v[6] = tag;
+    ck_add(s, v);
+}
+
+
+/* Save all symbols (or variables) changed since the last checkpoint. */
+static void
+ck_syms(int s, uint32_t tag)
+{
+    const symbol_t *sym, *loc;
+
+    for (sym = sym_table(); sym != NULL; sym = sym->next) {
+	if ((sym->stamp > ck_stamp) && ((s == S_SYM1) || IS_VAR(sym)))
+		ck_sym(s, sym, NULL, tag);
+
+	for (loc = sym->locals; loc != NULL; loc = loc->next) {
+		if ((loc->stamp > ck_stamp) && ((s == S_SYM1) || IS_VAR(loc)))
+			ck_sym(s, loc, sym, tag);
+	}
+    }
+
+    ck_stamp = sym_stamp;
+}
+
+
+/* Set a symbol from a saved change. */
+static void
+ck_setsym(symbol_t *sym, int s, uint32_t i)
+{
+    uint32_t t = ck_val(ck_sect, s, i, 3);
+
+    sym->value.v = ck_val(ck_sect, s, i, 2);
+    sym->value.t = t & 0xff;
+    sym->kind = (t >> 8) & 0xff;
+    sym->subkind = (int8_t)(t >> 16);
+    sym->filenr = (int)ck_val(ck_sect, s, i, 4);
+    sym->linenr = ck_val(ck_sect, s, i, 5);
+    sym->stamp = ++sym_stamp;
+}
+
+
+/* Apply the saved symbol changes, up to checkpoint k. */
+static void
+ck_apply(int s, uint32_t k)
+{
+    symbol_t *sym, *parent;
+    uint32_t i, t;
+
+    for (i = 0; i < ck_sect[s].count; i++) {
+	if (ck_val(ck_sect, s, i, 6) > k)
+		continue;
+
+	if ((t = ck_val(ck_sect, s, i, 1)) != 0) {
+		parent = sym_aquire(ck_nstr(t), NULL);
+		sym = sym_aquire(ck_nstr(ck_val(ck_sect, s, i, 0)), &parent->locals);
+	} else
+		sym = sym_aquire(ck_nstr(ck_val(ck_sect, s, i, 0)), NULL);
+
+	ck_setsym(sym, s, i);
+    }
+}
+
+
+static const uint32_t *ck_sortidx;
+
+/* Sort global symbols before locals, and in reverse order. */
+static int
+ck_cmpsym(const void *a, const void *b)
+{
+    uint32_t i = ck_sortidx[*(const uint32_t *)a],
+	     j = ck_sortidx[*(const uint32_t *)b];
+    uint32_t pi = ck_val(ck_sect, S_SYM1, i, 1),
+	     pj = ck_val(ck_sect, S_SYM1, j, 1);
+
+    if ((pi == 0) != (pj == 0))
+	return (pi == 0) ? -1 : 1;
+
+    return strcasecmp(ck_nstr(ck_val(ck_sect, S_SYM1, j, 0)),
+		      ck_nstr(ck_val(ck_sect, S_SYM1, i, 0)));
+}
+
+
+/*
+ * Rebuild the (empty) symbol table of Pass 1, as it was at checkpoint
+ * k. Looking up every symbol would take forever for large tables, so
+ * we find the last change of each symbol, and add them in reverse
+ * order, so each one goes in front of its table.
+ */
+static void
+ck_rebuild(uint32_t k)
+{
+    uint32_t *idx, *order, *hash, n, nh, i, h, j, cnt;
+    symbol_t **syms, *parent;
+
+    n = ck_sect[S_SYM1].count;
+    for (nh = 1024; nh < (2 * n); nh *= 2)
+	;
+    idx = malloc((n + 1) * sizeof(uint32_t));
+    order = malloc((n + 1) * sizeof(uint32_t));
+    syms = malloc((n + 1) * sizeof(symbol_t *));
+    hash = malloc(nh * sizeof(uint32_t));
+    if ((idx == NULL) || (order == NULL) || (syms == NULL) || (hash == NULL))
+	error(ERR_MEM, "checkpoint");
+    memset(hash, 0x00, nh * sizeof(uint32_t));
+
+    cnt = 0;
+    for (i = 0; i < n; i++) {
+	if (ck_val(ck_sect, S_SYM1, i, 6) > k)
+		continue;
+
+	h = ((ck_val(ck_sect, S_SYM1, i, 0) * 31) +
+	      ck_val(ck_sect, S_SYM1, i, 1)) & (nh - 1);
+	while ((j = hash[h]) != 0) {
+		if ((ck_val(ck_sect, S_SYM1, idx[j - 1], 0) == ck_val(ck_sect, S_SYM1, i, 0)) &&
+		    (ck_val(ck_sect, S_SYM1, idx[j - 1], 1) == ck_val(ck_sect, S_SYM1, i, 1)))
+			break;
+		h = (h + 1) & (nh - 1);
+	}
+
+	if (j != 0)
+		idx[j - 1] = i;
+	else {
+		order[cnt] = cnt;
+		idx[cnt++] = i;
+		hash[h] = cnt;
+	}
+    }
+
+    ck_sortidx = idx;
+    qsort(order, cnt, sizeof(uint32_t), ck_cmpsym);
+
+    for (i = 0; i < cnt; i++) {
+	j = ck_val(ck_sect, S_SYM1, idx[order[i]], 1);
+	if (j != 0) {
+		/* Find the (global) parent. */
+		h = (j * 31) & (nh - 1);
+		while (hash[h] != 0) {
+			if ((ck_val(ck_sect, S_SYM1, idx[hash[h] - 1], 0) == j) &&
+			    (ck_val(ck_sect, S_SYM1, idx[hash[h] - 1], 1) == 0))
+				break;
+			h = (h + 1) & (nh - 1);
+		}
+		if (hash[h] != 0)
+			parent = syms[hash[h] - 1];
+		else
+			parent = sym_aquire(ck_nstr(j), NULL);
+
+		syms[order[i]] = sym_add(ck_nstr(ck_val(ck_sect, S_SYM1, idx[order[i]], 0)),
+					 &parent->locals);
+	} else
+		syms[order[i]] = sym_add(ck_nstr(ck_val(ck_sect, S_SYM1, idx[order[i]], 0)), NULL);
+
+	ck_setsym(syms[order[i]], S_SYM1, idx[order[i]]);
+    }
+
+    free(hash);
+    free(syms);
+    free(order);
+    free(idx);
+}
+
+
+/* Save all macros defined since the last checkpoint. */
+static void
+ck_macs(uint32_t tag)
+{
+    const char *name, *formal, *def;
+    uint32_t v[4];
+
+    while (ck_macros < macro_count()) {
+	if (! macro_get(++ck_macros, &name, &formal, &def))
+		continue;
+
+	v[0] = ck_str(name);
+	v[1] = ck_str(formal);
+	v[2] = ck_str(def);
+	v[3] = tag;
+	ck_add(S_MACS, v);
+    }
+}
+
+
+/* Define all macros, up to checkpoint k. */
+static void
+ck_defmacs(uint32_t k)
+{
+    uint32_t i;
+
+    for (i = 0; i < ck_sect[S_MACS].count; i++) {
+	if (ck_val(ck_sect, S_MACS, i, 3) > k)
+		continue;
+
+	macro_define(ck_nstr(ck_val(ck_sect, S_MACS, i, 0)),
+		     ck_nstr(ck_val(ck_sect, S_MACS, i, 1)),
+		     ck_nstr(ck_val(ck_sect, S_MACS, i, 2)));
+    }
+
+    ck_macros = macro_count();
+}
+
+
+/* Find a symbol by its name and (optional) parent. */
+static symbol_t *
+ck_lookup(uint32_t name, uint32_t parent)
+{
+    symbol_t *sym;
+
+    if (parent == 0)
+	return sym_lookup(ck_nstr(name), NULL);
+
+    if ((sym = sym_lookup(ck_nstr(parent), NULL)) == NULL)
+	return NULL;
+
+    return sym_lookup(ck_nstr(name), &sym->locals);
+}
+
+
+/* Calculate the key of the options and input files. */
+static void
+ck_makekey(void)
+{
+    const symbol_t *sym;
+    int i;
+
+    ck_key[0] = CK_SEED1;
+    ck_key[1] = CK_SEED2;
+    ck_hashstr(ck_key, version);
+    ck_hashstr(ck_key, output_name());
+    ck_hashstr(ck_key, trg_name());
+    ck_hash32(ck_key, opt_C);
+    ck_hash32(ck_key, opt_F);
+    ck_hash32(ck_key, (uint8_t)radix);
+    for (i = 0; i < filenames_len; i++)
+	ck_hashstr(ck_key, filenames[i]);
+
+    /* Symbols defined on the command line. */
+    for (sym = sym_table(); sym != NULL; sym = sym->next) {
+	ck_hashstr(ck_key, sym->name);
+	ck_hash32(ck_key, sym->value.v);
+	ck_hash32(ck_key, sym->value.t | (sym->kind << 8));
+    }
+}
+
+
+/* Enable checkpoints, and set the name of the file. */
+int
+ckpt_init(const char *fn)
+{
+    ck_path = strdup(fn);
+
+    return (ck_path != NULL);
+}
+
+
+/*
+ * Called before Pass 1 with the (unexpanded) source text, returns
+ * the offset in that text to start from. If ok is not set, we save
+ * checkpoints, but do not use them.
+ */
+uint32_t
+ckpt_start(const char *text, size_t len, int ok)
+{
+    if (ck_path == NULL)
+	return 0;
+
+    if (ck_text == NULL) {
+	/* The file has 32-bit offsets, so we can not do a huge source. */
+	ck_files = malloc((filenames_len + 1) * sizeof(char *));
+	if ((len > 0xffffffff) || (ck_files == NULL)) {
+		ckpt_close();
+		return 0;
+	}
+
+	ck_text = text;
+	ck_tlen = (uint32_t)len;
+	ck_cpu = trg_name();
+	for (ck_nfiles = 0; ck_nfiles < filenames_len; ck_nfiles++)
+		ck_files[ck_nfiles] = filenames[ck_nfiles];
+	ck_ok = ok;
+	ck_makekey();
+
+	ck_start = 0;
+	if (ck_ok && ck_open())
+		ck_start = ck_find();
+
+	if (ck_start > 0) {
+		if (opt_v)
+			printf("Starting at checkpoint %u\n", ck_start);
+		ck_copy(ck_start);
+	} else {
+		/* The initial symbols are "checkpoint 0". */
+		ck_reset();
+		ck_stamp = 0;
+		ck_syms(S_SYM1, 0);
+	}
+    } else {
+	/* We are running Pass 1 again. */
+	(void)trg_set_cpu(ck_cpu);
+	ck_again = 1;
+	ck_copy(ck_start);
+    }
+
+    if (ck_start == 0)
+	return 0;
+
+    return ck_val(ck_sect, S_CKPT, ck_start - 1, 0);
+}
+
+
+/*
+ * Called after Pass 1, to check if the symbols used by the part of
+ * Pass 2 we will skip are still the same. If not, we have to go back
+ * to an earlier checkpoint, and run Pass 1 again.
+ */
+int
+ckpt_verify(void)
+{
+    const symbol_t *sym;
+    uint32_t i, k, t;
+
+    if ((ck_path == NULL) || (ck_start == 0))
+	return 1;
+
+    k = ck_start;
+    for (i = 0; i < ck_sect[S_USED].count; i++) {
+	t = ck_val(ck_sect, S_USED, i, 4);
+	if (t >= k)
+		continue;
+
+	sym = ck_lookup(ck_val(ck_sect, S_USED, i, 0), ck_val(ck_sect, S_USED, i, 1));
+	if (ck_val(ck_sect, S_USED, i, 3) & USED_MISSING) {
+		if (sym != NULL)
+			k = t;
+	} else if ((sym == NULL) ||
+		   (sym->value.v != ck_val(ck_sect, S_USED, i, 2)) ||
+		   ((uint32_t)(sym->value.t | (sym->kind << 8)) != ck_val(ck_sect, S_USED, i, 3)))
+		k = t;
+    }
+
+    /* The code before it must still fit in the output buffer. */
+    while ((k > 0) && (ck_val(ck_sect, S_CKPT, k - 1, CK_PASS2 + 7) > output_size))
+	k--;
+
+    if (k == ck_start)
+	return 1;
+
+    if (opt_v)
+	printf("Going back to checkpoint %u\n", k);
+    ck_start = k;
+
+    return 0;
+}
+
+
+/* Set up the state at the start of a pass, from our checkpoint. */
+void
+ckpt_restore(int pass, const char *start)
+{
+    uint32_t i, k, n;
+    wrec_t r;
+
+    if (ck_path == NULL)
+	return;
+
+    k = ck_start;
+    ck_count = k;
+    ck_depth = ck_left = 0;
+    ck_expand = 0;
+
+    if (pass == 1) {
+	ck_moff = ck_hoff = 0;
+	ck_hash[0] = CK_SEED1;
+	ck_hash[1] = CK_SEED2;
+	ck_nxoff = 0;
+
+	if ((k > 0) || ck_again) {
+		sym_free(NULL);
+		ck_rebuild(k);
+		ck_defmacs(k);
+	}
+	ck_stamp = sym_stamp;
+	ck_macros = macro_count();
+
+	/* We still depend on the files we skipped. */
+	for (i = 0; i < ck_sect[S_FILS].count; i++)
+		if (! file_dep(ck_nstr(ck_val(ck_sect, S_FILS, i, 0))))
+			error(ERR_MEM, NULL);
+
+	/* Back to the files we started with, dropping any others. */
+	file_rewind(ck_files, ck_nfiles);
+	if (k == 0)
+		return;
+
+	ck_moff = ck_hoff = ck_val(ck_sect, S_CKPT, k - 1, 0);
+	ck_hash[0] = ck_val(ck_sect, S_CKPT, k - 1, 1);
+	ck_hash[1] = ck_val(ck_sect, S_CKPT, k - 1, 2);
+	ck_unstate(k, CK_PASS1);
+	if (output_size <= ck_osect[S_IMAG].count)
+		output_preload(ck_osect[S_IMAG].data, output_size, 1);
+
+	/* Rebuild the file name table, as it was at that point. */
+	filenames_idx = (int)ck_val(ck_sect, S_CKPT, k - 1, 4);
+	if (! file_room(filenames_idx))
+		error(ERR_MEM, NULL);
+	filenames_len = 0;
+	for (i = 0; i <= (uint32_t)filenames_idx; i++) {
+		filenames[filenames_len] = strdup(ck_ostr(ck_val(ck_osect, S_HIST, i, 0)));
+		filelines[filenames_len++] = ck_val(ck_osect, S_HIST, i, 1);
+	}
+	n = ck_val(ck_sect, S_CKPT, k - 1, 5);
+	for (i = 0; i < ck_val(ck_sect, S_CKPT, k - 1, 6); i++) {
+		if (! file_room(filenames_len))
+			error(ERR_MEM, NULL);
+		filenames[filenames_len] = strdup(ck_nstr(ck_val(ck_sect, S_FUTR, n + i, 0)));
+		filelines[filenames_len++] = ck_val(ck_sect, S_FUTR, n + i, 1);
+	}
+    } else {
+	ck_ptext = start;
+	ck_pstamp = sym_stamp;
+
+	if (k > 0) {
+		ck_apply(S_SYM2, k);
+		ck_defmacs(k);
+
+		/* Put back the code we generated before that point. */
+		n = ck_val(ck_sect, S_CKPT, k - 1, CK_PASS2 + 7);
+		if (n > 0)
+			output_preload(ck_osect[S_IMAG].data, n, 2);
+
+		/* Replay the records for the output file. */
+		for (i = 0; i < ck_sect[S_EVTS].count; i++) {
+			memset(&r, 0x00, sizeof(r));
+			r.type = ck_val(ck_sect, S_EVTS, i, 0);
+			r.addr = ck_val(ck_sect, S_EVTS, i, 1);
+			output_size = ck_val(ck_sect, S_EVTS, i, 2);
+			writer_put(&r, NULL, 0, NULL);
+		}
+
+		ck_unstate(k, CK_PASS2);
+		filenames_idx = (int)ck_val(ck_sect, S_CKPT, k - 1, 4);
+	}
+
+	ck_stamp = sym_stamp;
+	sym_track = 1;
+    }
+
+    if (k > 0)
+	line = ck_val(ck_sect, S_CKPT, k - 1, 3);
+}
+
+
+/* We entered an included file, of the given size. */
+void
+ckpt_enter(uint32_t size)
+{
+    ck_depth++;
+    ck_expand += size;
+}
+
+
+/* We left a file. */
+void
+ckpt_leave(void)
+{
+    if (ck_depth > 0)
+	ck_depth--;
+    ck_left = 1;
+}
+
+
+/*
+ * Called at the end of every line. If we just got back to the top
+ * level from an included file, take a checkpoint.
+ */
+void
+ckpt_boundary(const char *p, int pass)
+{
+    uint32_t v[CK_SIZE], *xp, xoff, moff;
+    uint8_t *e;
+    int i;
+
+    if ((ck_path == NULL) || ck_bad || !ck_left)
+	return;
+    ck_left = 0;
+
+    if ((ck_depth > 0) || (maclevel > 0) || macstate ||
+	(iflevel > 0) || (rptlevel > 0) || (cyclevel > 0) || (errors > 0) ||
+	(zp_count() > 0) || (page_count() > 0))
+	return;
+
+    ck_count++;
+
+    if (pass == 1) {
+	if ((size_t)(p - text) > 0xffffffff) {
+		ck_bad = 1;
+		return;
+	}
+	xoff = (uint32_t)(p - text);
+	moff = ck_moff + xoff - ck_expand;
+	if ((moff < ck_hoff) || (moff > ck_tlen)) {
+		ck_bad = 1;
+		return;
+	}
+
+	/* Remember where it is in the text of Pass 2. */
+	if ((ck_nxoff % 256) == 0) {
+		xp = realloc(ck_xoff, (ck_nxoff + 256) * sizeof(uint32_t));
+		if (xp == NULL)
+			error(ERR_MEM, "checkpoint");
+		ck_xoff = xp;
+	}
+	ck_xoff[ck_nxoff++] = xoff;
+
+	ck_hash2(ck_hash, ck_text + ck_hoff, moff - ck_hoff);
+	ck_hoff = moff;
+
+	memset(v, 0x00, sizeof(v));
+	v[0] = moff;
+	v[1] = ck_hash[0];
+	v[2] = ck_hash[1];
+	v[3] = line;
+	v[4] = filenames_idx;
+	v[5] = ck_sect[S_FUTR].count;
+	v[6] = filenames_len - filenames_idx - 1;
+	ck_state(v + CK_PASS1);
+	ck_add(S_CKPT, v);
+
+	for (i = filenames_idx + 1; i < filenames_len; i++) {
+		v[0] = ck_str(filenames[i]);
+		v[1] = filelines[i];
+		ck_add(S_FUTR, v);
+	}
+
+	ck_syms(S_SYM1, ck_count);
+	ck_macs(ck_count);
+    } else {
+	/* Pass 2 must get to the same points as Pass 1. */
+	xoff = ck_count - ck_start - 1;
+	if ((xoff >= ck_nxoff) || (ck_xoff[xoff] != (uint32_t)(p - ck_ptext))) {
+		ck_bad = 1;
+		return;
+	}
+
+	ck_state(v);
+	e = ck_get(ck_sect, S_CKPT, ck_count - 1) + (4 * CK_PASS2);
+	for (i = 0; i < CK_STATE; i++)
+		db_put32(e + (4 * i), v[i]);
+
+	ck_syms(S_SYM2, ck_count);
+    }
+}
+
+
+/* We used a file in Pass 1, remember its contents. */
+void
+ckpt_file(const char *fn)
+{
+    uint32_t v[4];
+
+    if ((ck_path == NULL) || ck_bad)
+	return;
+
+    if (! ck_hashfile(fn, v + 1)) {
+	ck_bad = 1;
+	return;
+    }
+
+    v[0] = ck_str(fn);
+    v[3] = ck_count;
+    ck_add(S_FILS, v);
+}
+
+
+/* Record an origin or start address in Pass 2. */
+void
+ckpt_event(int type, uint32_t addr)
+{
+    uint32_t v[4];
+
+    if (ck_path == NULL)
+	return;
+
+    v[0] = type;
+    v[1] = addr;
+    v[2] = output_size;
+    v[3] = ck_count;
+    ck_add(S_EVTS, v);
+}
+
+
+/*
+ * A symbol was used for the first time in Pass 2. If it was not
+ * set by Pass 2 itself, its value comes from Pass 1, so remember it.
+ */
+void
+ckpt_used(const symbol_t *sym, symbol_t **table)
+{
+    const symbol_t *parent = NULL;
+    uint32_t v[5];
+
+    if ((ck_path == NULL) || (sym->stamp > ck_pstamp))
+	return;
+
+    if (table != NULL)
+	parent = (const symbol_t *)((const char *)table - offsetof(symbol_t, locals));
+
+    v[0] = ck_str(sym->name);
+    v[1] = parent ? ck_str(parent->name) : 0;
+    v[2] = sym->value.v;
+    v[3] = sym->value.t | (sym->kind << 8);
+    v[4] = ck_count;
+    ck_add(S_USED, v);
+}
+
+
+static uint32_t
+ck_misskey(uint32_t n)
+{
+    return (ck_val(ck_sect, S_USED, n - 1, 0) * 31) + ck_val(ck_sect, S_USED, n - 1, 1);
+}
+
+
+/* A symbol was not found in Pass 2, remember that (once.) */
+void
+ckpt_miss(const char *name, symbol_t **table)
+{
+    const symbol_t *parent = NULL;
+    uint32_t v[5], h;
+
+    if (ck_path == NULL)
+	return;
+
+    if (table != NULL)
+	parent = (const symbol_t *)((const char *)table - offsetof(symbol_t, locals));
+
+    v[0] = ck_str(name);
+    v[1] = parent ? ck_str(parent->name) : 0;
+    v[2] = 0;
+    v[3] = USED_MISSING;
+    v[4] = ck_count;
+
+    if (ck_misses >= (ck_nhmiss / 2))
+	ck_hmiss = ck_grow(ck_hmiss, &ck_nhmiss, ck_misskey);
+
+    h = ((v[0] * 31) + v[1]) & (ck_nhmiss - 1);
+    while (ck_hmiss[h] != 0) {
+	if ((ck_val(ck_sect, S_USED, ck_hmiss[h] - 1, 0) == v[0]) &&
+	    (ck_val(ck_sect, S_USED, ck_hmiss[h] - 1, 1) == v[1]))
+		return;
+	h = (h + 1) & (ck_nhmiss - 1);
+    }
+
+    ck_add(S_USED, v);
+    ck_hmiss[h] = ck_sect[S_USED].count;
+    ck_misses++;
+}
+
+
+/* Write the checkpoint file. */
+int
+ckpt_write(void)
+{
+    uint32_t v[2];
+    int i;
+
+    if (ck_path == NULL)
+	return 1;
+
+    sym_track = 0;
+
+    /* If we did not get through all checkpoints, do not keep any. */
+    if (ck_bad || (ck_count < ck_sect[S_CKPT].count)) {
+	(void)remove(ck_path);
+	return 1;
+    }
+
+    ck_sect[S_INFO].count = 0;
+    ck_add(S_INFO, ck_key);
+
+    for (i = 0; i < filenames_len; i++) {
+	v[0] = ck_str(filenames[i]);
+	v[1] = filelines[i];
+	ck_add(S_HIST, v);
+    }
+
+    if (output_buff != NULL)
+	(void)db_append(&ck_sect[S_IMAG], output_buff, output_size);
+
+    return db_write(ck_path, "VCKP", CKPT_VERSION, ck_sect, S_MAX);
+}
+
+
+/* Clean up. */
+void
+ckpt_close(void)
+{
+    if (ck_path == NULL)
+	return;
+
+    db_free(ck_sect, S_MAX);
+
+    if (ck_old != NULL)
+	free(ck_old);
+    ck_old = NULL;
+
+    if (ck_hstr != NULL)
+	free(ck_hstr);
+    ck_hstr = NULL;
+    if (ck_hmiss != NULL)
+	free(ck_hmiss);
+    ck_hmiss = NULL;
+    if (ck_xoff != NULL)
+	free(ck_xoff);
+    ck_xoff = NULL;
+    if (ck_files != NULL)
+	free(ck_files);
+    ck_files = NULL;
+
+    /* We may be used again, in watch mode. */
+    ck_text = NULL;
+    ck_start = 0;
+    ck_again = ck_bad = 0;
+
+    free(ck_path);
+    ck_path = NULL;
+}
@@ -0,0 +1,66 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for incremental reassembly.
+ *
+ * Version:	@(#)ckpt.h	1.0.2	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CKPT_H
+# define CKPT_H
+
+
+extern int	ckpt_init(const char *);
+extern uint32_t	ckpt_start(const char *, size_t, int);
+extern int	ckpt_verify(void);
+extern void	ckpt_restore(int, const char *);
+extern void	ckpt_enter(uint32_t);
+extern void	ckpt_leave(void);
+extern void	ckpt_boundary(const char *, int);
+extern void	ckpt_file(const char *);
+extern void	ckpt_event(int, uint32_t);
+extern void	ckpt_used(const symbol_t *, symbol_t **);
+extern void	ckpt_miss(const char *, symbol_t **);
+extern int	ckpt_write(void);
+extern void	ckpt_close(void);
+
+
+#endif	/*CKPT_H*/
@@ -0,0 +1,289 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Helpers for reading and writing our binary database files.
+ *
+ *		Several of our side files (cross reference, symbols, and
+ *		so on) are meant to be mmap'ed and searched by other tools,
+ *		so they share a simple layout: a header with a directory
+ *		of sections, followed by the section data. All values are
+ *		stored little-endian, and all sections start on an 8-byte
+ *		boundary, so a reader can use them in place:
+ *
+ *		  0	magic[4]	file type, "VXRF" etc
+ *		  4	uint16_t	version of that file type
+ *		  6	uint16_t	number of sections
+ *		  8	section[]	tag[4], offset, count, entry size
+ *
+ *		The section tags and entry layouts are defined by each of
+ *		the file types.
+ *
+ * Version:	@(#)dbfile.c	1.0.3	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "error.h"
+#include "dbfile.h"
+
+
+#define DB_ALIGN(x)	(((x) + 7) & ~7)
+
+
+void
+db_put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+
+void
+db_put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+
+uint16_t
+db_get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+
+uint32_t
+db_get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+	   ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+/* Set up a section with room for count entries of size bytes. */
+uint8_t *
+db_alloc(dbsect_t *sect, const char *tag, uint32_t count, uint32_t size)
+{
+    memcpy(sect->tag, tag, 4);
+    sect->count = count;
+    sect->esize = size;
+    sect->alloc = count * size;
+
+    sect->data = malloc(sect->alloc + 1);
+    if (sect->data == NULL)
+	error(ERR_MEM, tag);
+    memset(sect->data, 0x00, sect->alloc + 1);
+
+    return sect->data;
+}
+
+
+/* Append entries to a section, and return their offset. */
+uint32_t
+db_append(dbsect_t *sect, const void *data, uint32_t len)
+{
+    uint32_t off = sect->count * sect->esize;
+
+    if ((off + len) > sect->alloc) {
+	sect->alloc = (sect->alloc + len) * 2;
+	sect->data = realloc(sect->data, sect->alloc);
+	if (sect->data == NULL)
+		error(ERR_MEM, "database");
+    }
+
+    memcpy(sect->data + off, data, len);
+    sect->count += len / sect->esize;
+
+    return off;
+}
+
+
+/* Add a string to a string table section, and return its offset. */
+uint32_t
+db_str(dbsect_t *sect, const char *str)
+{
+    return db_append(sect, str, (uint32_t)strlen(str) + 1);
+}
+
+
+/* Release the data of all sections. */
+void
+db_free(dbsect_t *sect, int nsect)
+{
+    while (nsect-- > 0) {
+	if (sect->data != NULL)
+		free(sect->data);
+	sect->data = NULL;
+	sect++;
+    }
+}
+
+
+/* Write a database file with the given sections. */
+int
+db_write(const char *fn, const char *magic, int version, const dbsect_t *sect, int nsect)
+{
+    static const uint8_t zeroes[8] = { 0 };
+    uint8_t hdr[8 + 16], *p;
+    uint32_t off, size;
+    FILE *fp;
+    int i;
+
+    if ((fp = fopen(fn, "wb")) == NULL)
+	return 0;
+
+    /* Write the file header. */
+    memcpy(hdr, magic, 4);
+    db_put16(hdr + 4, version);
+    db_put16(hdr + 6, nsect);
+    (void)fwrite(hdr, 1, 8, fp);
+
+    /* Write the section directory. */
+    off = DB_ALIGN(8 + (16 * nsect));
+    for (i = 0; i < nsect; i++) {
+	p = hdr;
+	memcpy(p, sect[i].tag, 4);
+	db_put32(p + 4, off);
+	db_put32(p + 8, sect[i].count);
+	db_put32(p + 12, sect[i].esize);
+	(void)fwrite(hdr, 1, 16, fp);
+
+	off += DB_ALIGN(sect[i].count * sect[i].esize);
+    }
+
+    /* And then the data of the sections. */
+    size = 8 + (16 * nsect);
+    (void)fwrite(zeroes, 1, DB_ALIGN(size) - size, fp);
+    for (i = 0; i < nsect; i++) {
+	size = sect[i].count * sect[i].esize;
+	if (size > 0)
+		(void)fwrite(sect[i].data, 1, size, fp);
+	(void)fwrite(zeroes, 1, DB_ALIGN(size) - size, fp);
+    }
+
+    if (ferror(fp)) {
+	(void)fclose(fp);
+	(void)remove(fn);
+	return 0;
+    }
+
+    (void)fclose(fp);
+
+    return 1;
+}
+
+
+/*
+ * Read a database file, and look up the sections whose tags are
+ * set in sect[]. Their data points into the returned buffer, which
+ * the caller must free. Returns NULL if the file is not valid, or
+ * if any of the sections are missing.
+ */
+uint8_t *
+db_read(const char *fn, const char *magic, int version, dbsect_t *sect, int nsect)
+{
+    uint8_t *buf, *p;
+    uint32_t off, count, esize, len;
+    long size;
+    FILE *fp;
+    int i, n;
+
+    if ((fp = fopen(fn, "rb")) == NULL)
+	return NULL;
+
+    (void)fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    (void)fseek(fp, 0, SEEK_SET);
+    if (size < 8 || (buf = malloc(size)) == NULL) {
+	(void)fclose(fp);
+	return NULL;
+    }
+    if (fread(buf, 1, size, fp) != (size_t)size) {
+	(void)fclose(fp);
+	free(buf);
+	return NULL;
+    }
+    (void)fclose(fp);
+    len = (uint32_t)size;
+
+    /* Check the file header. */
+    n = db_get16(buf + 6);
+    if (memcmp(buf, magic, 4) || (db_get16(buf + 4) != version) ||
+	((uint32_t)(8 + (16 * n)) > len)) {
+	free(buf);
+	return NULL;
+    }
+
+    for (i = 0; i < nsect; i++) {
+	sect[i].data = NULL;
+
+	for (p = buf + 8; p < (buf + 8 + (16 * n)); p += 16) {
+		if (memcmp(p, sect[i].tag, 4))
+			continue;
+
+		off = db_get32(p + 4);
+		count = db_get32(p + 8);
+		esize = db_get32(p + 12);
+		if ((off > len) || (esize == 0) ||
+		    (count > ((len - off) / esize)))
+			break;
+
+		sect[i].count = count;
+		sect[i].esize = esize;
+		sect[i].alloc = 0;
+		sect[i].data = buf + off;
+		break;
+	}
+
+	if (sect[i].data == NULL) {
+		free(buf);
+		return NULL;
+	}
+    }
+
+    return buf;
+}
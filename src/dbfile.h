@@ -0,0 +1,73 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for the binary database files.
+ *
+ * Version:	@(#)dbfile.h	1.0.3	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef DBFILE_H
+# define DBFILE_H
+
+
+/* One section of a database file. */
+typedef struct dbsect {
+    char	tag[4];			// section name
+    uint32_t	count;			// number of entries
+    uint32_t	esize;			// size of one entry
+    uint32_t	alloc;			// allocated size of data
+    uint8_t	*data;
+} dbsect_t;
+
+
+extern void	db_put16(uint8_t *, uint16_t);
+extern void	db_put32(uint8_t *, uint32_t);
+extern uint16_t	db_get16(const uint8_t *);
+extern uint32_t	db_get32(const uint8_t *);
+extern uint8_t	*db_alloc(dbsect_t *, const char *, uint32_t, uint32_t);
+extern uint32_t	db_append(dbsect_t *, const void *, uint32_t);
+extern uint32_t	db_str(dbsect_t *, const char *);
+extern void	db_free(dbsect_t *, int);
+extern int	db_write(const char *, const char *, int, const dbsect_t *, int);
+extern uint8_t	*db_read(const char *, const char *, int, dbsect_t *, int);
+
+
+#endif	/*DBFILE_H*/
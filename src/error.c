@@ -8,7 +8,7 @@
  *
  *		Handle any errors.
  *
- * Version:	@(#)error.c	1.0.8	2023/09/26
+ * Version:	@(#)error.c	1.0.15	2026/10/18
  *
  * Authors:	Fred N. van Kempen, <waltje@varcem.com>
  *		Bernd Bckmann, <https://codeberg.org/boeckmann/asm6502>
@@ -60,7 +60,14 @@
 #include "error.h"
 
 
-int		errors;
+typedef struct diag {
+    char	*text;
+    struct diag	*next;
+} diag_t;
+
+
+int		errors,
+		error_max = ERROR_MAX;	// stop after this many errors
 jmp_buf		error_jmp;
 char		error_hint[128];
 const char	*err_msgs[ERR_MAXERR] = {
@@ -96,10 +103,8 @@ const char	*err_msgs[ERR_MAXERR] = {
     "not enough formal parameters for macro",
     "MACRO before ENDM",
     "ENDM before MACRO",
-    "IF nesting too deep",
     "ELSE without IF",
     "ENDIF without IF",
-    "too many REPEAT levels",
     "ENDREP without REPEAT",
     "REPEAT without ENDREP",
     "symbol already defined as label",
@@ -116,10 +121,23 @@ const char	*err_msgs[ERR_MAXERR] = {
     "malformed character constant",
     "string too long",
     "string expected",
-    "maximum number of include files reached"
+    "ENDCYCLES without CYCLES",
+    "CYCLES without ENDCYCLES",
+    "no cycle counts for this processor",
+    "cycle budget exceeded",
+    "no zero page segment defined",
+    "zero page segments are full",
+    "ENDPAGESAFE without PAGESAFE",
+    "PAGESAFE without ENDPAGESAFE",
+    "block does not fit in a page",
+    "invalid use of a relocatable value",
+    "only valid in an object file (-r)",
+    "not valid in an object file (-r)",
+    "checksum does not converge"
 };
 
-
+static diag_t	*diags = NULL,		// recorded diagnostics
+		*diags_last = NULL;
 
 
 /* Display error message and abort action. */
@@ -136,3 +154,61 @@ error(int err, const char *msg)
     longjmp(error_jmp, err);
     /*NOTREACHED*/
 }
+
+
+/*
+ * Record a diagnostic for later.
+ *
+ * Rather than aborting all processing on the first error, the parser
+ * records each error with its location, skips to the next line and
+ * carries on. The collected diagnostics are then reported at the end
+ * of the pass, in the order in which they were found.
+ */
+void
+error_log(const char *fn, int line, const char *msg)
+{
+    char temp[2048];
+    diag_t *d;
+
+    sprintf(temp, "%.1024s:%i: error: %.512s", fn, line, msg);
+    if (error_hint[0] != '\0')
+	sprintf(temp + strlen(temp), " (%s)", error_hint);
+
+    d = malloc(sizeof(diag_t));
+    if (d != NULL)
+	d->text = strdup(temp);
+    if ((d == NULL) || (d->text == NULL)) {
+	/* Oh well, just show it now. */
+	printf("%s\n", temp);
+	if (d != NULL)
+		free(d);
+	return;
+    }
+    d->next = NULL;
+
+    if (diags_last != NULL)
+	diags_last->next = d;
+    else
+	diags = d;
+    diags_last = d;
+}
+
+
+/* Report (and forget) all recorded diagnostics. */
+int
+error_report(void)
+{
+    diag_t *d, *next;
+    int i = 0;
+
+    for (d = diags; d != NULL; d = next) {
+	printf("%s\n", d->text);
+	next = d->next;
+	free(d->text);
+	free(d);
+	i++;
+    }
+    diags = diags_last = NULL;
+
+    return i;
+}
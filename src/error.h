@@ -8,7 +8,7 @@
  *
  *		Define the error codes.
  *
- * Version:	@(#)error.h	1.0.7	2023/09/26
+ * Version:	@(#)error.h	1.0.14	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -48,6 +48,8 @@
 # define ERROR_H
 
 
+#define ERROR_MAX	20		// default max #errors per pass
+
 typedef enum errors_e {
     ERR_USER = 1,		// user-specified error
     ERR_ZERO,			// "division by zero"
@@ -80,10 +82,8 @@ typedef enum errors_e {
     ERR_MACFRM,			// "not enough formal params"
     ERR_MACRO,			// "MACRO before ENDM",
     ERR_ENDM,			// "ENDM before MACRO",
-    ERR_IF,			// "IF nesting too deep"
     ERR_ELSE,			// "ELSE without IF"
     ERR_ENDIF,			// "ENDIF without IF"
-    ERR_MAX_REP,		// "too many REPEAT levels"
     ERR_REPEAT,			// "ENDREP without REPEAT"
     ERR_ENDREP,			// "REPEAT without ENDREP"
     ERR_LBLREDEF,		// "symbol already defined as label"
@@ -100,14 +100,27 @@ typedef enum errors_e {
     ERR_CHR,			// "malformed character constant"
     ERR_STRLEN,			// "string too long"
     ERR_STR,			// "string expected"
-    ERR_MAXINC,			// "maximum number of include files reached"
+    ERR_CYCLES,			// "ENDCYCLES without CYCLES"
+    ERR_ENDCYC,			// "CYCLES without ENDCYCLES"
+    ERR_NOCYC,			// "no cycle counts for this processor"
+    ERR_BUDGET,			// "cycle budget exceeded"
+    ERR_NOZPSEG,		// "no zero page segment defined"
+    ERR_ZPFULL,			// "zero page segments are full"
+    ERR_PAGE,			// "ENDPAGESAFE without PAGESAFE"
+    ERR_ENDPAGE,		// "PAGESAFE without ENDPAGESAFE"
+    ERR_PAGESIZE,		// "block does not fit in a page"
+    ERR_RELOC,			// "invalid use of a relocatable value"
+    ERR_OBJONLY,		// "only valid in an object file"
+    ERR_NOTOBJ,			// "not valid in an object file"
+    ERR_CONVERGE,		// "checksum does not converge"
 
     ERR_MAXERR			// last generic error
 } errors_t;
 
 
 /* Global variables. */
-extern int		errors;
+extern int		errors,
+			error_max;
 #ifdef HAVE_SETJMP_H
 extern jmp_buf		error_jmp;
 #endif
@@ -117,6 +130,8 @@ extern const char	*err_msgs[];
 
 /* Functions. */
 extern void	error(int, const char *);
+extern void	error_log(const char *, int, const char *);
+extern int	error_report(void);
 
 
 #endif	/*ERROR_H*/
@@ -8,7 +8,7 @@
  *
  *		General expression handler.
  *
- * Version:	@(#)expr.c	1.0.14	2023/09/28
+ * Version:	@(#)expr.c	1.0.16	2026/10/18
  *
  * Authors:	Fred N. van Kempen, <waltje@varcem.com>
  *		Bernd Bckmann, <https://codeberg.org/boeckmann/asm6502>
@@ -52,6 +52,7 @@
 #include <ctype.h>
 #include "global.h"
 #include "error.h"
+#include "xref.h"
 
 
 #ifndef isxdigit
@@ -267,6 +268,7 @@ dot_label:
 			strcat(id, id2);
 			sym = sym_lookup(id, NULL);
 			if (sym != NULL) {
+				xref_add(sym, NULL, XREF_READ);
 				res = sym->value;
 			} else {
 				res.v = 0;
@@ -276,6 +278,7 @@ dot_label:
 			/* Current program counter. */
 			res.v = pc;
 			res.t = TYPE_WORD | VALUE_DEFINED;
+			res.r = sect;
 		}
 	}
     } else if (**p == '@') {
@@ -288,6 +291,7 @@ dot_label:
 		nident(p, id);
 		sym = sym_lookup(id, &current_label->locals);
 		if (sym != NULL) {
+			xref_add(sym, current_label, XREF_READ);
 			res = sym->value;
 		} else {
 			res.v = 0;
@@ -298,6 +302,7 @@ dot_label:
 program_counter:
 		res.v = pc;
 		res.t = TYPE_WORD | VALUE_DEFINED;
+		res.r = sect;
 	}
     } else if (**p == '*') {
 	/* Current program counter. */
@@ -372,6 +377,7 @@ no_func:
 			}
 			sym->value.v = 0;
 		}
+		xref_add(sym, NULL, XREF_READ);
 		res = sym->value;
 	}
     } else {
@@ -432,6 +438,10 @@ product(char **p)
 
 	n2 = primary(p, 1);
 
+	/* None of these make sense for relocatable values. */
+	if ((res.r | n2.r) && (op != '?'))
+		error(ERR_RELOC, NULL);
+
 	switch (op) {
 		case '*':	// multiply
 			res.v = (uint32_t)(res.v * n2.v);
@@ -505,6 +515,8 @@ term(char **p)
 	/* Unary minus. */
 	(*p)++;
 	res = product(p);
+	if (res.r != RELOC_NONE)
+		error(ERR_RELOC, NULL);
 	res.v = -res.v;
     } else {
 	/* Unary plus. */
@@ -529,13 +541,26 @@ term(char **p)
 
 	n2 = product(p);
 
+	/*
+	 * Relocatable values can have an offset added to them, and
+	 * the difference of two in the same section is absolute.
+	 */
+	if ((res.r | n2.r) &&
+	    (RELOC_PART(res) || RELOC_PART(n2) || (op == '|') || (op == '^') ||
+	     ((op == '+') && res.r && n2.r) ||
+	     ((op == '-') && n2.r && (n2.r != res.r))))
+		error(ERR_RELOC, NULL);
+
 	switch (op) {
 		case '+':	// add
 			res.v = res.v + n2.v;
+			res.r |= n2.r;
 			break;
 
 		case '-':	// subtract
 			res.v = res.v - n2.v;
+			if (n2.r != RELOC_NONE)
+				res.r = RELOC_NONE;
 			break;
 
 		case '|':	// bitwise OR
@@ -636,6 +661,7 @@ compare(char **p)
 
 	/* Since we are dealing with logical operators.. */
 	res.v = !!res.v;
+	res.r = RELOC_NONE;
 
 	INFER_DEFINED(res, n2);
 	SET_TYPE(res, TYPE_BYTE);
@@ -681,15 +707,11 @@ expr(char **p)
     if (op == '>') {
 	/* High-byte (MSB) operator. */
 	(*p)++;
-	res = compare(p);
-	res.v = (res.v >> 8) & 0xff;
-	SET_TYPE(res, TYPE_BYTE);
+	res = value_hi(compare(p));
     } else if (op == '<') {
 	/* Low-byte (LSB) operator. */
 	(*p)++;
-	res = compare(p);
-	res.v = res.v & 0xff;
-	SET_TYPE(res, TYPE_BYTE);
+	res = value_lo(compare(p));
     } else if ((op == '!') || starts_with(*p, "NOT ")) {
 	/* Logical NOT operators. */
 	if (op == '!')
@@ -697,11 +719,15 @@ expr(char **p)
 	else
 		*p += 4;
 	res = term(p);
+	if (res.r != RELOC_NONE)
+		error(ERR_RELOC, NULL);
 	res.v = !res.v;
     } else if (op == '~') {
 	/* Bitwise NOT (complement) operator. */
 	(*p)++;
 	res = term(p);
+	if (res.r != RELOC_NONE)
+		error(ERR_RELOC, NULL);
 	res.v = ~res.v;
     } else if (starts_with(*p, "[b]")) {
 	/* Lossless conversion to byte. */
@@ -738,6 +764,8 @@ value_t
 to_byte(value_t v, int force)
 {
     if (force) {
+	if ((v.r != RELOC_NONE) && !RELOC_PART(v))
+		return value_lo(v);
 	v.v &= 0xff;
     } else if (DEFINED(v) && (v.v > 0xff))
 	error(ERR_RNG_BYTE, NULL);
@@ -763,6 +791,43 @@ to_word(value_t v, int force)
 }
 
 
+/* Take the low byte of a value. */
+value_t
+value_lo(value_t v)
+{
+    if (RELOC_PART(v))
+	error(ERR_RELOC, NULL);
+    if (v.r != RELOC_NONE)
+	v.r |= RELOC_LO;
+
+    v.v &= 0xff;
+    SET_TYPE(v, TYPE_BYTE);
+
+    return v;
+}
+
+
+/*
+ * Take the high byte of a value. For a relocatable one, we keep
+ * the low byte as well, as we need it for the carry.
+ */
+value_t
+value_hi(value_t v)
+{
+    if (RELOC_PART(v))
+	error(ERR_RELOC, NULL);
+    if (v.r != RELOC_NONE) {
+	v.r |= RELOC_HI;
+	v.rl = v.v & 0xff;
+    }
+
+    v.v = (v.v >> 8) & 0xff;
+    SET_TYPE(v, TYPE_BYTE);
+
+    return v;
+}
+
+
 /* Return the type of a value. */
 char
 value_type(value_t v)
@@ -8,7 +8,7 @@
  *
  *		Handle all functions.
  *
- * Version:	@(#)func.c	1.0.5	2023/08/20
+ * Version:	@(#)func.c	1.0.9	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -50,6 +50,8 @@
 #include <ctype.h>
 #include "global.h"
 #include "error.h"
+#include "xref.h"
+#include "jobs.h"
 
 
 typedef struct pseudo {
@@ -58,6 +60,11 @@ typedef struct pseudo {
 } func_t;
 
 
+static uint16_t	crc16_tab[8][256];	// CRC-16/CCITT, slicing-by-8
+static uint32_t	crc32_tab[8][256];	// CRC-32 (IEEE), slicing-by-8
+static int	crc_done;
+
+
 /* Implement the ".def(symbol)" function. */
 static value_t
 do_def(char **p)
@@ -82,6 +89,7 @@ do_def(char **p)
     if (IS_END(**p))
 	error(ERR_EOL, NULL);
 
+    xref_add(sym, NULL, XREF_READ);
     res = sym->value;
 
     return res;
@@ -98,7 +106,7 @@ do_high(char **p)
     if (IS_END(**p))
 	error(ERR_EOL, NULL);
 
-    res.v = (res.v >> 8) & 0xff;
+    res = value_hi(res);
     res.t = TYPE_BYTE;
     SET_DEFINED(res);
 
@@ -116,7 +124,7 @@ do_low(char **p)
     if (IS_END(**p))
 	error(ERR_EOL, NULL);
 
-    res.v = (res.v & 0xff);
+    res = value_lo(res);
     res.t = TYPE_BYTE;
     SET_DEFINED(res);
 
@@ -124,13 +132,89 @@ do_low(char **p)
 }
 
 
-/* Implement the ".sum(startaddr,numbytes)" function. */
-static value_t
-do_sum(char **p)
+/* Build the CRC tables, the first time we need them. */
+static void
+crc_init(void)
+{
+    uint32_t c32;
+    uint16_t c16;
+    int i, k;
+
+    for (i = 0; i < 256; i++) {
+	c16 = (uint16_t)(i << 8);
+	c32 = (uint32_t)i;
+	for (k = 0; k < 8; k++) {
+		c16 = (c16 & 0x8000) ? (uint16_t)((c16 << 1) ^ 0x1021) : (uint16_t)(c16 << 1);
+		c32 = (c32 & 1) ? ((c32 >> 1) ^ 0xedb88320) : (c32 >> 1);
+	}
+	crc16_tab[0][i] = c16;
+	crc32_tab[0][i] = c32;
+    }
+
+    /* Each next table does one more byte of zeroes. */
+    for (k = 1; k < 8; k++) {
+	for (i = 0; i < 256; i++) {
+		c16 = crc16_tab[k - 1][i];
+		crc16_tab[k][i] = (uint16_t)((c16 << 8) ^ crc16_tab[0][c16 >> 8]);
+		c32 = crc32_tab[k - 1][i];
+		crc32_tab[k][i] = (c32 >> 8) ^ crc32_tab[0][c32 & 0xff];
+	}
+    }
+
+    crc_done = 1;
+}
+
+
+/* Calculate the CRC-16/CCITT (init 0xffff) of a block of data. */
+static uint16_t
+crc16(const uint8_t *p, uint32_t len)
+{
+    uint16_t crc = 0xffff, c;
+
+    for (; len >= 8; len -= 8, p += 8) {
+	c = crc ^ (uint16_t)((p[0] << 8) | p[1]);
+	crc = crc16_tab[7][c >> 8] ^ crc16_tab[6][c & 0xff] ^
+	      crc16_tab[5][p[2]] ^ crc16_tab[4][p[3]] ^
+	      crc16_tab[3][p[4]] ^ crc16_tab[2][p[5]] ^
+	      crc16_tab[1][p[6]] ^ crc16_tab[0][p[7]];
+    }
+    while (len-- > 0)
+	crc = (uint16_t)(crc << 8) ^ crc16_tab[0][(crc >> 8) ^ *p++];
+
+    return crc;
+}
+
+
+/* Calculate the CRC-32 (as used by ZIP) of a block of data. */
+static uint32_t
+crc32(const uint8_t *p, uint32_t len)
+{
+    uint32_t crc = 0xffffffff, lo, hi;
+
+    for (; len >= 8; len -= 8, p += 8) {
+	lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+	hi = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+	crc = crc32_tab[7][lo & 0xff] ^ crc32_tab[6][(lo >> 8) & 0xff] ^
+	      crc32_tab[5][(lo >> 16) & 0xff] ^ crc32_tab[4][lo >> 24] ^
+	      crc32_tab[3][hi & 0xff] ^ crc32_tab[2][(hi >> 8) & 0xff] ^
+	      crc32_tab[1][(hi >> 16) & 0xff] ^ crc32_tab[0][hi >> 24];
+    }
+    while (len-- > 0)
+	crc = (crc >> 8) ^ crc32_tab[0][(crc ^ *p++) & 0xff];
+
+    return crc ^ 0xffffffff;
+}
+
+
+/* Get the (startaddr,numbytes) arguments of the checksum functions. */
+static int
+get_range(char **p, uint32_t *addr, uint32_t *len)
 {
-    value_t res = { 0 };
     value_t v1, v2;
 
+    /* A part of a parallel Pass 2 would not have all the code. */
+    jobs_cancel();
+
     v1 = expr(p);
 
     skip_white(p);
@@ -143,16 +227,105 @@ do_sum(char **p)
 
     v2 = expr(p);
 
-    /*
-     * Calculate the (regular) checksum of the code bytes
-     * between v1 (inclusive) and v2 (exclusive), using a
-     * normal addition.
-     */
-    if (output_buff != NULL) {
-	v2.v += v1.v;
-	while (v1.v < v2.v)
-		res.v += output_buff[v1.v++ - org];
-    }
+    *addr = v1.v;
+    *len = v2.v;
+
+    if (DEFINED(v1) && DEFINED(v2))
+	return 1;
+
+    /* We need another round to find out. */
+    output_later();
+
+    return 0;
+}
+
+
+/*
+ * Check if we have the code a checksum is taken of. In Pass 1, it
+ * may not be there (yet), so the value is undefined for now. Once
+ * we are in Pass 2, it really should be there.
+ */
+static const uint8_t *
+get_data(uint32_t addr, uint32_t len)
+{
+    const uint8_t *ptr;
+    int pass = (output_buff != NULL) ? 2 : 1;
+
+    ptr = output_data(addr, len, pass);
+    if ((ptr == NULL) && (pass == 2))
+	error(ERR_RNG, NULL);
+
+    return ptr;
+}
+
+
+/*
+ * Implement the ".sum(startaddr,numbytes)" function.
+ *
+ * This is the (regular) checksum of the code bytes from
+ * startaddr, using a normal addition. The output module
+ * keeps running sums, so this does not depend on the size
+ * of the block.
+ */
+static value_t
+do_sum(char **p)
+{
+    value_t res = { 0 };
+    uint32_t addr, len;
+    int pass = (output_buff != NULL) ? 2 : 1;
+
+    if (! get_range(p, &addr, &len))
+	return res;
+
+    if (output_sum(addr, len, pass, &res.v))
+	SET_DEFINED(res);
+    else if (pass == 2)
+	error(ERR_RNG, NULL);
+
+    return res;
+}
+
+
+/* Implement the ".crc16(startaddr,numbytes)" function. */
+static value_t
+do_crc16(char **p)
+{
+    value_t res = { 0 };
+    const uint8_t *ptr;
+    uint32_t addr, len;
+
+    if (! get_range(p, &addr, &len))
+	return res;
+    if ((ptr = get_data(addr, len)) == NULL)
+	return res;
+
+    if (! crc_done)
+	crc_init();
+    res.v = crc16(ptr, len);
+    res.t = TYPE_WORD;
+    SET_DEFINED(res);
+
+    return res;
+}
+
+
+/* Implement the ".crc32(startaddr,numbytes)" function. */
+static value_t
+do_crc32(char **p)
+{
+    value_t res = { 0 };
+    const uint8_t *ptr;
+    uint32_t addr, len;
+
+    if (! get_range(p, &addr, &len))
+	return res;
+    if ((ptr = get_data(addr, len)) == NULL)
+	return res;
+
+    if (! crc_done)
+	crc_init();
+    res.v = crc32(ptr, len);
+    res.t = TYPE_DWORD;
     SET_DEFINED(res);
 
     return res;
@@ -160,6 +333,8 @@ do_sum(char **p)
 
 
 static const func_t functions[] = {
+  { "CRC16",	do_crc16	},
+  { "CRC32",	do_crc32	},
   { "DEF",	do_def		},
   { "DEFINED",	do_def		},
   { "H",	do_high		},
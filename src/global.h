@@ -8,7 +8,7 @@
  *
  *		Definitions for the entire application.
  *
- * Version:	@(#)global.h	1.0.16	2023/09/28
+ * Version:	@(#)global.h	1.0.34	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -70,13 +70,11 @@
 #define IS_IDENT(c)	(((c) == DOT_CHAR) || ((c) == '_'))
 #define islabel(c)	(isalpha((c)) || ((c) == '_'))
 
-#define MAX_FILENAMES	256 + 1		// maximum include files
-#define MAX_IFLEVEL	16		// maximum depth of IF levels
-#define MAX_RPTLEVEL	8		// maximum depth of REPEAT levels
+#define MAX_RELAX	32		// maximum rounds of branch relaxation
 #define RADIX_DEFAULT	10		// default radix is decimal
 
-#define ID_LEN		32		// max #characters in identifiers
-#define STR_LEN		128		// max #characters in string literals
+#define ID_LEN		256		// max #characters in identifiers
+#define STR_LEN		1024		// max #characters in string literals
 
 #define MAXINT(a,b) (((b) >= (a)) ? (b) : (a))
 
@@ -90,8 +88,19 @@ typedef struct value {
 #define TYPE_WORD	0x02
 #define TYPE_DWORD	0x04
 #define TYPE_MASK	0x0f
+    uint8_t	rl;			// low byte, when r has RELOC_HI
+    uint16_t	r;			// what it is relative to (-r)
+#define RELOC_NONE	0x0000		// absolute value
+#define RELOC_INDEX	0x1fff		// section (or extern) number
+#define RELOC_EXT	0x2000		// relative to an extern symbol
+#define RELOC_LO	0x4000		// low byte of it
+#define RELOC_HI	0x8000		// high byte of it
 } value_t;
 
+/* For relocatable values, in object mode. */
+#define RELOC(x) ((x).r & (RELOC_EXT | RELOC_INDEX))
+#define RELOC_PART(x) ((x).r & (RELOC_LO | RELOC_HI))
+
 /* For the value-specific directives. */
 #define VALUE_DEFINED 0x80
 #define DEFINED(x) (((x).t & VALUE_DEFINED) != 0)
@@ -113,7 +122,7 @@ typedef struct value {
 
 /* Data type for storing symbols (labels and variables.) */
 typedef struct sym_ {
-    char	name[ID_LEN];
+    char	*name;			// (stored right after it)
     value_t	value;
     int8_t	kind;			// is it a label or a variable?
 #define KIND_LBL 1
@@ -121,8 +130,11 @@ typedef struct sym_ {
 #define KIND_MAC 3
     int8_t	subkind;
     uint8_t	pass;			// defined in which pass?
-    short	filenr;			// in which file was it defined?
+    int		filenr;			// in which file was it defined?
     int		linenr;			// on what line in that file?
+    uint32_t	stamp;			// when was it last changed?
+    int		used;			// used in Pass 2 yet?
+    uint32_t	refs;			// how often it was used
     struct sym_	*next;
     struct sym_	*locals;		// local subdefinitions
 } symbol_t;
@@ -139,26 +151,32 @@ typedef struct repeat_info {
     int		line;
     char	*pos;
     unsigned	count;
-    int		repeating;
 } repeat_t;
 
 
 /* Global variables. */
-extern int		opt_d,
+extern int		opt_a,
+			opt_c,
+			opt_d,
 			opt_C,
 			opt_F,
 			opt_P,
+			opt_O,
 			opt_q,
-			opt_v;
+			opt_r,
+			opt_R,
+			opt_v,
+			opt_w;
 extern char		myname[],
 			version[];
 
 extern char		*text;
-extern int		text_len;
+extern size_t		text_len;
 
 extern uint32_t		org,
 			pc,
 			sa;
+extern uint16_t		sect;
 extern int		line,
 			newline;
 extern int8_t		radix,
@@ -166,17 +184,24 @@ extern int8_t		radix,
 			auto_local;
 extern symbol_t		*current_label;
 extern const struct pseudo *psop;
-extern int8_t		iflevel,
-			ifstate,
+extern int		iflevel;
+extern int8_t		ifstate,
 			newifstate,
-			ifstack[];
-extern int8_t		rptlevel,
-			rptstate,
+			*ifstack;
+extern int		rptlevel;
+extern int8_t		rptstate,
 			newrptstate;
-extern repeat_t		rptstack[];
-extern char		*filenames[];
-extern int		filelines[];
-extern int8_t		filenames_idx,
+extern repeat_t		*rptstack;
+extern int		cyclevel;
+extern int		cyc_line[];
+extern uint32_t		cyc_total[],
+			cyc_base[];
+extern int		relax_iter;
+extern uint32_t		relax_moved;
+extern int8_t		relax_line;
+extern char		**filenames;
+extern int		*filelines;
+extern int		filenames_idx,
 			filenames_len;
 
 extern uint32_t		output_size;
@@ -196,12 +221,26 @@ extern int		macstate,
 # define strcasecmp _stricmp
 #endif
 
+#ifdef USE_STATS
+/* Count all allocations, for the statistics. */
+# define malloc(n)	stats_malloc(n)
+# define realloc(p, n)	stats_realloc((p), (n))
+# define strdup(s)	stats_strdup(s)
+
+extern void		*stats_malloc(size_t);
+extern void		*stats_realloc(void *, size_t);
+extern char		*stats_strdup(const char *);
+#endif
+
 
 /* Functions. */
 #ifdef _DEBUG
 extern char		*dumpline(const char *p);
 #endif
 extern int		pass(char **, int);
+extern void		*stack_grow(void *, int *, int, size_t);
+extern void		if_push(int8_t);
+extern void		rpt_room(void);
 extern int		is_end(char);
 extern void		skip_eol(char **);
 extern void		skip_white(char **);
@@ -213,18 +252,24 @@ extern void		ident_upcase(char **, char *);
 extern void		nident(char **, char *);
 extern void		nident_upcase(char **, char *);
 
+extern uint32_t		sym_stamp;
+extern int		sym_track;
 extern symbol_t		*sym_table(void);
 extern char		sym_type(const symbol_t *);
 extern symbol_t		*sym_lookup(const char *, symbol_t **);
 extern void		sym_free(symbol_t **);
+extern symbol_t		*sym_add(const char *, symbol_t **);
 extern symbol_t		*sym_aquire(const char *, symbol_t **);
 extern symbol_t		*define_label(const char *, uint32_t, symbol_t *, int, int);
 extern void		define_variable(const char *, value_t, int);
 extern const char	*sym_print(const symbol_t *);
+extern int		sym_export(const char *);
 
 extern value_t		expr(char **);
 extern value_t		to_byte(value_t, int);
 extern value_t		to_word(value_t, int);
+extern value_t		value_lo(value_t);
+extern value_t		value_hi(value_t);
 extern char		value_type(value_t);
 extern int		value_format(char **);
 extern char		*value_print(value_t);
@@ -233,21 +278,43 @@ extern char		*value_print_format(value_t, int);
 extern value_t		function(const char *, char **);
 
 extern size_t		file_size(const char *);
-extern int		file_read_buf(const char *, char *);
+extern size_t		file_read_buf(const char *, char *);
 extern int		file_read(const char *, char **, size_t *);
-extern void		file_add(const char *, int, const char *, size_t);
+extern int		file_add(const char *, int, const char *, size_t);
+extern int		file_room(int);
+extern void		file_cache_init(void);
+extern void		file_uncache(const char *);
+extern int		file_buffer(char *);
+extern void		file_drop(char *);
+extern void		file_release(void);
+extern void		file_rewind(char **, int);
+extern int		file_dep_init(const char *);
+extern int		file_dep(const char *);
+extern int		file_dep_write(const char *);
+extern void		file_dep_close(void);
 
 extern int		output_open(const char *);
+extern const char	*output_name(void);
 extern int		output_close(int);
+extern void		output_state(uint32_t *, int *);
+extern void		output_restore(uint32_t, int);
 extern void		output_reset(void);
 extern void		output_addr(uint32_t, int);
 extern void		output_start(uint32_t, int);
+extern void		output_preload(const uint8_t *, uint32_t, int);
+extern const uint8_t	*output_data(uint32_t, uint32_t, int);
+extern int		output_sum(uint32_t, uint32_t, int, uint32_t *);
+extern void		output_later(void);
+extern void		output_round(void);
 extern void		emit_str(const char *, int, int);
 extern void		emit_byte(uint8_t, int);
 extern void		emit_word(uint16_t, int);
 extern void		emit_word_be(uint16_t, int);
 extern void		emit_dword(uint32_t, int);
 extern void		emit_dword_be(uint32_t, int);
+extern void		emit_undo(uint32_t, int);
+extern void		emit_reloc(value_t, int, int);
+extern void		emit_relative(value_t);
 
 extern void		list_set_head(const char *);
 extern void		list_set_head_sub(const char *);
@@ -258,12 +325,20 @@ extern void		list_line(const char *);
 extern void		list_page(const char *, const char *);
 extern void		list_save(uint32_t);
 extern void		list_symbols(void);
+extern void		list_xref(void);
+extern void		list_zpage(void);
+extern void		list_pages(void);
 
 extern void		macro_reset(void);
 extern int		macro_ok(const char *);
 extern void		macro_add(const char *);
 extern void		macro_exec(const char *, char **, char **, int);
 extern void		macro_close(char **);
+extern const char	*macro_current(const char *, int *);
+extern int		macro_find(const char *, const char **, const char **);
+extern void		macro_define(const char *, const char *, const char *);
+extern int		macro_count(void);
+extern int		macro_get(int, const char **, const char **, const char **);
 extern char		*do_macro(char **, int);
 extern char		*do_endm(char **, int);
 
@@ -11,7 +11,7 @@
  *		the "fread" function on text files) to properly read data
  *		from them when opened as a text file.
  *
- * Version:	@(#)input.c	1.0.5	2023/06/20
+ * Version:	@(#)input.c	1.0.13	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -47,12 +47,16 @@
  * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include "global.h"
 #include "error.h"
+#include "prefetch.h"
+#include "watch.h"
 
 
 /*
@@ -63,29 +67,137 @@
  * marks the end of the assembler text.
  */
 char	*text = NULL;			// holds the assembler source
-int	text_len;			// total length of the source
+size_t	text_len;			// total length of the source
 
 /*
  * The filenames variable stores the filenames of all included files.
  * When parsing the source the filenames_idx variable is incremented
  * when en EOF character is encountered, and the line counter variable is
  * set to filelines[filenames_idx], current filename is set to
- * filenames[filenames_idx].
+ * filenames[filenames_idx]. The tables grow as needed.
  */
-char	*filenames[MAX_FILENAMES];
-int	filelines[MAX_FILENAMES];
-int8_t	filenames_idx,
+char	**filenames;
+int	*filelines;
+int	filenames_idx,
 	filenames_len;
+static int	file_max;		// size of the tables
+
+/*
+ * If requested, we keep a list of all files we actually opened
+ * (the source files, all included files, and all binary blobs)
+ * so we can tell tools like make(1) what the output depends on.
+ */
+static char	*dep_path;		// name of the dependency file
+static char	**dep_names;		// list of files opened
+static int	dep_num,
+		dep_max;
+
+/*
+ * In watch mode, we keep the (cooked) text of all the files we
+ * read, so we do not have to read them again if they did not
+ * change since the last time.
+ */
+typedef struct fcache {
+    struct fcache *next;
+    char	*name;
+    char	*text;			// cooked contents,
+    size_t	size;			//  and their size
+    time_t	mtime;			// state of the file when read
+    long	fsize;
+} fcache_t;
+
+static int	cache_on;		// keep the file contents
+static fcache_t	*cache_list;
+
+/* All the source text buffers we allocated. */
+static char	**text_bufs;
+static int	text_num,
+		text_max;
+
+
+/* Find a file in the cache, and (re)load it if needed. */
+static fcache_t *
+file_cached(const char *fn)
+{
+    struct stat st;
+    fcache_t *fc;
+    char *ptr, *end;
+    FILE *fp;
+    int c;
+
+    if (!cache_on || (stat(fn, &st) != 0))
+	return NULL;
+
+    for (fc = cache_list; fc != NULL; fc = fc->next)
+	if (! strcmp(fc->name, fn))
+		break;
+
+    if (fc == NULL) {
+	fc = malloc(sizeof(fcache_t));
+	if (fc == NULL)
+		return NULL;
+	memset(fc, 0x00, sizeof(fcache_t));
+	fc->name = strdup(fn);
+	if (fc->name == NULL) {
+		free(fc);
+		return NULL;
+	}
+	fc->next = cache_list;
+	cache_list = fc;
+    } else if ((fc->text != NULL) &&
+	       (fc->mtime == st.st_mtime) && (fc->fsize == (long)st.st_size)) {
+	/* Still the same, use it. */
+	return fc;
+    }
+
+    if (fc->text != NULL)
+	free(fc->text);
+    fc->text = NULL;
+
+    if ((fp = fopen(fn, "r")) == NULL)
+	return NULL;
+
+    /* In text mode, we never get more characters than the file size. */
+    fc->text = malloc((size_t)st.st_size + 1);
+    if (fc->text == NULL) {
+	(void)fclose(fp);
+	return NULL;
+    }
+    ptr = fc->text;
+    end = ptr + st.st_size;
+    while ((ptr < end) && ((c = fgetc(fp)) != EOF)) {
+	if (c == '\r')
+		continue;
+	*ptr++ = c;
+    }
+    *ptr = '\0';
+    (void)fclose(fp);
+
+    fc->size = (size_t)(ptr - fc->text);
+    fc->mtime = st.st_mtime;
+    fc->fsize = (long)st.st_size;
+
+    return fc;
+}
 
 
 /* Determine the "cooked" size (in characters) of a text file. */
 size_t
 file_size(const char *fn)
 {
+    const char *pf;
     size_t size;
+    fcache_t *fc;
     FILE *fp;
     int c;
 
+    if ((fc = file_cached(fn)) != NULL)
+	return fc->size;
+
+    /* Maybe we have read it already. */
+    if ((pf = prefetch_get(fn, PF_TEXT, &size)) != NULL)
+	return size;
+
     /* Open the file in text mode. */
     if ((fp = fopen(fn, "r")) == NULL)
 	error(ERR_OPEN, fn);
@@ -108,13 +220,26 @@ file_size(const char *fn)
 }
 
 
-int
+size_t
 file_read_buf(const char *fn, char *bufp)
 {
+    const char *pf;
+    fcache_t *fc;
+    size_t size;
     char *ptr;
     FILE *fp;
     int c;
 
+    if ((fc = file_cached(fn)) != NULL) {
+	memcpy(bufp, fc->text, fc->size + 1);
+	return fc->size;
+    }
+
+    if ((pf = prefetch_get(fn, PF_TEXT, &size)) != NULL) {
+	memcpy(bufp, pf, size + 1);
+	return size;
+    }
+
     /* Open the file in text mode. */
     if ((fp = fopen(fn, "r")) == NULL)
 	return 0;
@@ -133,34 +258,43 @@ file_read_buf(const char *fn, char *bufp)
     /* File can be closed now. */
     (void)fclose(fp);
 
+    /* Read whatever it includes ahead. */
+    prefetch_scan(fn, bufp, (size_t)(ptr - bufp));
+
     /* Return the buffer size. */
-    return (int)(ptr - bufp);
+    return (size_t)(ptr - bufp);
 }
 
 
 int
 file_read(const char *fn, char **pp, size_t *sizep)
 {
-    char *ptr;
+    fcache_t *fc;
+    char *ptr, *start;
     size_t size;
     FILE *fp;
     int c;
 
-    /* Open the file in text mode. */
-    if ((fp = fopen(fn, "r")) == NULL)
-	return 0;
+    fp = NULL;
+    if ((fc = file_cached(fn)) != NULL)
+	size = fc->size;
+    else {
+	/* Open the file in text mode. */
+	if ((fp = fopen(fn, "r")) == NULL)
+		return 0;
 
-    /* Text mode, so read file, counting characters. */
-    size = 0;
-    while (!feof(fp) && !ferror(fp)) {
-	if ((c = fgetc(fp)) == EOF)
-		break;
-	if (c == '\r')
-		continue;
-	else
-		size++;
+	/* Text mode, so read file, counting characters. */
+	size = 0;
+	while (!feof(fp) && !ferror(fp)) {
+		if ((c = fgetc(fp)) == EOF)
+			break;
+		if (c == '\r')
+			continue;
+		else
+			size++;
+	}
+	fseek(fp, 0, SEEK_SET);
     }
-    fseek(fp, 0, SEEK_SET);
 
     /* Allocate a buffer for the contents. */
     if (*pp == NULL) {
@@ -172,16 +306,24 @@ file_read(const char *fn, char **pp, size_t *sizep)
 	*pp = realloc(*pp, *sizep + 1 + size + 1);	// +1 for EOF inbetween
 	ptr = *pp + *sizep;
 	*ptr++ = EOF_CHAR;				// insert EOF
+	(*sizep)++;
     }
     ptr[size] = '\0';					// terminate buffer
     *sizep += size;
 
     if (*pp == NULL) {
-	(void)fclose(fp);
+	if (fp != NULL)
+		(void)fclose(fp);
 	return 0;
     }
 
+    if (fc != NULL) {
+	memcpy(ptr, fc->text, size);
+	return 1;
+    }
+
     /* Now read the file's contents into the buffer. */
+    start = ptr;
     while (!feof(fp) && !ferror(fp)) {
 	if ((c = fgetc(fp)) == EOF)
 		break;
@@ -194,20 +336,297 @@ file_read(const char *fn, char **pp, size_t *sizep)
     /* File can be closed now. */
     (void)fclose(fp);
 
+    /* Read whatever it includes ahead. */
+    prefetch_scan(fn, start, (size_t)(ptr - start));
+
     return 1;
 }
 
 
-void
+/* Make sure the file tables have an entry n. */
+int
+file_room(int n)
+{
+    char **names;
+    int *lines;
+    int max;
+
+    if (n < file_max)
+	return 1;
+
+    max = (file_max > 0) ? (file_max * 2) : 64;
+    while (max <= n)
+	max *= 2;
+
+    names = realloc(filenames, max * sizeof(char *));
+    if (names == NULL)
+	return 0;
+    memset(names + file_max, 0x00, (max - file_max) * sizeof(char *));
+    filenames = names;
+    lines = realloc(filelines, max * sizeof(int));
+    if (lines == NULL)
+	return 0;
+    memset(lines + file_max, 0x00, (max - file_max) * sizeof(int));
+    filelines = lines;
+    file_max = max;
+
+    return 1;
+}
+
+
+int
 file_add(const char *name, int linenr, const char *str, size_t size)
 {
     int c = filenames_idx;
 
-    filenames[c] = strdup(name);
+    if (! file_room(c))
+	return 0;
+    if ((filenames[c] = strdup(name)) == NULL)
+	return 0;
     filelines[c] = 1;
 //  filetexts[c] = str;
 //  filesizes[c] = size;
 
     filenames_idx++;
     filenames_len++;
+
+    return 1;
+}
+
+
+/* Keep the contents of files in memory from now on. */
+void
+file_cache_init(void)
+{
+    cache_on = 1;
+}
+
+
+/* Forget the contents of a file, as it was changed. */
+void
+file_uncache(const char *fn)
+{
+    fcache_t *fc;
+
+    for (fc = cache_list; fc != NULL; fc = fc->next) {
+	if (! strcmp(fc->name, fn)) {
+		if (fc->text != NULL)
+			free(fc->text);
+		fc->text = NULL;
+		break;
+	}
+    }
+}
+
+
+/* Remember a source text buffer, so we can release it later. */
+int
+file_buffer(char *buf)
+{
+    if (text_num == text_max) {
+	text_max = text_max ? (text_max * 2) : 16;
+	text_bufs = realloc(text_bufs, text_max * sizeof(char *));
+	if (text_bufs == NULL)
+		return 0;
+    }
+
+    text_bufs[text_num++] = buf;
+
+    return 1;
+}
+
+
+/*
+ * A source text buffer was replaced by a bigger one (with an include
+ * file spliced in), so release it now. The first one has the source
+ * text we started with, which we need again for another round of
+ * Pass 1, so that one is kept.
+ */
+void
+file_drop(char *buf)
+{
+    int i;
+
+    for (i = 1; i < text_num; i++) {
+	if (text_bufs[i] == buf) {
+		free(buf);
+		text_bufs[i] = text_bufs[--text_num];
+		break;
+	}
+    }
+}
+
+
+/* Release all source text buffers, and the file names. */
+void
+file_release(void)
+{
+    int i, j;
+
+    for (i = 0; i < text_num; i++)
+	free(text_bufs[i]);
+    text_num = 0;
+
+    text = NULL;
+    text_len = 0;
+
+    /* A file we returned to shares its name with the earlier entry. */
+    for (i = 0; i < filenames_len; i++) {
+	for (j = 0; j < i; j++)
+		if (filenames[j] == filenames[i])
+			break;
+	if (j == i)
+		free(filenames[i]);
+    }
+    filenames_len = 0;
+}
+
+
+/*
+ * Go back to the files we started with, to do Pass 1 again. The
+ * included files will be read again, so we drop their names.
+ */
+void
+file_rewind(char **names, int n)
+{
+    int i, j;
+
+    for (i = 0; i < filenames_len; i++) {
+	for (j = 0; j < n; j++)
+		if (filenames[i] == names[j])
+			break;
+	if (j < n)
+		continue;
+	for (j = 0; j < i; j++)
+		if (filenames[j] == filenames[i])
+			break;
+	if (j == i)
+		free(filenames[i]);
+    }
+
+    for (i = 0; i < n; i++) {
+	filenames[i] = names[i];
+	filelines[i] = 1;
+    }
+    filenames_len = n;
+}
+
+
+/* Enable dependency tracking, and set the name of its file. */
+int
+file_dep_init(const char *fn)
+{
+    dep_path = strdup(fn);
+
+    return (dep_path != NULL);
+}
+
+
+/* Add a file to the list of dependencies. */
+int
+file_dep(const char *fn)
+{
+    int i;
+
+    /* In watch mode, we also have to keep an eye on it. */
+    if (opt_w && !watch_add(fn))
+	return 0;
+
+    if (dep_path == NULL)
+	return 1;
+
+    for (i = 0; i < dep_num; i++)
+	if (! strcmp(dep_names[i], fn))
+		return 1;
+
+    if (dep_num == dep_max) {
+	dep_max = dep_max ? (dep_max * 2) : 16;
+	dep_names = realloc(dep_names, dep_max * sizeof(char *));
+	if (dep_names == NULL)
+		return 0;
+    }
+
+    dep_names[dep_num] = strdup(fn);
+    if (dep_names[dep_num] == NULL)
+	return 0;
+    dep_num++;
+
+    return 1;
+}
+
+
+/* Write a filename, escaping the characters special to make(1). */
+static void
+dep_name(FILE *fp, const char *fn)
+{
+    for (; *fn; fn++) {
+	if (*fn == ' ' || *fn == '\t' || *fn == '#')
+		fputc('\\', fp);
+	else if (*fn == '$')
+		fputc('$', fp);
+	fputc(*fn, fp);
+    }
+}
+
+
+/*
+ * Write the dependency file, in Makefile syntax. Like the -MP
+ * option of most compilers, we also add an empty rule for each
+ * of the source files, so make(1) will not complain if one of
+ * them gets deleted or renamed.
+ */
+int
+file_dep_write(const char *target)
+{
+    FILE *fp;
+    int i;
+
+    if (dep_path == NULL)
+	return 1;
+
+    if (! strcmp(dep_path, "-"))
+	fp = stdout;
+    else if ((fp = fopen(dep_path, "w")) == NULL)
+	return 0;
+
+    dep_name(fp, target);
+    fputc(':', fp);
+    for (i = 0; i < dep_num; i++) {
+	fprintf(fp, " \\\n ");
+	dep_name(fp, dep_names[i]);
+    }
+    fputc('\n', fp);
+
+    /* The main source file(s) are not included by anything. */
+    for (i = 0; i < dep_num; i++) {
+	if (filenames_len > 0 && !strcmp(dep_names[i], filenames[0]))
+		continue;
+	fputc('\n', fp);
+	dep_name(fp, dep_names[i]);
+	fprintf(fp, ":\n");
+    }
+
+    if (fp != stdout)
+	(void)fclose(fp);
+
+    return 1;
+}
+
+
+/* Release all memory. */
+void
+file_dep_close(void)
+{
+    int i;
+
+    for (i = 0; i < dep_num; i++)
+	free(dep_names[i]);
+    if (dep_names != NULL)
+	free(dep_names);
+    dep_names = NULL;
+    dep_num = dep_max = 0;
+
+    if (dep_path != NULL)
+	free(dep_path);
+    dep_path = NULL;
 }
@@ -0,0 +1,748 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Handle the parallel Pass 2.
+ *
+ *		Once Pass 1 is done, we know the address of every label,
+ *		so the code for any part of the source can be generated
+ *		without the parts before it, if only we know the state of
+ *		the parser at its start. With the -j option, Pass 1 takes
+ *		snapshots of that state every so many lines, whenever it
+ *		is back at the top level (not in a macro, conditional or
+ *		repeat block.) A snapshot has the place in the source and
+ *		the state of the parser (pc, org, radix, current label,
+ *		processor, listing settings and output state), and we
+ *		keep the changes made to variables and macros between
+ *		them.
+ *
+ *		Pass 2 then splits the source into parts of about the
+ *		same number of lines, and starts (with fork) a worker for
+ *		each part, at most as many at a time as were asked for.
+ *		A worker continues from the snapshot at the start of its
+ *		part, and stops at the one at the start of the next part,
+ *		after checking that it got there in the same state. Its
+ *		writer records, generated code and other output go into a
+ *		temporary file, and we put these together in order, so
+ *		the writer makes the same output and listing files as if
+ *		we had done it all ourselves.
+ *
+ *		The parser keeps its state in global variables, so we use
+ *		processes rather than threads for this.
+ *
+ *		If a worker fails, or finds an error (which it does not
+ *		report), Pass 2 is done the normal way, so the messages
+ *		are the same. No snapshots are taken once the zero page
+ *		allocator or a .pagesafe block was used, if a variable
+ *		is undefined, or if a checksum is taken, as these depend
+ *		on all of Pass 1 (or on code from other parts.) Options
+ *		that collect things in Pass 2 itself (like the cross
+ *		reference or the source map) also do it the normal way,
+ *		as does listing the cycle counts, since Pass 1 does not
+ *		know all page crossings.
+ *
+ *		On systems without fork(2), the -j option is ignored.
+ *
+ * Version:	@(#)jobs.c	1.0.2	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+# include <sys/types.h>
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+#include "global.h"
+#include "error.h"
+#include "target.h"
+#include "writer.h"
+#include "jobs.h"
+#include "zpage.h"
+#include "page.h"
+
+
+#define JOBS_LINES	256		// min #lines between snapshots
+#define JOBS_PARTS	4		// parts of Pass 2 per worker
+
+
+/* The state of the parser at a line in Pass 1. */
+typedef struct jsnap {
+    size_t	off;			// offset in the source text
+    uint32_t	lines;			// lines done before it
+    int		line;
+    int		fidx;			// file we are in
+    int8_t	radix,
+		auto_local;
+    uint32_t	pc,
+		org,
+		sa;
+    uint32_t	size,			// output size
+		base;			//  and address
+    int		orgdone;
+    symbol_t	*label;
+    const char	*cpu;
+    int		list[4];		// listing settings
+    int		nmacs;			// #macros defined
+    uint32_t	nvars;			// #variable changes
+} jsnap_t;
+
+/* A variable, as it was at a snapshot. */
+typedef struct jvar {
+    symbol_t	*sym;
+    value_t	value;
+    int8_t	subkind;
+    int		filenr;
+    int		linenr;
+} jvar_t;
+
+/* A macro definition. */
+typedef struct jmac {
+    char	*name,
+		*formal,
+		*def;
+} jmac_t;
+
+/* One part of Pass 2, and its worker. */
+typedef struct jpart {
+    int		snap;			// snapshot it starts at (or -1)
+#ifndef _WIN32
+    pid_t	pid;
+#endif
+    FILE	*fp,			// its results
+		*out;			//  and what it printed
+    int		status;			// 1 if done, -1 if failed
+} jpart_t;
+
+/* What a worker leaves at the end of its results. */
+typedef struct jtail {
+    uint32_t	start,			// output size at start
+		size,			//  and at the end
+		base;
+    int		orgdone;
+    uint32_t	pc,
+		org,
+		sa;
+    int		line;
+    int		fidx;
+} jtail_t;
+
+
+int		jobs_max = 1;		// #workers to use
+
+static int	js_on,			// taking snapshots
+		js_stop;		// no more of them
+static uint32_t	js_lines,		// lines done in Pass 1
+		js_last,		//  at the last snapshot
+		js_stamp;		// symbol changes, same
+static jsnap_t	*js_snaps;
+static uint32_t	js_nsnaps,
+		js_msnaps;
+static jvar_t	*js_vars;
+static uint32_t	js_nvars,
+		js_mvars,
+		js_vlast;		// first change after the last snapshot
+static jmac_t	*js_macs;
+static int	js_nmacs;
+static uint32_t	js_mmacs;
+static jpart_t	*js_parts;
+static int	js_nparts;
+static int	js_worker;		// part we are the worker for, plus one
+static const char *js_text;		// start of the text in Pass 2
+static uint32_t	js_size,		// output size of Pass 1
+		js_start;		// output size at its start
+static size_t	js_end;			// where our part ends
+static const jsnap_t *js_next;		// snapshot at the end of our part
+
+
+/* Make room for one more entry in a table. */
+static void *
+js_grow(void *tbl, uint32_t count, uint32_t *max, size_t size)
+{
+    void *ptr;
+
+    if (count < *max)
+	return tbl;
+
+    ptr = realloc(tbl, (*max + 256) * size);
+    if (ptr == NULL)
+	error(ERR_MEM, "snapshot");
+    *max += 256;
+
+    return ptr;
+}
+
+
+/* Forget all snapshots. */
+static void
+js_reset(void)
+{
+    int i;
+
+    for (i = 0; i < js_nmacs; i++) {
+	free(js_macs[i].name);
+	free(js_macs[i].formal);
+	free(js_macs[i].def);
+    }
+    js_nmacs = 0;
+    js_nsnaps = js_nvars = js_vlast = 0;
+    js_lines = js_last = 0;
+    js_on = js_stop = 0;
+}
+
+
+/* Copy a string for a macro. */
+static char *
+js_strdup(const char *str)
+{
+    char *ptr = strdup(str);
+
+    if (ptr == NULL)
+	error(ERR_MEM, "snapshot");
+
+    return ptr;
+}
+
+
+/* Take a snapshot of the state of the parser. */
+static void
+js_snap(const char *p)
+{
+    const char *name, *formal, *def;
+    jsnap_t *s;
+    jvar_t *v;
+    uint32_t i;
+
+    /* The variables changed since the last one must be known by now. */
+    for (i = js_vlast; i < js_nvars; i++) {
+	v = &js_vars[i];
+	if (!IS_VAR(v->sym) || UNDEFINED(v->sym->value)) {
+		js_stop = 1;
+		return;
+	}
+	v->value = v->sym->value;
+	v->subkind = v->sym->subkind;
+	v->filenr = v->sym->filenr;
+	v->linenr = v->sym->linenr;
+    }
+    js_vlast = js_nvars;
+
+    /* Keep the macros defined since the last one. */
+    while (js_nmacs < macro_count()) {
+	js_macs = js_grow(js_macs, js_nmacs, &js_mmacs, sizeof(jmac_t));
+	if (! macro_get(js_nmacs + 1, &name, &formal, &def))
+		error(ERR_MEM, "snapshot");
+	js_macs[js_nmacs].name = js_strdup(name);
+	js_macs[js_nmacs].formal = js_strdup(formal);
+	js_macs[js_nmacs++].def = js_strdup(def);
+    }
+
+    js_snaps = js_grow(js_snaps, js_nsnaps, &js_msnaps, sizeof(jsnap_t));
+    s = &js_snaps[js_nsnaps++];
+    s->off = (size_t)(p - text);
+    s->lines = js_lines;
+    s->line = line;
+    s->fidx = filenames_idx;
+    s->radix = radix;
+    s->auto_local = auto_local;
+    s->pc = pc;
+    s->org = org;
+    s->sa = sa;
+    s->size = output_size;
+    output_state(&s->base, &s->orgdone);
+    s->label = current_label;
+    s->cpu = trg_name();
+    s->list[0] = list_plength;
+    s->list[1] = list_pwidth;
+    s->list[2] = list_awidth;
+    s->list[3] = list_nbytes;
+    s->nmacs = js_nmacs;
+    s->nvars = js_nvars;
+
+    js_last = js_lines;
+    js_stamp = sym_stamp;
+}
+
+
+/*
+ * Check if we got to a snapshot in the same state as Pass 1. The
+ * org is left out, as Pass 2 starts with the one Pass 1 ended with,
+ * and it is only used for the checksums anyway.
+ */
+static int
+js_same(const jsnap_t *s)
+{
+    uint32_t base;
+    int orgdone;
+
+    output_state(&base, &orgdone);
+
+    return ((s->line == line) && (s->fidx == filenames_idx) &&
+	    (s->radix == radix) && (s->auto_local == auto_local) &&
+	    (s->pc == pc) &&
+	    (s->sa == sa) && (s->size == output_size) &&
+	    (s->base == base) && (s->orgdone == orgdone) &&
+	    (s->label == current_label) && (s->cpu == trg_name()) &&
+	    (s->list[0] == list_plength) && (s->list[1] == list_pwidth) &&
+	    (s->list[2] == list_awidth) && (s->list[3] == list_nbytes) &&
+	    (s->nmacs == macro_count()));
+}
+
+
+#ifndef _WIN32
+/* We are done with our part, hand the results to the parent. */
+static void
+js_finish(int ok)
+{
+    jtail_t t;
+    wrec_t r;
+    long off;
+
+    /* Mark the end of the records. */
+    memset(&r, 0x00, sizeof(r));
+    r.type = WR_PAD;
+    writer_put(&r, NULL, 0, NULL);
+    writer_save(NULL);
+
+    memset(&t, 0x00, sizeof(t));
+    t.start = js_start;
+    t.size = output_size;
+    output_state(&t.base, &t.orgdone);
+    t.pc = pc;
+    t.org = org;
+    t.sa = sa;
+    t.line = line;
+    t.fidx = filenames_idx;
+
+    off = ftell(js_parts[js_worker - 1].fp);
+    (void)fwrite(&t, sizeof(t), 1, js_parts[js_worker - 1].fp);
+    if (output_size > js_start)
+	(void)fwrite(output_buff + js_start, 1, output_size - js_start,
+		     js_parts[js_worker - 1].fp);
+    (void)fwrite(&off, sizeof(off), 1, js_parts[js_worker - 1].fp);
+
+    if (fflush(js_parts[js_worker - 1].fp) != 0)
+	ok = 0;
+    (void)fflush(stdout);
+
+    _exit((ok && (errors == 0)) ? 0 : 1);
+}
+
+
+/* Wait for one of the workers to finish. */
+static int
+js_wait(void)
+{
+    int i, status;
+    pid_t pid;
+
+    if ((pid = wait(&status)) < 0)
+	return 0;
+
+    for (i = 0; i < js_nparts; i++) {
+	if (js_parts[i].pid != pid)
+		continue;
+
+	js_parts[i].status = (WIFEXITED(status) && (WEXITSTATUS(status) == 0)) ? 1 : -1;
+	break;
+    }
+
+    return 1;
+}
+
+
+/* Get the generated code of a part, and check its results. */
+static int
+js_load(jpart_t *jp, jtail_t *t)
+{
+    long off;
+
+    if ((fseek(jp->fp, -(long)sizeof(off), SEEK_END) != 0) ||
+	(fread(&off, sizeof(off), 1, jp->fp) != 1) ||
+	(fseek(jp->fp, off, SEEK_SET) != 0) ||
+	(fread(t, sizeof(jtail_t), 1, jp->fp) != 1) ||
+	(t->start > t->size) || (t->size > js_size))
+	return 0;
+
+    if (fread(output_buff + t->start, 1, t->size - t->start, jp->fp) != (t->size - t->start))
+	return 0;
+
+    return 1;
+}
+
+
+/* Copy what a worker printed. */
+static void
+js_print(FILE *fp)
+{
+    char buff[4096];
+    size_t n;
+
+    rewind(fp);
+    while ((n = fread(buff, 1, sizeof(buff), fp)) > 0)
+	(void)fwrite(buff, 1, n, stdout);
+}
+#endif
+
+
+/* Close the files of all parts. */
+static void
+js_free(void)
+{
+    int i;
+
+    for (i = 0; i < js_nparts; i++) {
+	if (js_parts[i].fp != NULL)
+		(void)fclose(js_parts[i].fp);
+	if (js_parts[i].out != NULL)
+		(void)fclose(js_parts[i].out);
+    }
+
+    if (js_parts != NULL)
+	free(js_parts);
+    js_parts = NULL;
+    js_nparts = 0;
+}
+
+
+/* Start a pass, or a round of Pass 1. */
+void
+jobs_start(int pass)
+{
+    if (pass != 1) {
+	js_size = output_size;
+	return;
+    }
+
+    js_reset();
+    js_on = (jobs_max > 1);
+    js_stamp = sym_stamp;
+}
+
+
+/* A variable is about to be changed. */
+void
+jobs_var(const symbol_t *sym)
+{
+    if (!js_on || js_stop)
+	return;
+
+    /* We only need it once per snapshot. */
+    if (IS_VAR(sym) && (sym->stamp > js_stamp))
+	return;
+
+    js_vars = js_grow(js_vars, js_nvars, &js_mvars, sizeof(jvar_t));
+    js_vars[js_nvars++].sym = (symbol_t *)sym;
+}
+
+
+/*
+ * Called after each line. In Pass 1, take a snapshot if it is
+ * time for one, and in Pass 2, see if the worker is done.
+ */
+void
+jobs_boundary(const char *p, int pass)
+{
+    int top;
+
+    if (!js_on && !js_worker)
+	return;
+
+    top = !maclevel && !macstate && !iflevel && !rptlevel && !cyclevel;
+
+    if (js_worker) {
+#ifndef _WIN32
+	if (!js_next || maclevel || rptlevel ||
+	    ((size_t)(p - js_text) < js_end))
+		return;
+
+	/* We should be exactly where Pass 1 was. */
+	js_finish(top && ((size_t)(p - js_text) == js_end) && js_same(js_next));
+#endif
+	return;
+    }
+
+    js_lines++;
+    if (js_stop || ((js_lines - js_last) < JOBS_LINES))
+	return;
+
+    if (!top || (errors > 0))
+	return;
+
+    /* These depend on all of Pass 1. */
+    if ((zp_count() > 0) || (page_count() > 0)) {
+	js_stop = 1;
+	return;
+    }
+
+    js_snap(p);
+}
+
+
+/* Something needs all of Pass 2, so do it the normal way. */
+void
+jobs_cancel(void)
+{
+    if (js_on)
+	js_stop = 1;
+    js_nsnaps = 0;
+}
+
+
+/*
+ * Split Pass 2 into parts, and start the workers. Returns 1 in
+ * the workers, which then do their part of Pass 2.
+ */
+int
+jobs_fork(void)
+{
+#ifndef _WIN32
+    int i, k, n, running;
+    uint32_t total, want;
+    jpart_t *jp;
+#endif
+
+    js_on = 0;
+    if ((jobs_max <= 1) || (js_nsnaps == 0))
+	return 0;
+
+#ifndef _WIN32
+    /* Parts of about the same number of lines. */
+    n = jobs_max * JOBS_PARTS;
+    if ((uint32_t)n > (js_nsnaps + 1))
+	n = js_nsnaps + 1;
+    js_parts = malloc(n * sizeof(jpart_t));
+    if (js_parts == NULL)
+	return 0;
+    memset(js_parts, 0x00, n * sizeof(jpart_t));
+
+    total = js_lines;
+    js_parts[0].snap = -1;
+    js_nparts = 1;
+    for (i = 0, k = 1; (k < n) && (i < (int)js_nsnaps); i++) {
+	want = (uint32_t)(((uint64_t)total * k) / n);
+	if (js_snaps[i].lines < want)
+		continue;
+	js_parts[js_nparts++].snap = i;
+	k++;
+    }
+    if (js_nparts < 2) {
+	js_free();
+	return 0;
+    }
+
+    if (opt_v)
+	printf("Pass 2 in %i parts, by %i workers\n", js_nparts,
+	       (js_nparts < jobs_max) ? js_nparts : jobs_max);
+
+    running = 0;
+    for (i = 0; i < js_nparts; i++) {
+	jp = &js_parts[i];
+
+	while ((running >= jobs_max) && js_wait())
+		running--;
+
+	jp->fp = tmpfile();
+	jp->out = tmpfile();
+	if ((jp->fp == NULL) || (jp->out == NULL))
+		break;
+
+	(void)fflush(stdout);
+	(void)fflush(stderr);
+	if ((jp->pid = fork()) < 0)
+		break;
+
+	if (jp->pid == 0) {
+		/* We are the worker for this part. */
+		js_worker = i + 1;
+		js_next = NULL;
+		if ((i + 1) < js_nparts) {
+			js_next = &js_snaps[js_parts[i + 1].snap];
+			js_end = js_next->off;
+		}
+		(void)dup2(fileno(jp->out), fileno(stdout));
+		return 1;
+	}
+	running++;
+    }
+
+    /* Wait for all of them, even if we could not start them all. */
+    while ((running > 0) && js_wait())
+	running--;
+#endif
+
+    return 0;
+}
+
+
+/*
+ * Called at the start of Pass 2. A worker continues from the
+ * snapshot at the start of its part. We put the results of all
+ * workers together, and if that worked out, we are done.
+ */
+void
+jobs_restore(char **p, int pass)
+{
+#ifndef _WIN32
+    const jsnap_t *s;
+    const jvar_t *v;
+    jtail_t t;
+    int i;
+#endif
+
+    if ((pass != 2) || (js_nparts == 0))
+	return;
+
+#ifndef _WIN32
+    js_text = *p;
+
+    if (js_worker) {
+	if (js_parts[js_worker - 1].snap >= 0) {
+		s = &js_snaps[js_parts[js_worker - 1].snap];
+
+		/* Set the variables, and define the macros, as they were. */
+		for (i = 0; i < (int)s->nvars; i++) {
+			v = &js_vars[i];
+			v->sym->value = v->value;
+			v->sym->kind = KIND_VAR;
+			v->sym->subkind = v->subkind;
+			v->sym->filenr = v->filenr;
+			v->sym->linenr = v->linenr;
+		}
+		for (i = 0; i < s->nmacs; i++)
+			macro_define(js_macs[i].name, js_macs[i].formal,
+				     js_macs[i].def);
+
+		line = s->line;
+		filenames_idx = s->fidx;
+		radix = s->radix;
+		auto_local = s->auto_local;
+		pc = s->pc;
+		org = s->org;
+		sa = s->sa;
+		output_size = s->size;
+		output_restore(s->base, s->orgdone);
+		current_label = s->label;
+		(void)trg_set_cpu(s->cpu);
+		list_plength = s->list[0];
+		list_pwidth = s->list[1];
+		list_awidth = s->list[2];
+		list_nbytes = s->list[3];
+		list_save(pc);
+
+		*p += s->off;
+	}
+
+	/* From here on, the writer saves its records for the parent. */
+	js_start = output_size;
+	writer_save(js_parts[js_worker - 1].fp);
+	return;
+    }
+
+    /* See if all workers did their part. */
+    for (i = 0; i < js_nparts; i++)
+	if ((js_parts[i].status != 1) || !js_load(&js_parts[i], &t))
+		break;
+    if (i < js_nparts) {
+	if (opt_v)
+		printf("Workers failed, doing Pass 2 the normal way\n");
+	memset(output_buff, 0x00, js_size);
+	js_free();
+	return;
+    }
+
+    /* Hand their records to the writer, in order. */
+    for (i = 0; i < js_nparts; i++) {
+	rewind(js_parts[i].fp);
+	(void)writer_load(js_parts[i].fp);
+	js_print(js_parts[i].out);
+    }
+
+    /* Continue with the state at the end of the last part. */
+    output_size = t.size;
+    output_restore(t.base, t.orgdone);
+    pc = t.pc;
+    org = t.org;
+    sa = t.sa;
+    line = t.line;
+    filenames_idx = t.fidx;
+    js_free();
+
+    *p += strlen(*p);
+#endif
+}
+
+
+/* End of a pass. A worker that got here is done. */
+void
+jobs_end(int pass)
+{
+#ifndef _WIN32
+    if ((pass != 2) || !js_worker)
+	return;
+
+    /* Only the last part should get to the end of the input. */
+    js_finish(js_next == NULL);
+#endif
+}
+
+
+/* Release everything. */
+void
+jobs_close(void)
+{
+    js_reset();
+    js_free();
+
+    if (js_snaps != NULL)
+	free(js_snaps);
+    js_snaps = NULL;
+    js_msnaps = 0;
+    if (js_vars != NULL)
+	free(js_vars);
+    js_vars = NULL;
+    js_mvars = 0;
+    if (js_macs != NULL)
+	free(js_macs);
+    js_macs = NULL;
+    js_mmacs = 0;
+}
@@ -8,7 +8,11 @@
  *
  *		Handle the listfile output.
  *
- * Version:	@(#)list.c	1.0.14	2023/09/28
+ *		The list_xxx functions are called by the parser, and they
+ *		queue their work for the writer (see writer.c), which then
+ *		calls the list_do_xxx functions to do the actual output.
+ *
+ * Version:	@(#)list.c	1.0.24	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -50,12 +54,21 @@
 #include <string.h>
 #include <time.h>
 #include "global.h"
+#include "writer.h"
+#include "xref.h"
+#include "zpage.h"
+#include "page.h"
 
 
 #define LIST_PLENGTH	66		// number of lines per page
 #define LIST_PWIDTH	80		// number of characters per line
 #define LIST_AWIDTH	6		// number of digits in addresses
 #define LIST_NBYTES	4		// this many code bytes per line
+#define LIST_CYCW	5		// width of the cycle count
+#define LIST_RUNW	9		//  and of the running count
+
+#define LIST_BUFSZ	2048		// size of the line buffer
+#define LIST_IOBUF	65536		// size of the file buffer
 
 #define LIST_CHAR_FF	"\014"		// FormFeed character
 #define LIST_CHAR_SI	"\017"		// SI (condensed printing mode)
@@ -77,31 +90,65 @@ static char	*list_subttl;
 static int	list_syms = 0;
 static FILE	*list_file = NULL;
 static char	list_path[1024];
+static char	list_buf[LIST_BUFSZ];		// line formatting buffer
+
+static const char hexdigits[] = "0123456789ABCDEF";
 
 
+/* Fill in a writer record with the current listing state. */
 void
-list_set_head(const char *str)
+list_capture(wrec_t *r, int type)
 {
-    if (list_title != NULL)
-        free(list_title);
-    list_title = NULL;
+    memset(r, 0x00, sizeof(wrec_t));
+    r->type = type;
+    r->line = line;
+    r->plength = list_plength;
+    r->pwidth = list_pwidth;
+    r->awidth = list_awidth;
+    r->nbytes = list_nbytes;
+
+    /* Past the last file (like for the symbol table), use the first. */
+    if (filenames_idx < filenames_len)
+	r->fname = filenames[filenames_idx];
+    else
+	r->fname = filenames[0];
+}
+
+
+void
+list_do_title(const wrec_t *r, const char *str)
+{
+    char **pp = (r->type == WR_TITLE) ? &list_title : &list_subttl;
+
+    if (*pp != NULL)
+        free(*pp);
+    *pp = NULL;
 
     /* .. and set the new one. */
-    if (str != NULL)
-	list_title = strdup(str);
+    if (r->state)
+	*pp = strdup(str);
+}
+
+
+void
+list_set_head(const char *str)
+{
+    wrec_t r;
+
+    list_capture(&r, WR_TITLE);
+    r.state = (str != NULL);
+    writer_put(&r, str, (str != NULL) ? strlen(str) : 0, NULL);
 }
 
 
 void
 list_set_head_sub(const char *str)
 {
-    if (list_subttl != NULL)
-        free(list_subttl);
-    list_subttl = NULL;
+    wrec_t r;
 
-    /* .. and set the new one. */
-    if (str != NULL)
-	list_subttl = strdup(str);
+    list_capture(&r, WR_SUBTTL);
+    r.state = (str != NULL);
+    writer_put(&r, str, (str != NULL) ? strlen(str) : 0, NULL);
 }
 
 
@@ -124,8 +171,8 @@ list_set_syms(int syms)
  * for the page. We also use 3 lines per page for the header, so
  * with those default settings, we get to "keep" 60 lines.
  */
-void
-list_page(const char *head, const char *sub)
+static void
+page_out(const wrec_t *r, const char *head, const char *sub)
 {
     char buff[1024], page[256];
     char temp[1024], date[64];
@@ -141,7 +188,7 @@ list_page(const char *head, const char *sub)
 	head = list_title;
 
     /* Initialize printer to condensed mode if width > 80. */
-    if (opt_P > 1 && list_pnr == 0 && list_pwidth > 80) {
+    if (opt_P > 1 && list_pnr == 0 && r->pwidth > 80) {
 	fprintf(list_file, LIST_CHAR_SI);
     }
 
@@ -154,7 +201,7 @@ list_page(const char *head, const char *sub)
     strftime(date, sizeof(date), "%c", tm);
 
     sprintf(page, "%s    Page %i", date, list_pnr);
-    skip = list_pwidth - (strlen(myname) + 1 + strlen(version) + strlen(page));
+    skip = r->pwidth - (strlen(myname) + 1 + strlen(version) + strlen(page));
     if (opt_P && list_pnr > 1) {
 	/* Insert a form-feed for all but first page. */
 	sprintf(ptr, "%s", LIST_CHAR_FF);
@@ -167,7 +214,7 @@ list_page(const char *head, const char *sub)
     strcpy(ptr, page);
     fprintf(list_file, "%s\n", buff);
 
-    sprintf(page, "File: %s", filenames[filenames_idx]);
+    sprintf(page, "File: %s", r->fname);
     i = strlen(page);
     memset(temp, 0x00, sizeof(temp));
     if (head != NULL)
@@ -176,12 +223,12 @@ list_page(const char *head, const char *sub)
 	strcat(temp, " : ");
 	strcat(temp, sub);
     }
-    skip = list_pwidth - i;
+    skip = r->pwidth - i;
     if (skip < strlen(temp)) {
 	/* Title is too long, we have to clip it. */
 	temp[skip - 1] = '\0';
     }
-    skip = list_pwidth - (i + strlen(temp));
+    skip = r->pwidth - (i + strlen(temp));
     ptr = buff;
     sprintf(ptr, "%s", temp);
     ptr += strlen(ptr);
@@ -191,7 +238,97 @@ list_page(const char *head, const char *sub)
     fprintf(list_file, "%s\n\n", buff);
 
     /* OK, good for another page.. */
-    list_pln = list_plength - (3 + 3);	// margin + header
+    list_pln = r->plength - (3 + 3);	// margin + header
+}
+
+
+void
+list_do_page(const wrec_t *r, const char *head, const char *sub)
+{
+    page_out(r, (r->state & 1) ? head : NULL, (r->state & 2) ? sub : NULL);
+}
+
+
+void
+list_page(const char *head, const char *sub)
+{
+    wrec_t r;
+
+    list_capture(&r, WR_PAGE);
+    r.state = ((head != NULL) ? 1 : 0) | ((sub != NULL) ? 2 : 0);
+    writer_put(&r, head, (head != NULL) ? strlen(head) : 0, sub);
+}
+
+
+/* Format a number as hex, zero-padded to (at least) width digits. */
+static char *
+list_hex(char *p, uint32_t v, int width)
+{
+    char temp[8];
+    int i = 0;
+
+    do {
+	temp[i++] = hexdigits[v & 0x0f];
+	v >>= 4;
+    } while (v != 0);
+    while (width-- > i)
+	*p++ = '0';
+    while (i > 0)
+	*p++ = temp[--i];
+
+    return p;
+}
+
+
+/* Format a number as decimal, padded to (at least) width digits. */
+static char *
+list_dec(char *p, int v, int width, char fill)
+{
+    char temp[12];
+    int i = 0;
+
+    if (v < 0) {
+	/* Rare, so let the library deal with it. */
+	return p + sprintf(p, (fill == '0') ? "%0*i" : "%*i", width, v);
+    }
+
+    do {
+	temp[i++] = (char)('0' + (v % 10));
+	v /= 10;
+    } while (v != 0);
+    while (width-- > i)
+	*p++ = fill;
+    while (i > 0)
+	*p++ = temp[--i];
+
+    return p;
+}
+
+
+/* Add the cycle counts (if any) to a listing line. */
+static char *
+list_cycles(char *bp, const int *cyc, const uint32_t *run)
+{
+    char temp[32];
+
+    if (cyc == NULL) {
+	memset(bp, ' ', 2 + LIST_CYCW + LIST_RUNW);
+	return bp + 2 + LIST_CYCW + LIST_RUNW;
+    }
+
+    if (cyc[0] == cyc[1])
+	sprintf(temp, "%i", cyc[0]);
+    else
+	sprintf(temp, "%i-%i", cyc[0], cyc[1]);
+    bp += sprintf(bp, " %*s", LIST_CYCW, temp);
+
+    if (run[0] == run[1])
+	sprintf(temp, "%u", run[0]);
+    else
+	sprintf(temp, "%u-%u", run[0], run[1]);
+    bp += sprintf(bp, " %*s", LIST_RUNW, temp);
+
+    return bp;
 }
 
 
@@ -202,73 +339,134 @@ list_page(const char *head, const char *sub)
  * and for those to look "nice" in our listings, we must make
  * sure the actual listing starts at a multiple-of-8 position
  * plus one. For now, we are using position 33.
+ *
+ * The line is formatted into a buffer first, and then written
+ * out in one go, as this is by far the hottest path in here.
  */
 void
-list_line(const char *p)
+list_do_line(const wrec_t *r, const char *p, const char *sp)
 {
-    char temp[128];
-    int count = 0;
-    char *sp;
+    uint32_t pc, oc;
+    size_t len;
+    char *bp;
+    uint8_t b;
+    int count;
 
     if (list_file == NULL)
 	return;
 
-    if (list_pln == 0) {
-	/* Reset the page. */
-	list_page(list_title, list_subttl);
-    }
+    pc = r->addr;
+    oc = r->oc;
 
-    /* Output listing line number. */
-    fprintf(list_file, "%05i ", list_lnr++);
-    fprintf(list_file, "%0*X", list_awidth, list_pc);
+    do {
+	if (list_pln == 0) {
+		/* Reset the page. */
+		page_out(r, list_title, list_subttl);
+	}
 
-    /* Our max space is LIST_NBYTES * 3 characters. */
-    count = list_nbytes * 3;
+	/* Output listing line number. */
+	bp = list_dec(list_buf, list_lnr++, 5, '0');
+	*bp++ = ' ';
+	bp = list_hex(bp, pc, r->awidth);
+
+	/* Our max space is LIST_NBYTES * 3 characters. */
+	count = r->nbytes * 3;
+
+	/* Output code if we emitted any. */
+	if (oc < r->osize) {
+		/* List the generated bytes. */
+		while (oc < r->osize && count > 0) {
+			b = output_buff[oc++];
+			*bp++ = ' ';
+			*bp++ = hexdigits[b >> 4];
+			*bp++ = hexdigits[b & 0x0f];
+			pc++;
+			count -= 3;
+		}
+	} else {
+		/* No code generated, check if a directive wanted something listed. */
+		if (sp != NULL) {
+			*bp++ = ' ';
+			count--;
 
-    /* Output code if we emitted any. */
-    if (list_oc < output_size) {
-	/* List the generated bytes. */
-	while (list_oc < output_size && count > 0) {
-		fprintf(list_file, " %02X", output_buff[list_oc++]);
-		list_pc++;
-		count -= 3;
+			len = strlen(sp);
+			if (len > count)
+				len = count;
+			memcpy(bp, sp, len);
+			bp += len;
+			count -= (int)len;
+		}
 	}
-    } else {
-	/* No code generated, check if a directive wants something listed. */
-	sp = pseudo_list(psop, temp);
-	if (sp != NULL) {
-		fputc(' ', list_file);
-		count--;
 
-		if (strlen(sp) > count)
-			sp[count] = '\0';
+	/* Fill up the remaining space. */
+	while (count-- > 0)
+		*bp++ = ' ';
 
-		while (*sp != '\0') {
-			fputc(*sp++, list_file);
-			count--;
+	/* Add the cycle counts, on the first line only. */
+	if (opt_c)
+		bp = list_cycles(bp, ((p != NULL) && (r->cycles[1] > 0)) ?
+					r->cycles : NULL, r->running);
+
+	bp = list_dec(bp, r->line, 6, ' ');
+	*bp++ = r->state;
+	*bp++ = ' ';
+
+	len = (p != NULL) ? r->slen : 0;
+
+	if (len < (sizeof(list_buf) - (bp - list_buf) - 1)) {
+		/* We have room, so add the source text to the line. */
+		if (len > 0) {
+			memcpy(bp, p, len);
+			bp += len;
 		}
+		*bp++ = '\n';
+		fwrite(list_buf, 1, bp - list_buf, list_file);
+	} else {
+		/* Very long line, write it separately. */
+		fwrite(list_buf, 1, bp - list_buf, list_file);
+		fwrite(p, 1, len, list_file);
+		fputc('\n', list_file);
 	}
-    }
 
-    /* Fill up the remaining space. */
-    while (count--)
-	fputc(' ', list_file);
+	if (r->plength != 255)
+		list_pln--;
 
-    fprintf(list_file, "%6i%c ", line, maclevel ? 'M' : ifstate ? ':' : '-');
+	/* If not all generated bytes were emitted, do this again. */
+	p = NULL;
+    } while (oc < r->osize);
+}
 
-    if (p != NULL) {
-	while (*p && *p != '\n' && *p != EOF_CHAR)
-		fputc(*p++, list_file);
+
+void
+list_line(const char *p)
+{
+    char temp[128];
+    const char *sp;
+    wrec_t r;
+
+    if (list_file == NULL) {
+	/* No listing, but keep the writer busy. */
+	writer_data();
+	return;
     }
 
-    /* End the line, and start a new one. */
-    fputs("\n", list_file);
-    if (list_plength != 255)
-	list_pln--;
+    list_capture(&r, WR_LINE);
+    r.addr = list_pc;
+    r.oc = list_oc;
+    r.state = relax_line ? relax_line : maclevel ? 'M' : ifstate ? ':' : '-';
+    if (opt_c) {
+	r.cycles[0] = cyc_line[0];
+	r.cycles[1] = cyc_line[1];
+	r.running[0] = cyc_total[0] - cyc_base[0];
+	r.running[1] = cyc_total[1] - cyc_base[1];
+    }
 
-    /* If not all generated bytes were emitted, do this again. */
-    if (list_oc < output_size)
-	list_line(NULL);
+    /* If no code was generated, a directive may want something listed. */
+    sp = NULL;
+    if (list_oc >= output_size)
+	sp = pseudo_list(psop, temp);
+
+    writer_put(&r, p, (p != NULL) ? strcspn(p, "\n\032") : 0, sp);
 }
 
 
@@ -276,15 +474,20 @@ void
 list_symbols(void)
 {
     symbol_t *loc, *sym;
+    wrec_t r;
+    char *bp;
     FILE *fp;
 
     /* Has this been enabled? */
     if (! list_syms)
 	return;
 
+    /* The writer is done by now, so we can write to the file directly. */
+    list_capture(&r, WR_PAGE);
+
     /* If we are not using a listing file, dump to stdout. */
     if (list_file != NULL) {
-	list_page("** SYMBOL TABLE **", NULL);	// new page
+	page_out(&r, "** SYMBOL TABLE **", NULL);	// new page
 	fp = list_file;				// use listing file
     } else
 	fp = stdout;				// use stdout
@@ -304,30 +507,33 @@ list_symbols(void)
 		continue;
 
 	if ((fp != stdout) && (list_pln == 0))
-		list_page("** SYMBOL TABLE **", NULL);
+		page_out(&r, "** SYMBOL TABLE **", NULL);
 
-	fprintf(fp, "%-32s %c ", sym->name, sym_type(sym));
+	/* Format the entire line, and then write it out. */
+	bp = list_buf;
+	bp += sprintf(bp, "%-32s %c ", sym->name, sym_type(sym));
  	if (IS_MAC(sym)) {
-		fprintf(fp, "           ");
+		bp += sprintf(bp, "           ");
 		goto do_macro;
 	} else if (DEFINED(sym->value)) {
-		fprintf(fp, "%9s ", value_print(sym->value));
+		bp += sprintf(bp, "%9s ", value_print(sym->value));
 		if (IS_VAR(sym))
-			fprintf(fp, "%c", value_type(sym->value));
+			*bp++ = value_type(sym->value);
 		else if (IS_LBL(sym))
-			fprintf(fp, " ");
+			*bp++ = ' ';
 do_macro:
-		fprintf(fp, "        ");
+		bp += sprintf(bp, "        ");
 		if (sym->linenr < 0)
-			fprintf(fp, "-builtin-");
+			bp += sprintf(bp, "-builtin-");
 		else if (sym->filenr != -1 && sym->linenr != 0)
-			fprintf(fp, "%s:%i",
+			bp += sprintf(bp, "%.900s:%i",
 				filenames[sym->filenr], sym->linenr);
 		else
-			fprintf(fp, "-command line-");
+			bp += sprintf(bp, "-command line-");
 	} else
-		fprintf(fp, "%9s", "??");
-	fprintf(fp, "\n");
+		bp += sprintf(bp, "%9s", "??");
+	*bp++ = '\n';
+	fwrite(list_buf, 1, bp - list_buf, fp);
 
 	if (fp != stdout && list_plength != 255)
 		list_pln--;
@@ -335,13 +541,15 @@ do_macro:
 	if ((list_syms == 2) && IS_LBL(sym)) {
 		for (loc = sym->locals; loc; loc = loc->next) {
 			if ((fp != stdout && (list_plength != 255)) && (--list_pln == 0))
-				list_page("** SYMBOL TABLE **", NULL);
+				page_out(&r, "** SYMBOL TABLE **", NULL);
 
-			fprintf(fp, "  %c%-29s %c ",
+			bp = list_buf;
+			bp += sprintf(bp, "  %c%-29s %c ",
 				ALPHA_CHAR, loc->name, sym_type(sym));
-			fprintf(fp, "%9s          %s:%i\n",
+			bp += sprintf(bp, "%9s          %.900s:%i\n",
 				value_print(loc->value),
 				filenames[loc->filenr], loc->linenr);
+			fwrite(list_buf, 1, bp - list_buf, fp);
 		}
 	}
     }
@@ -356,6 +564,267 @@ list_save(uint32_t pc)
 }
 
 
+/*
+ * Add the cross reference to the listing.
+ *
+ * Every symbol gets a line with its name and value, followed
+ * by the places it is referenced, as line numbers. The file
+ * name is only shown when it changes, and definitions and
+ * assignments are marked with an asterisk.
+ */
+void
+list_xref(void)
+{
+    char temp[ID_LEN * 2], ref[1024];
+    const xref_t *list, *xr;
+    const char *name;
+    int col, file, i, n;
+    wrec_t r;
+    char *bp;
+
+    if (list_file == NULL)
+	return;
+
+    list = xref_sorted(&n);
+    if (n == 0)
+	return;
+
+    list_capture(&r, WR_PAGE);
+    page_out(&r, "** CROSS REFERENCE **", NULL);
+
+    bp = list_buf;
+    col = file = 0;
+    for (i = 0; i < n; i++) {
+	xr = &list[i];
+	name = xref_name(xr, temp);
+
+	/* Skip symbols with __ prefix. */
+	if (!opt_v && !strncmp(name, "__", 2))
+		continue;
+
+	if (i == 0 || xr->sym != list[i - 1].sym) {
+		/* New symbol, finish the previous one. */
+		if (bp != list_buf) {
+			*bp++ = '\n';
+			fwrite(list_buf, 1, bp - list_buf, list_file);
+			if (r.plength != 255 && --list_pln == 0)
+				page_out(&r, "** CROSS REFERENCE **", NULL);
+		}
+
+		bp = list_buf;
+		bp += sprintf(bp, "%-32s %9s ", name, value_print(xr->sym->value));
+		col = (int)(bp - list_buf);
+		file = -2;
+	}
+
+	/* Format this reference. */
+	if (xr->file != file)
+		sprintf(ref, " %.900s:%i%s", filenames[xr->file], xr->line,
+			(xr->kind == XREF_WRITE) ? "*" : "");
+	else
+		sprintf(ref, " %i%s", xr->line,
+			(xr->kind == XREF_WRITE) ? "*" : "");
+	file = xr->file;
+
+	/* Start a new line if this one is full. */
+	if ((bp - list_buf) + strlen(ref) > r.pwidth && (bp - list_buf) > col) {
+		*bp++ = '\n';
+		fwrite(list_buf, 1, bp - list_buf, list_file);
+		if (r.plength != 255 && --list_pln == 0)
+			page_out(&r, "** CROSS REFERENCE **", NULL);
+
+		bp = list_buf;
+		while ((bp - list_buf) < col)
+			*bp++ = ' ';
+	}
+
+	/* Really long file names can still overflow, so check. */
+	if ((bp - list_buf) + strlen(ref) < sizeof(list_buf) - 2) {
+		strcpy(bp, ref);
+		bp += strlen(ref);
+	}
+    }
+
+    if (bp != list_buf) {
+	*bp++ = '\n';
+	fwrite(list_buf, 1, bp - list_buf, list_file);
+	if (r.plength != 255)
+		list_pln--;
+    }
+}
+
+/* Write a line of one of the reports, to the listing or stdout. */
+static void
+report_line(wrec_t *r, FILE *fp, const char *head, int len)
+{
+    list_buf[len++] = '\n';
+
+    if (fp != list_file) {
+	fwrite(list_buf, 1, len, fp);
+	return;
+    }
+
+    if ((r->plength != 255) && (list_pln == 0))
+	page_out(r, head, NULL);
+
+    fwrite(list_buf, 1, len, list_file);
+    if (r->plength != 255)
+	list_pln--;
+}
+
+
+#define ZP_HEAD	"** ZERO PAGE **"
+
+/*
+ * Add the zero page report to the listing. For every segment, we
+ * show how much of it is used, followed by its variables in the
+ * order of their addresses. The free space is left at the end of
+ * the segments, so the number of (and largest) free block tell us
+ * how fragmented the pools are.
+ */
+void
+list_zpage(void)
+{
+    const zpseg_t *segs, *seg;
+    const zpvar_t *vars, *var;
+    uint32_t addr, avail, largest, used;
+    int nsegs, nvars, blocks, i, j;
+    wrec_t r;
+
+    if (list_file == NULL)
+	return;
+
+    vars = zp_vars(&nvars);
+    segs = zp_segs(&nsegs);
+    if (nsegs == 0)
+	return;
+
+    list_capture(&r, WR_PAGE);
+    page_out(&r, ZP_HEAD, NULL);
+
+    avail = largest = 0;
+    blocks = 0;
+    for (i = 0; i < nsegs; i++) {
+	seg = &segs[i];
+	used = seg->next - seg->start;
+	report_line(&r, list_file, ZP_HEAD, sprintf(list_buf,
+		"Segment %04X-%04X %5u bytes, %u used, %u free",
+		seg->start, seg->end, seg->end - seg->start + 1, used,
+		seg->end - seg->next + 1));
+
+	if (seg->next <= seg->end) {
+		blocks++;
+		avail += seg->end - seg->next + 1;
+		if ((seg->end - seg->next + 1) > largest)
+			largest = seg->end - seg->next + 1;
+	}
+
+	/* List its variables by address. */
+	addr = seg->start;
+	for (;;) {
+		var = NULL;
+		for (j = 0; j < nvars; j++) {
+			if ((vars[j].addr >= addr) &&
+			    (vars[j].addr <= seg->end) &&
+			    ((var == NULL) || (vars[j].addr < var->addr)))
+				var = &vars[j];
+		}
+		if (var == NULL)
+			break;
+
+		report_line(&r, list_file, ZP_HEAD, sprintf(list_buf,
+			"  %-32s %04X %5u bytes %6u refs",
+			var->name, var->addr, var->size, var->refs));
+		addr = var->addr + 1;
+	}
+	report_line(&r, list_file, ZP_HEAD, 0);
+    }
+
+    report_line(&r, list_file, ZP_HEAD, sprintf(list_buf,
+	"%i variables, %u bytes free in %i blocks, largest %u (%u%% fragmented)",
+	nvars, avail, blocks, largest,
+	avail ? 100 - ((largest * 100) / avail) : 0));
+}
+
+#define PG_HEAD	"** PAGE CROSSINGS **"
+
+/*
+ * Show the page crossing analysis (with -a) in the listing, or on
+ * stdout if we do not have one, followed by what the .pagesafe
+ * blocks saved. This is 1 cycle for each execution of a taken
+ * branch, or of an indexed read, that no longer crosses a page.
+ */
+void
+list_pages(void)
+{
+    const pgblock_t *blocks, *blk;
+    const pgitem_t *items, *item;
+    uint32_t branches, reads, pad;
+    int i, kind, nblocks, nitems, moved;
+    wrec_t r;
+    FILE *fp;
+
+    items = page_items(&nitems);
+    blocks = page_blocks(&nblocks);
+    page_saved(&branches, &reads);
+
+    if (list_file != NULL) {
+	if (!opt_a && (nblocks == 0))
+		return;
+	fp = list_file;
+	list_capture(&r, WR_PAGE);
+	page_out(&r, PG_HEAD, NULL);
+    } else {
+	if (!opt_a || opt_q)
+		return;
+	fp = stdout;
+	list_capture(&r, WR_PAGE);
+    }
+
+    for (kind = PAGE_BRANCH; opt_a && (kind <= PAGE_TABLE); kind++) {
+	report_line(&r, fp, PG_HEAD, sprintf(list_buf, "%s crossing a page:",
+		(kind == PAGE_BRANCH) ? "Branches" : "Tables"));
+
+	for (i = 0; i < nitems; i++) {
+		item = &items[i];
+		if (item->kind != kind)
+			continue;
+
+		if (kind == PAGE_BRANCH)
+			report_line(&r, fp, PG_HEAD, sprintf(list_buf,
+				"  %04X -> %04X  %.900s:%i",
+				item->from - 2, item->to,
+				filenames[item->file], item->line));
+		else
+			report_line(&r, fp, PG_HEAD, sprintf(list_buf,
+				"  %04X-%04X %-32s %.900s:%i",
+				item->from, item->to - 1, item->name,
+				filenames[item->file], item->line));
+	}
+	report_line(&r, fp, PG_HEAD, 0);
+    }
+
+    moved = 0;
+    pad = 0;
+    for (i = 0; i < nblocks; i++) {
+	blk = &blocks[i];
+	if (blk->pad == 0)
+		continue;
+	moved++;
+	pad += blk->pad;
+	report_line(&r, fp, PG_HEAD, sprintf(list_buf,
+		"Block %04X-%04X moved, %u bytes of padding  %.900s:%i",
+		blk->start, blk->end - 1, blk->pad,
+		filenames[blk->file], blk->line));
+    }
+
+    report_line(&r, fp, PG_HEAD, sprintf(list_buf,
+	"%i of %i blocks moved (%u bytes), saving a cycle on %u taken "
+	"branches and %u indexed reads", moved, nblocks, pad,
+	branches, reads));
+}
+
+
 void
 list_close(int remov)
 {
@@ -399,6 +868,9 @@ list_init(const char *fn)
     if (list_file == NULL)
 	return 0;
 
+    /* We write a lot of small lines, so use a large buffer. */
+    (void)setvbuf(list_file, NULL, _IOFBF, LIST_IOBUF);
+
     list_lnr = 1;
     list_pnr = list_pln = 0;
     list_pc = list_oc = 0;
@@ -8,7 +8,7 @@
  *
  *		Handle macros.
  *
- * Version:	@(#)macro.c	1.0.1	2023/08/20
+ * Version:	@(#)macro.c	1.0.5	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -50,6 +50,7 @@
 #include <string.h>
 #include "global.h"
 #include "error.h"
+#include "stats.h"
 
 
 #define MACRO_SIZE	1024			// max #bytes in macro def
@@ -69,6 +70,8 @@ typedef struct macro {
     char	def[MACRO_SIZE],		// macro definition text
 		data[MACRO_SIZE];		// macro text
 
+    int		seq;				// order of definition
+
     struct macro *next;
 } macro_t;
 
@@ -79,6 +82,7 @@ int		macstate,
 
 static macro_t	*macros = NULL,
 		*curmac = NULL;
+static int	macro_num;			// number of macros defined
 
 
 /* Update the matched string with new contents. */
@@ -169,6 +173,38 @@ subst(macro_t *m, char *ptr)
 }
 
 
+/* Create a new macro, and add it to the list. */
+static macro_t *
+macro_new(const char *name, const char *formal)
+{
+    macro_t *m, *ptr;
+
+    m = malloc(sizeof(macro_t));
+    if (m == NULL)
+	error(ERR_MEM, "new macro");
+    memset(m, 0x00, sizeof(macro_t));
+    strncpy(m->name, name, ID_LEN);
+    strncpy(m->formal, formal, PARAM_SIZE - 1);
+    m->defptr = m->def;
+    m->seq = ++macro_num;
+
+    /* Insert in alphabetical order. */
+    if ((macros == NULL) || (strcasecmp((macros)->name, m->name) > 0)) {
+	m->next = macros;
+	macros = m;
+    } else {
+	for (ptr = macros; ptr->next != NULL; ptr = ptr->next)
+		if (strcasecmp(ptr->next->name, m->name) > 0)
+			break;
+
+	m->next = ptr->next;
+	ptr->next = m;
+    }
+
+    return m;
+}
+
+
 /* Reset macros for each pass. */
 void
 macro_reset(void)
@@ -182,6 +218,7 @@ macro_reset(void)
     }
 
     macros = NULL;
+    macro_num = 0;
 }
 
 
@@ -283,6 +320,9 @@ macro_exec(const char *name, char **p, char **newp, int pass)
 		*curmac->dataptr++ = *sp++;
     }
 
+    STATS_INC(ST_MACEXP);
+    STATS_ADD(ST_MACBYTES, curmac->dataptr - curmac->data);
+
     /* Set up a new "line pointer" for the parser. */
     curmac->dataptr = curmac->data;
     *newp = curmac->dataptr;
@@ -302,13 +342,93 @@ macro_close(char **p)
 }
 
 
+/* Find a macro, and return its parameters and definition. */
+int
+macro_find(const char *name, const char **formal, const char **def)
+{
+    macro_t *m;
+
+    for (m = macros; m != NULL; m = m->next)
+	if (! strcasecmp(m->name, name))
+		break;
+    if (m == NULL)
+	return 0;
+
+    *formal = m->formal;
+    *def = m->def;
+
+    return 1;
+}
+
+
+/* Return the number of macros defined so far. */
+int
+macro_count(void)
+{
+    return macro_num;
+}
+
+
+/* Find the n'th macro defined, and return its name and definition. */
+int
+macro_get(int n, const char **name, const char **formal, const char **def)
+{
+    macro_t *m;
+
+    for (m = macros; m != NULL; m = m->next)
+	if (m->seq == n)
+		break;
+    if (m == NULL)
+	return 0;
+
+    *name = m->name;
+    *formal = m->formal;
+    *def = m->def;
+
+    return 1;
+}
+
+
+/* Define a complete macro, as if read from the source. */
+void
+macro_define(const char *name, const char *formal, const char *def)
+{
+    macro_t *m;
+
+    if (strlen(def) >= MACRO_SIZE)
+	error(ERR_MEM, name);
+
+    m = macro_new(name, formal);
+    strcpy(m->def, def);
+}
+
+
+/* Return the name of the macro being expanded, and the line within it. */
+const char *
+macro_current(const char *ptr, int *line)
+{
+    const char *sp;
+
+    *line = 0;
+    if (curmac == NULL)
+	return NULL;
+
+    /* Count the lines in the expanded text up to this point. */
+    *line = 1;
+    for (sp = curmac->data; sp < ptr && *sp != ETX_CHAR; sp++)
+	if (*sp == '\n')
+		(*line)++;
+
+    return curmac->name;
+}
+
+
 /* The ".macro name[,arg,...]" directive. */
 char *
 do_macro(char **p, int pass)
 {
     char temp[1024];
     char *sp = temp;
-    macro_t *m, *ptr;
 
     skip_white(p);
     if (IS_END(**p))
@@ -338,30 +458,8 @@ do_macro(char **p, int pass)
     }
     *sp = '\0';
 
-    /* Allocate a new macro. */
-    m = malloc(sizeof(macro_t));
-    if (m == NULL)
-	error(ERR_MEM, "new macro");
-    memset(m, 0x00, sizeof(macro_t));
-    strcpy(m->name, current_label->name);
-    strcpy(m->formal, temp);
-    m->defptr = m->def;
-
-    /* Insert in alphabetical order. */
-    if ((macros == NULL) || (strcasecmp((macros)->name, m->name) > 0)) {
-	m->next = macros;
-	macros = m;
-    } else {
-	for (ptr = macros; ptr->next != NULL; ptr = ptr->next)
-		if (strcasecmp(ptr->next->name, m->name) > 0)
-			break;
-
-	m->next = ptr->next;
-	ptr->next = m;
-    }
-
     /* We are now defining a new macro. */
-    curmac = m;
+    curmac = macro_new(current_label->name, temp);
     newmacstate = 1;
 
     return NULL;
@@ -8,9 +8,12 @@
  *
  *		A simple but reasonably useful assembler for the 6502.
  *
- * Usage:	vasm [-dCFqsTvPV] [-p processor] [-l fn] [-o fn] [-Dsym[=val]] file ...
+ * Usage:	vasm [-acdCFOqrRsSTvPVw] [-e count] [-j jobs] [-p processor]
+ *		     [-l fn] [-o fn] [-g fn] [-H dir] [-k fn] [-M fn] [-x fn]
+ *		     [-y fn] [-z fn]
+ *		     [-Dsym[=val]] file ...
  *
- * Version:	@(#)main.c	1.0.12	2026/06/29
+ * Version:	@(#)main.c	1.0.35	2026/10/18
  *
  * Authors:	Fred N. van Kempen, <waltje@varcem.com>
  *		Bernd Bckmann, <https://codeberg.org/boeckmann/asm6502>
@@ -50,6 +53,7 @@
  */
 #include <stdint.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
@@ -78,20 +82,72 @@
 # include <getopt.h>
 #endif
 #include "global.h"
+#include "error.h"
 #include "target.h"
+#include "xref.h"
+#include "srcmap.h"
+#include "pch.h"
+#include "object.h"
+#include "ckpt.h"
+#include "watch.h"
+#include "zpage.h"
+#include "page.h"
+#include "stats.h"
+#include "profile.h"
+#include "jobs.h"
+#include "prefetch.h"
 #include "version.h"
 
 
-int		opt_d,		// set DEBUG env variable to enable debug
+int		opt_a,		// analyze page crossings
+		opt_c,		// list the cycle counts
+		opt_d,		// set DEBUG env variable to enable debug
 		opt_C,		// if true, do case-insensitive symbol names
 		opt_F,		// if true, perform autofill with .org
+		opt_O,		// optimize the generated code
 		opt_P,		// enable Printer mode
 		opt_q,		// be very quiet
-		opt_v;		// more verbose
+		opt_r,		// create a relocatable object file
+		opt_R,		// relax out-of-range branches
+		opt_v,		// more verbose
+		opt_w;		// watch files, assemble again
 char		myname[64],	// my name
 		version[128];	// my full version string
 
 
+/* Long options, and the short options they stand for. */
+static const struct {
+    const char	*name;
+    const char	*opt;
+} long_opts[] = {
+    { "--profile",	"-z"	},
+    { "--quiet",	"-q"	},
+    { "--stats",	"-S"	},
+    { "--verbose",	"-v"	},
+    { "--version",	"-V"	},
+    { "--watch",	"-w"	},
+    { NULL,		NULL	}
+};
+
+static char	*out_name,	// output file
+		*lst_name,	// listing file
+		*sym_name,	// exported symbol table
+		*map_name,	// source line map
+		*pch_name,	// precompiled includes directory
+		*ckpt_name,	// checkpoint file
+		*dep_name,	// dependency file
+		*xrf_name,	// cross reference file
+		*prof_name,	// profile (folded stacks) file
+		*cpu_name;	// initial processor
+static char	**defs;		// symbols defined on the command line
+static char	**files;	// the files we started with
+static int	num_defs,
+		opt_fill,	// the -F setting
+		opt_s,		// show the symbol table
+		opt_S,		// show the statistics
+		full;		// we need all of Pass 2
+
+
 #ifdef _MSC_VER
 extern int	getopt(int ac, char *av[], const char *),
 		optind, opterr;
@@ -152,7 +208,7 @@ init_symbols(void)
 static void
 usage(const char *prog)
 {
-    printf("Usage: %s [-dCFPqsTvV] [-p processor] [-l fn] [-o fn] [-Dsym[=val]] file ...\n", prog);
+    printf("Usage: %s [-acdCFOPqrRsSTvVw] [-e count] [-j jobs] [-p processor] [-l fn] [-o fn] [-g fn] [-H dir] [-k fn] [-M fn] [-x fn] [-y fn] [-z fn] [-Dsym[=val]] file ...\n", prog);
 
     exit(1);
     /*NOTREACHED*/
@@ -172,79 +228,382 @@ banner(void)
 }
 
 
+/*
+ * Assemble the source file(s). In watch mode we do this over and
+ * over again, so everything the previous run (or the source) may
+ * have changed gets set up again here.
+ */
+static int
+assemble(int argc, char *argv[], int first)
+{
+    char *ttext, *base;
+    size_t size;
+    uint32_t off;
+    int c, nfiles, errors = 0;
+
+    stats_reset();
+
+    /* Reset the options the source can change. */
+    opt_F = opt_fill;
+    list_set_syms(opt_s << 1);		// FULL or OFF
+    filenames_idx = -1;			// this indicates "command line"
+    filenames_len = 0;
+    radix = RADIX_DEFAULT;
+
+    /* Create any pre-defined symbols, and those from the command line. */
+    init_symbols();
+    if (cpu_name != NULL)
+	(void)set_cpu(cpu_name, 1);
+    else
+	(void)trg_set_cpu(NULL);
+    for (c = 0; c < num_defs; c++)
+	do_define(defs[c]);
+
+    /* Set up the optional outputs. */
+    if (((map_name != NULL) && !smap_init(map_name)) ||
+	((pch_name != NULL) && !pch_init(pch_name)) ||
+	((ckpt_name != NULL) && !ckpt_init(ckpt_name)) ||
+	((dep_name != NULL) && !file_dep_init(dep_name)) ||
+	((xrf_name != NULL) && !xref_init(xrf_name)) ||
+	((prof_name != NULL) && !prof_init(prof_name))) {
+	fprintf(stderr, "Out of memory!\n");
+	errors = 1;
+	goto ret1;
+    }
+
+    /* Create output file. */
+    if (! output_open(out_name)) {
+	errors = 1;
+	goto ret1;
+    }
+
+    /* Create a listing file if requested. */
+    if ((lst_name != NULL) && !list_init(lst_name)) {
+	fprintf(stderr, "Listing file '%s' could not be created!\n", lst_name);
+	errors = 1;
+	goto ret1;
+    }
+
+    /* Read all input files into our buffer, and what they include ahead. */
+    stats_start(PH_LOAD);
+    if (! opt_w)
+	prefetch_start();
+    text = NULL;
+    size = 0;
+    filenames_idx = 0;
+    while (first < argc) {
+	if (! file_read(argv[first], &text, &size)) {
+		fprintf(stderr, "Error loading file '%s'\n", argv[first]);
+		if (text != NULL)
+			free(text);
+		text = NULL;
+		errors = 1;
+		goto ret1;
+	}
+
+	if (! file_dep(argv[first])) {
+		fprintf(stderr, "Out of memory!\n");
+		errors = 1;
+		goto ret1;
+	}
+
+	if (! file_add(argv[first++], 1, text, size)) {
+		fprintf(stderr, "Out of memory!\n");
+		errors = 1;
+		goto ret1;
+	}
+    }
+    text_len = size;
+    files = realloc(files, (filenames_len + 1) * sizeof(char *));
+    if (!file_buffer(text) || (files == NULL)) {
+	fprintf(stderr, "Out of memory!\n");
+	errors = 1;
+	goto ret1;
+    }
+    for (nfiles = 0; nfiles < filenames_len; nfiles++)
+	files[nfiles] = filenames[nfiles];
+    stats_stop(PH_LOAD);
+
+    /*
+     * Perform Pass 1.
+     *
+     * With checkpoints, we may skip part of the source text. If
+     * that turns out to be too much, we have to do it again.
+     */
+    base = text;
+again:
+    /* The text of the previous round is no longer needed. */
+    file_drop(text);
+    off = ckpt_start(base, size, !full);
+    text = base + off;
+    text_len = size - off;
+    ttext = text;
+    stats_start(PH_PASS1);
+    errors = pass(&ttext, 1);
+    stats_stop(PH_PASS1);
+    if (errors)
+	goto ret1;
+    if (! ckpt_verify()) {
+	output_size = 0;
+	goto again;
+    }
+
+    /*
+     * When relaxing branches, placing zero page variables, or taking
+     * checksums of code further on, repeat it until things are stable.
+     */
+    zp_plan();
+    output_round();
+    if (trg_relax_again()) {
+	file_rewind(files, nfiles);
+	(void)trg_set_cpu(cpu_name);
+	output_size = 0;
+	goto again;
+    }
+
+    /* We have all the files we need, and Pass 2 may fork. */
+    prefetch_stop();
+
+    /* Perform Pass 2. */
+    ttext = text;
+    stats_start(PH_PASS2);
+    errors = pass(&ttext, 2);
+    stats_stop(PH_PASS2);
+    if (errors)
+	goto ret1;
+    stats_start(PH_REPORT);
+
+    /* Show what the optimizer did, if enabled. */
+    trg_report();
+
+    /* Dump the symbols, if enabled. */
+    list_symbols();
+
+    /* Show how the zero page was used, if we allocated it. */
+    list_zpage();
+
+    /* Show what crosses a page, and what .pagesafe saved. */
+    list_pages();
+
+    /* Add the cross reference to the listing, and write its file. */
+    list_xref();
+    if (! xref_write()) {
+	fprintf(stderr, "Cross reference file could not be created!\n");
+	errors = 1;
+    }
+
+    /* Export the symbol table, if requested. */
+    if ((sym_name != NULL) && !sym_export(sym_name)) {
+	fprintf(stderr, "Symbol file '%s' could not be created!\n", sym_name);
+	errors = 1;
+    }
+
+    /* Write the source line map, if requested. */
+    if (! smap_write()) {
+	fprintf(stderr, "Source map file could not be created!\n");
+	errors = 1;
+    }
+
+    /* Tell make(1) which files we used, if requested. */
+    if (! file_dep_write(output_name())) {
+	fprintf(stderr, "Dependency file could not be created!\n");
+	errors = 1;
+    }
+
+    /* Save the checkpoints for the next run, if requested. */
+    if (! ckpt_write()) {
+	fprintf(stderr, "Checkpoint file could not be created!\n");
+	errors = 1;
+    }
+
+    /* Show where the time went, if requested. */
+    if (! prof_write()) {
+	fprintf(stderr, "Profile file could not be created!\n");
+	errors = 1;
+    }
+    stats_stop(PH_REPORT);
+
+ret1:
+    stats_start(PH_CLOSE);
+    list_close(errors);
+
+    file_release();
+    prefetch_close();
+    xref_close();
+    smap_close();
+    file_dep_close();
+    pch_close();
+    ckpt_close();
+    jobs_close();
+    prof_close();
+    trg_relax_close();
+    zp_close();
+    page_close();
+    sym_free(NULL);
+
+    if ((c = output_close(errors)) < 0) {
+	if (! errors)
+		fprintf(stderr, "error writing output file %s\n", out_name);
+	errors = 1;
+    } else {
+	if (!opt_q && !errors)
+		printf("Generated %i bytes of output.\n", c);
+    }
+    obj_close();
+    stats_stop(PH_CLOSE);
+
+    if (opt_S)
+	stats_report();
+
+    if (errors) {
+	if (lst_name != NULL)
+		(void)remove(lst_name);
+    }
+
+    return errors;
+}
+
+
 int
 main(int argc, char *argv[])
 {
-    char *out_name, *lst_name;
-    char *ttext;
-    int c, opt_s;
-    size_t size;
-    int errors = 0;
+    char *end;
+    long l;
+    int c, i;
 
     /* Set option defaults. */
 #ifdef _DEBUG
     opt_d = (getenv("DEBUG") != NULL);
 #endif
-    opt_C = 0;
+    opt_a = opt_c = opt_C = 0;
     opt_F = 1;
-    opt_P = opt_s = 0;
-    opt_q = opt_v = 0;
-    out_name = lst_name = NULL;
-    filenames_idx = -1;			// this indicates "command line"
+    opt_O = opt_P = opt_s = opt_S = 0;
+    opt_q = opt_r = opt_R = opt_v = opt_w = 0;
+    full = 0;
     radix = RADIX_DEFAULT;
 
-    /* Create any pre-defined symbols. */
-    init_symbols();
-
     /* Create a version string. */
     sprintf(myname, "%s", APP_NAME);
     sprintf(version, "version %s (%s, %s)",
 		APP_VERSION, APP_PLATFORM, STR(ARCH));
 
+    /* Not all getopt(3)'s do long options, so we map them ourselves. */
+    for (c = 1; c < argc; c++) {
+	if (! strcmp(argv[c], "--"))
+		break;
+	for (i = 0; long_opts[i].name != NULL; i++) {
+		if (! strcmp(argv[c], long_opts[i].name))
+			argv[c] = (char *)long_opts[i].opt;
+	}
+    }
+
+    defs = (char **)malloc(argc * sizeof(char *));
+    if (defs == NULL) {
+	fprintf(stderr, "Out of memory!\n");
+	return 1;
+    }
+    num_defs = 0;
+
     opterr = 0;
-    while ((c = getopt(argc, argv, "dCD:Fl:o:Pp:qsTvV")) != EOF) switch(c) {
+    while ((c = getopt(argc, argv, "acdCD:e:Fg:H:j:k:l:M:o:OPp:qrRsSTvVwx:y:z:")) != EOF) switch(c) {
+	case 'a':	// analyze page crossings (disabled)
+		opt_a ^= 1;
+		break;
+
+	case 'c':	// list cycle counts (disabled)
+		opt_c ^= 1;
+		break;
+
 	case 'C':	// toggle list-offset display (disabled)
 		opt_C ^= 1;
 		break;
 
 	case 'D':	// define symbol
-		do_define(optarg);
+		defs[num_defs++] = optarg;
 		break;
 
 	case 'd':	// debug mode (disabled)
 		opt_d++;
 		break;
 
+	case 'e':	// max #errors per pass (20, 0 is unlimited)
+		l = strtol(optarg, &end, 10);
+		if ((end == optarg) || (*end != '\0') || (l < 0) || (l > INT_MAX))
+			usage(argv[0]);
+		error_max = (int)l;
+		break;
+
 	case 'F':	// auto-fill for .org (enabled)
 		opt_F ^= 1;
 		break;
 
+	case 'g':	// create source line map (none)
+		map_name = optarg;
+		full = 1;
+		break;
+
+	case 'H':	// use precompiled includes (none)
+		pch_name = optarg;
+		break;
+
+	case 'j':	// #workers for Pass 2 (1)
+		l = strtol(optarg, &end, 10);
+		if ((end == optarg) || (*end != '\0') || (l < 1) || (l > JOBS_MAX))
+			usage(argv[0]);
+		jobs_max = (int)l;
+		break;
+
+	case 'k':	// use checkpoint file (none)
+		ckpt_name = optarg;
+		break;
+
 	case 'l':	// set listing file name (none)
 		lst_name = optarg;
+		full = 1;
+		break;
+
+	case 'M':	// create dependency file (none)
+		dep_name = optarg;
 		break;
 
 	case 'o':	// set output file name (none)
 		out_name = optarg;
 		break;
 
+	case 'O':	// optimize the generated code (disabled)
+		opt_O ^= 1;
+		break;
+
 	case 'P':	// enable Printer mode
 		opt_P++;
 		break;
 
 	case 'p':	// processor name
-		if (! set_cpu(optarg, 1)) {
+		if (! trg_set_cpu(optarg)) {
 			fprintf(stderr, "Unknown processor '%s'.\n", optarg);
 			return 1;
 		}
+		cpu_name = optarg;
 		break;
 
 	case 'q':	// be very quiet during operation (disabled)
 		opt_q ^= 1;
 		break;
 
+	case 'r':	// create a relocatable object file (disabled)
+		opt_r ^= 1;
+		break;
+
+	case 'R':	// relax out-of-range branches (disabled)
+		opt_R ^= 1;
+		break;
+
 	case 's':	// show (or dump) the symbol table
 		opt_s ^= 1;
-		list_set_syms(opt_s << 1);	// FULL or OFF
+		break;
+
+	case 'S':	// show statistics (disabled)
+		opt_S ^= 1;
 		break;
 
 	case 'T':	// list all supported targets
@@ -263,10 +622,46 @@ main(int argc, char *argv[])
 		exit(EXIT_SUCCESS);
 		/*NOTREACHED*/
 
+	case 'w':	// watch the files, and assemble again (disabled)
+		opt_w ^= 1;
+		break;
+
+	case 'x':	// create cross reference (none)
+		xrf_name = optarg;
+		full = 1;
+		break;
+
+	case 'y':	// export symbol table (none)
+		sym_name = optarg;
+		break;
+
+	case 'z':	// profile the source (none)
+		prof_name = optarg;
+		break;
+
 	default:
 		usage(argv[0]);
 		/*NOTREACHED*/
     }
+    opt_fill = opt_F;
+
+    /* Checkpoints assume Pass 1 runs once, so use one or the other. */
+    if ((opt_O || opt_R) && (ckpt_name != NULL)) {
+	fprintf(stderr, "The -k option can not be used with -O or -R.\n");
+	return 1;
+    }
+
+    /* Checkpoints and precompiled includes do not keep relocations. */
+    if (opt_r && ((ckpt_name != NULL) || (pch_name != NULL))) {
+	fprintf(stderr, "The -r option can not be used with -H or -k.\n");
+	return 1;
+    }
+
+    /* These need all of Pass 2 in one place, so do not split it up. */
+    if (opt_a || opt_c || opt_O || opt_r || opt_R || (map_name != NULL) ||
+	(xrf_name != NULL) || (prof_name != NULL) || (pch_name != NULL) ||
+	(ckpt_name != NULL))
+	jobs_max = 1;
 
     /* Say hello. */
     if (! opt_q)
@@ -276,73 +671,28 @@ main(int argc, char *argv[])
     if (optind == argc)
 	usage(argv[0]);
 
-    /* Create output file. */
-    if (! output_open(out_name)) {
-	errors = 1;
-	goto ret0;
-    }
-
-    /* Create a listing file if requested. */
-    if ((lst_name != NULL) && !list_init(lst_name)) {
-	fprintf(stderr, "Listing file '%s' could not be created!\n", lst_name);
-	errors = 1;
-	goto ret0;
-    }
-
-    /* Read all input files into our buffer. */
-    text = NULL;
-    size = 0;
-    filenames_idx = 0;
-    while (optind < argc) {
-	if (! file_read(argv[optind], &text, &size)) {
-		fprintf(stderr, "Error loading file '%s'\n", argv[optind]);
-		errors = 1;
-		goto ret0;
-	}
-
-	file_add(argv[optind++], 1, text, size);
-    }
-    text_len = size;
-
-    /* Perform Pass 1. */
-    ttext = text;
-    errors = pass(&ttext, 1);
-    if (errors)
-	goto ret1;
-
-    /* Perform Pass 2. */
-    ttext = text;
-    errors = pass(&ttext, 2);
-    if (errors)
-	goto ret1;
-
-    /* Dump the symbols, if enabled. */
-    list_symbols();
-
-ret1:
-    list_close(errors);
-
-//    if (text != NULL)
-//	free(text);
-
-    sym_free(NULL);
-
-ret0:
-    if ((c = output_close(errors)) < 0) {
-	if (! errors)
-		fprintf(stderr, "error writing output file %s\n", out_name);
-	errors = 1;
-    } else {
-	if (!opt_q && !errors)
-		printf("Generated %i bytes of output.\n", c);
-    }
-
-    if (errors) {
-	if (lst_name != NULL)
-		(void)remove(lst_name);
-
-	return EXIT_FAILURE;
+    if (! opt_w)
+	return assemble(argc, argv, optind) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    /*
+     * Watch mode. We keep the contents of all files in memory, and
+     * assemble again whenever one of them changes, until stopped.
+     */
+    file_cache_init();
+    (void)watch_init();
+    for (;;) {
+	(void)assemble(argc, argv, optind);
+
+	if (! opt_q)
+		printf("Watching %i files for changes, press Ctrl-C to stop.\n",
+							watch_count());
+	(void)fflush(stdout);
+
+	(void)watch_wait();
+	if (! opt_q)
+		printf("\n");
     }
 
+    /*NOTREACHED*/
     return EXIT_SUCCESS;
 }
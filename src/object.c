@@ -0,0 +1,409 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Create relocatable object files (-r option.)
+ *
+ *		The code goes into named sections, which all start at 0,
+ *		and any value that refers to a section or to an extern
+ *		symbol gets a relocation record, so the linker can fix
+ *		it up when it knows where everything goes. See object.h
+ *		for the format of the file.
+ *
+ *		The output buffer has the bytes in the order they were
+ *		generated, so when we leave a section, we copy what was
+ *		added to it since we entered it.
+ *
+ * Version:	@(#)object.c	1.0.1	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "error.h"
+#include "object.h"
+
+
+typedef struct osect {
+    char	name[ID_LEN];
+    uint32_t	size;			// its size (so far)
+    int		align;			// largest .align in it
+    uint8_t	*data;			// its contents (Pass 2)
+    uint32_t	max;
+} osect_t;
+
+typedef struct oname {
+    char	name[ID_LEN];
+    uint16_t	sect;			// for exported symbols
+    uint32_t	value;
+} oname_t;
+
+typedef struct oreloc {
+    uint16_t	sect,			// where the field is
+		target;			// section, or RELOC_EXT|extern
+    char	kind;
+    uint32_t	off,
+		addend;
+} oreloc_t;
+
+
+static osect_t	*obj_sects;		// all our sections
+static int	obj_nsects,
+		obj_msects;
+static oname_t	*obj_exts,		// the extern symbols
+		*obj_globs;		// the exported symbols
+static int	obj_nexts,
+		obj_mexts,
+		obj_nglobs,
+		obj_mglobs;
+static oreloc_t	*obj_rels;		// the relocations
+static int	obj_nrels,
+		obj_mrels;
+static uint32_t	obj_mark;		// output_size when section entered
+static int	obj_pass;
+
+
+/* Make room for more entries in a table. */
+static void *
+obj_grow(void *ptr, int *max, size_t size)
+{
+    int n = (*max > 0) ? (*max * 2) : 16;
+
+    ptr = realloc(ptr, n * size);
+    if (ptr == NULL)
+	error(ERR_MEM, "object file");
+    *max = n;
+
+    return ptr;
+}
+
+
+/* Add a new section. */
+static int
+obj_add(const char *name)
+{
+    osect_t *s;
+
+    if (obj_nsects >= RELOC_INDEX)
+	error(ERR_RNG, name);
+    if (obj_nsects == obj_msects)
+	obj_sects = obj_grow(obj_sects, &obj_msects, sizeof(osect_t));
+
+    s = &obj_sects[obj_nsects++];
+    memset(s, 0x00, sizeof(osect_t));
+    strncpy(s->name, name, sizeof(s->name) - 1);
+    s->align = 1;
+
+    return obj_nsects;
+}
+
+
+/* Add what was generated since we entered the current section. */
+static void
+obj_leave(void)
+{
+    osect_t *s = &obj_sects[sect - 1];
+    uint32_t n = output_size - obj_mark;
+    uint8_t *ptr;
+
+    if ((obj_pass == 2) && (n > 0)) {
+	if ((s->size + n) > s->max) {
+		ptr = realloc(s->data, s->size + n + 4096);
+		if (ptr == NULL)
+			error(ERR_MEM, "object file");
+		s->data = ptr;
+		s->max = s->size + n + 4096;
+	}
+	memcpy(s->data + s->size, output_buff + obj_mark, n);
+    }
+
+    s->size += n;
+    obj_mark = output_size;
+}
+
+
+/* A pass starts, in the first section. */
+void
+obj_start(int pass)
+{
+    int i;
+
+    if (! opt_r) {
+	sect = RELOC_NONE;
+	return;
+    }
+
+    obj_pass = pass;
+    for (i = 0; i < obj_nsects; i++)
+	obj_sects[i].size = 0;
+    if (pass == 2)
+	obj_nrels = 0;
+
+    if (obj_nsects == 0)
+	(void)obj_add("text");
+    sect = 1;
+    obj_mark = output_size;
+}
+
+
+/* The ".section <name>" directive. */
+void
+obj_section(const char *name, int pass)
+{
+    int i;
+
+    if (! opt_r)
+	error(ERR_OBJONLY, NULL);
+
+    for (i = 0; i < obj_nsects; i++)
+	if (! strcmp(obj_sects[i].name, name))
+		break;
+    if (i == obj_nsects)
+	i = obj_add(name) - 1;
+
+    obj_leave();
+    sect = i + 1;
+    pc = obj_sects[i].size;
+}
+
+
+/* Sections are aligned to the largest .align in them. */
+void
+obj_align(int count)
+{
+    if (opt_r && (count > obj_sects[sect - 1].align))
+	obj_sects[sect - 1].align = count;
+}
+
+
+/* The ".extern <name>" directive. */
+void
+obj_extern(const char *name, int pass)
+{
+    symbol_t *sym;
+
+    if (! opt_r)
+	error(ERR_OBJONLY, NULL);
+
+    /* We only have to do this once. */
+    sym = sym_aquire(name, NULL);
+    if (sym->value.r & RELOC_EXT)
+	return;
+    if (DEFINED(sym->value))
+	error(ERR_REDEF, name);
+
+    if (obj_nexts >= RELOC_INDEX)
+	error(ERR_RNG, name);
+    if (obj_nexts == obj_mexts)
+	obj_exts = obj_grow(obj_exts, &obj_mexts, sizeof(oname_t));
+    memset(&obj_exts[obj_nexts], 0x00, sizeof(oname_t));
+    strncpy(obj_exts[obj_nexts++].name, name, ID_LEN - 1);
+
+    sym->kind = KIND_LBL;
+    sym->filenr = filenames_idx;
+    sym->linenr = line;
+    sym->value.v = 0;
+    sym->value.t = TYPE_WORD | VALUE_DEFINED;
+    sym->value.r = RELOC_EXT | obj_nexts;
+}
+
+
+/* The ".global <name>" directive. */
+void
+obj_global(const char *name, int pass)
+{
+    int i;
+
+    if (! opt_r)
+	error(ERR_OBJONLY, NULL);
+
+    for (i = 0; i < obj_nglobs; i++)
+	if (! strcmp(obj_globs[i].name, name))
+		return;
+
+    if (obj_nglobs == obj_mglobs)
+	obj_globs = obj_grow(obj_globs, &obj_mglobs, sizeof(oname_t));
+    memset(&obj_globs[obj_nglobs], 0x00, sizeof(oname_t));
+    strncpy(obj_globs[obj_nglobs++].name, name, ID_LEN - 1);
+}
+
+
+/* The end of a pass, get the values of what we export. */
+void
+obj_end(int pass)
+{
+    symbol_t *sym;
+    int i;
+
+    if (!opt_r || (pass != 2))
+	return;
+
+    obj_leave();
+
+    for (i = 0; i < obj_nglobs; i++) {
+	sym = sym_lookup(obj_globs[i].name, NULL);
+	if ((sym == NULL) || UNDEFINED(sym->value))
+		error(ERR_UNDEF, obj_globs[i].name);
+	if ((sym->value.r & RELOC_EXT) || RELOC_PART(sym->value))
+		error(ERR_RELOC, obj_globs[i].name);
+
+	obj_globs[i].sect = sym->value.r;
+	obj_globs[i].value = sym->value.v;
+    }
+}
+
+
+/* A field with a relocatable value is about to be generated. */
+void
+emit_reloc(value_t v, int kind, int pass)
+{
+    oreloc_t *r;
+
+    if ((pass != 2) || (v.r == RELOC_NONE))
+	return;
+
+    if (obj_nrels == obj_mrels)
+	obj_rels = obj_grow(obj_rels, &obj_mrels, sizeof(oreloc_t));
+    r = &obj_rels[obj_nrels++];
+
+    r->sect = sect;
+    r->target = RELOC(v);
+    r->off = obj_sects[sect - 1].size + (output_size - obj_mark);
+    r->kind = kind;
+    r->addend = v.v;
+
+    /* A part of a value goes into the low byte of the field. */
+    if (RELOC_PART(v)) {
+	if (kind == OBJ_WORDBE)
+		r->off++;
+	if (v.r & RELOC_HI) {
+		r->kind = OBJ_HI;
+		r->addend = (v.v << 8) | v.rl;
+	} else
+		r->kind = OBJ_LO;
+    }
+}
+
+
+/* A value is used relative to the PC, so it must be in our section. */
+void
+emit_relative(value_t v)
+{
+    if (DEFINED(v) && (v.r != sect))
+	error(ERR_RELOC, NULL);
+}
+
+
+/* Write the object file. */
+int
+obj_write(FILE *fp)
+{
+    const osect_t *s;
+    const oreloc_t *r;
+    uint32_t k;
+    int i;
+
+    fprintf(fp, "%s %i\n", OBJ_MAGIC, OBJ_VERSION);
+
+    for (i = 0; i < obj_nsects; i++) {
+	s = &obj_sects[i];
+	fprintf(fp, "S %s %X %X\n", s->name, s->size, s->align);
+	for (k = 0; k < s->size; k++) {
+		if ((k % OBJ_DATA) == 0)
+			fprintf(fp, (k > 0) ? "\nD " : "D ");
+		fprintf(fp, "%02X", s->data[k]);
+	}
+	if (s->size > 0)
+		fprintf(fp, "\n");
+    }
+
+    for (i = 0; i < obj_nexts; i++)
+	fprintf(fp, "X %s\n", obj_exts[i].name);
+
+    for (i = 0; i < obj_nglobs; i++)
+	fprintf(fp, "G %s %X %X\n", obj_globs[i].name,
+		obj_globs[i].sect, obj_globs[i].value);
+
+    for (i = 0; i < obj_nrels; i++) {
+	r = &obj_rels[i];
+	fprintf(fp, "R %X %X %c %c%X %X\n", r->sect, r->off, r->kind,
+		(r->target & RELOC_EXT) ? 'X' : 'S',
+		r->target & RELOC_INDEX, r->addend);
+    }
+
+    fprintf(fp, "E\n");
+
+    return (ferror(fp) == 0);
+}
+
+
+void
+obj_close(void)
+{
+    int i;
+
+    for (i = 0; i < obj_nsects; i++) {
+	if (obj_sects[i].data != NULL)
+		free(obj_sects[i].data);
+    }
+    if (obj_sects != NULL)
+	free(obj_sects);
+    obj_sects = NULL;
+    obj_nsects = obj_msects = 0;
+
+    if (obj_exts != NULL)
+	free(obj_exts);
+    obj_exts = NULL;
+    obj_nexts = obj_mexts = 0;
+
+    if (obj_globs != NULL)
+	free(obj_globs);
+    obj_globs = NULL;
+    obj_nglobs = obj_mglobs = 0;
+
+    if (obj_rels != NULL)
+	free(obj_rels);
+    obj_rels = NULL;
+    obj_nrels = obj_mrels = 0;
+
+    sect = RELOC_NONE;
+}
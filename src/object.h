@@ -0,0 +1,90 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for the relocatable object files.
+ *
+ * Version:	@(#)object.h	1.0.1	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OBJECT_H
+# define OBJECT_H
+
+
+/*
+ * The object files (written with -r, and read by vlink) are plain
+ * text, with one record per line:
+ *
+ *   VOBJ 1			magic, and version of the format
+ *   S name size align		a section, numbered from 1
+ *   D hex...			data for the last section
+ *   X name			an extern symbol, numbered from 1
+ *   G name sect value		an exported symbol (sect 0 is absolute)
+ *   R sect offset kind target addend
+ *				a relocation, the target is Sn or Xn
+ *   E				the end
+ *
+ * A relocated field gets the address of its target plus the addend.
+ * All numbers are in hex.
+ */
+#define OBJ_MAGIC	"VOBJ"
+#define OBJ_VERSION	1
+#define OBJ_DATA	32		// max #bytes per data record
+
+/* The kinds of relocation. */
+#define OBJ_BYTE	'B'		// a byte
+#define OBJ_WORD	'W'		// a word (little-endian)
+#define OBJ_WORDBE	'V'		// a word (big-endian)
+#define OBJ_DWORD	'D'		// a double-word (little-endian)
+#define OBJ_LO		'L'		// the low byte of a word
+#define OBJ_HI		'H'		// the high byte of a word
+
+
+extern void	obj_start(int);
+extern void	obj_section(const char *, int);
+extern void	obj_align(int);
+extern void	obj_extern(const char *, int);
+extern void	obj_global(const char *, int);
+extern void	obj_end(int);
+extern int	obj_write(FILE *);
+extern void	obj_close(void);
+
+
+#endif	/*OBJECT_H*/
@@ -30,11 +30,26 @@
  *		(or the .NOFILL assembler directive) can be used to disable
  *		this behavior.
  *
+ *		In Pass 2, generated code is only stored in the output
+ *		buffer. Encoding it into the output file is done by the
+ *		writer (see writer.c), using the output_do_xxx functions.
+ *
+ *		For the checksum functions, we also keep the code of each
+ *		round of Pass 1 (and of the one before it), and running
+ *		sums of all these images, which are extended as needed.
+ *		A checksum of code we did not generate yet uses the image
+ *		of the last round, and asks for more rounds until it no
+ *		longer changes.
+ *
+ *		With the -r option, a relocatable object file is created
+ *		instead; that one is written as a whole when we close the
+ *		output (see object.c.)
+ *
  * FIXME:	We probably should merge the little/big endian functions
  *		into one, and have the backends select the proper mode for
  *		them at runtime.
  *
- * Version:	@(#)output.c	1.0.7	2023/06/23
+ * Version:	@(#)output.c	1.0.15	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -76,6 +91,20 @@
 #include <string.h>
 #include "global.h"
 #include "error.h"
+#include "writer.h"
+#include "ckpt.h"
+#include "target.h"
+#include "object.h"
+
+
+/* An image of the output, with running sums. */
+typedef struct outimg {
+    uint8_t	*buf;
+    uint32_t	*sums;			// sums[i] is the sum of buf[0..i-1]
+    uint32_t	size,			// #bytes in the image
+		max,			// #bytes allocated
+		nsums;			// #bytes summed so far
+} outimg_t;
 
 
 #define IHEX_MAX	32		// max #bytes per line
@@ -86,13 +115,24 @@ uint32_t	output_size;		// total #bytes in output buffer
 uint8_t		*output_buff;		// output data buffer
 
 static char	out_path[1024];		// actual output filename
+static char	*out_name;		//  its name, without any prefix
 static int	out_format;
 static FILE	*out_file;		// output file
 static int	out_count,		// current #bytes in buffer
 		out_max;		// max #bytes in buffer
 static uint32_t	out_base;		// our load (base) address
+static uint32_t	out_addr,		// load address of the output line
+		out_done;		// #bytes written to the file
 static uint8_t	*out_line;		// line output buffer
 static int8_t	out_orgdone;		// has a .org been performed?
+static uint8_t	*out_prev;		// last image written (watch mode)
+static long	out_plen;
+static outimg_t	out_pass2,		// the output buffer
+		out_round,		// this round of Pass 1
+		out_last;		// the round before it
+static int	out_ahead;		// a checksum looked ahead
+static uint32_t	out_dlo,		// code that changed in the last
+		out_dhi;		//  round (offsets)
 
 
 static void
@@ -101,7 +141,7 @@ out_flush(int force)
     char temp[1024], *p;
     int base, i, k, sum;
 
-    if (out_file == NULL || out_format == 0)
+    if (out_file == NULL || out_max == 0)
 	return;
 
     if ((out_count < out_max) && !force)
@@ -117,14 +157,14 @@ out_flush(int force)
 
 	if (out_format == 1)	// Intel Hex
 		p += sprintf(p, ":%02X%02X%02X00",
-			k, (out_base >> 8), (out_base & 0xff));
+			k, (out_addr >> 8), (out_addr & 0xff));
 	else			// Motorola SRec
 		p += sprintf(p, "S1%02X%02X%02X",
-			k, (out_base >> 8), (out_base & 0xff));
+			k, (out_addr >> 8), (out_addr & 0xff));
 
 	sum = k;
-	sum += (out_base & 0xff);
-	sum += (out_base >> 8);
+	sum += (out_addr & 0xff);
+	sum += (out_addr >> 8);
 
 	/* Add the data bytes (payload.) */
 	for (i = 0; i < k; i++) {
@@ -144,12 +184,46 @@ out_flush(int force)
 	fprintf(out_file, "%s\n", temp);
 
 	base += k;
-	out_base += k;
+	out_addr += k;
 	out_count -= k;
     }
 }
 
 
+/* Make room for more of an image. */
+static int
+out_grow(outimg_t *img)
+{
+    uint32_t *sums;
+    uint8_t *buf;
+
+    buf = realloc(img->buf, img->max + 65536);
+    if (buf == NULL)
+	return 0;
+    img->buf = buf;
+
+    sums = realloc(img->sums, (img->max + 65536 + 1) * sizeof(uint32_t));
+    if (sums == NULL)
+	return 0;
+    img->sums = sums;
+    img->max += 65536;
+
+    return 1;
+}
+
+
+/* Release an image. */
+static void
+out_free(outimg_t *img)
+{
+    if (img->buf != NULL)
+	free(img->buf);
+    if (img->sums != NULL)
+	free(img->sums);
+    memset(img, 0x00, sizeof(outimg_t));
+}
+
+
 /* Store one byte of data. */
 static void
 out_store(uint8_t b, int pass)
@@ -164,32 +238,156 @@ out_store(uint8_t b, int pass)
 	out_base++;
     }
 
-    /* If not in Pass 2, we're all done. */
-    if (pass != 2)
+    /* In Pass 1, only keep the image for the checksums. */
+    if (pass != 2) {
+	if ((output_size > out_round.max) && !out_grow(&out_round))
+		return;
+	out_round.buf[output_size - 1] = b;
+	out_round.size = output_size;
+	if (out_round.nsums >= output_size)
+		out_round.nsums = output_size - 1;
 	return;
+    }
 
-    /* Store byte in output buffer. */
+    /* Store byte in output buffer, the writer does the rest. */
     output_buff[output_size - 1] = b;
+    out_pass2.size = output_size;
+}
+
+
+/*
+ * In watch mode, the output goes to a temporary file first, and
+ * we only replace the real file if its contents actually changed,
+ * so any tools watching it will not be triggered for nothing. We
+ * keep the last image we wrote in memory, to compare with.
+ */
+static int
+out_update(void)
+{
+    const char *mode;
+    uint8_t *buf;
+    long len;
+    FILE *fp;
+
+    mode = (out_format != 0) ? "r" : "rb";
+
+    /* First time around, compare with what is on disk. */
+    if ((out_prev == NULL) && ((fp = fopen(out_name, mode)) != NULL)) {
+	(void)fseek(fp, 0, SEEK_END);
+	out_plen = ftell(fp);
+	(void)fseek(fp, 0, SEEK_SET);
+	if ((out_plen >= 0) && ((out_prev = malloc(out_plen + 1)) != NULL))
+		out_plen = (long)fread(out_prev, 1, out_plen, fp);
+	(void)fclose(fp);
+    }
+
+    /* Get the new image from the temporary file. */
+    (void)fflush(out_file);
+    len = ftell(out_file);
+    if ((len < 0) || ((buf = malloc(len + 1)) == NULL))
+	return 0;
+    (void)fseek(out_file, 0, SEEK_SET);
+    if ((long)fread(buf, 1, len, out_file) != len) {
+	free(buf);
+	return 0;
+    }
+
+    if ((out_prev != NULL) && (out_plen == len) && !memcmp(out_prev, buf, len)) {
+	if (opt_v)
+		printf("Output file '%s' unchanged\n", out_name);
+	free(buf);
+	return 1;
+    }
+
+    mode = (out_format != 0) ? "w" : "wb";
+    if ((fp = fopen(out_name, mode)) == NULL) {
+	free(buf);
+	return 0;
+    }
+    if ((long)fwrite(buf, 1, len, fp) != len) {
+	(void)fclose(fp);
+	free(buf);
+	return 0;
+    }
+    (void)fclose(fp);
+
+    if (out_prev != NULL)
+	free(out_prev);
+    out_prev = buf;
+    out_plen = len;
+
+    return 1;
+}
+
+
+/* Write out all generated bytes up to (but not including) upto. */
+void
+output_do_data(uint32_t upto)
+{
+    uint8_t b;
+
+    /* An object file is written at the end, by obj_write(). */
+    if (out_file == NULL || output_buff == NULL || out_format == 3)
+	return;
 
     if (out_max > 0) {
-	/*
-	 * This is an ASCII text format with a line buffer.
-	 *
-	 * Do we have room in the output line?
-	 */
-	if (out_count >= out_max) {
-		/* No, we have to flush first. */
-		out_flush(1);
-	}
+	/* This is an ASCII text format with a line buffer. */
+	while (out_done < upto) {
+		b = output_buff[out_done++];
+
+		/* Do we have room in the output line? */
+		if (out_count >= out_max) {
+			/* No, we have to flush first. */
+			out_flush(1);
+		}
 
-	out_line[out_count++] = b;
-    } else {
+		out_line[out_count++] = b;
+	}
+    } else if (out_done < upto) {
 	/* Binary format, just write it out. */
-	fputc(b, out_file);
+	fwrite(output_buff + out_done, 1, upto - out_done, out_file);
+	out_done = upto;
     }
 }
 
 
+/* Flush pending data, and set a new load address. */
+void
+output_do_org(uint32_t addr)
+{
+    if (out_format != 0)
+	out_flush(1);
+
+    out_addr = addr;
+}
+
+
+/* Return the state needed to continue from this point. */
+void
+output_state(uint32_t *base, int *orgdone)
+{
+    *base = out_base;
+    *orgdone = out_orgdone;
+}
+
+
+/* Continue from a point saved with output_state(). */
+void
+output_restore(uint32_t base, int orgdone)
+{
+    out_base = base;
+    out_orgdone = orgdone;
+}
+
+
+/* Return the name of the output file. */
+const char *
+output_name(void)
+{
+    return out_name;
+}
+
+
 /*
  * Create the output file in the requested format.
  *
@@ -206,6 +404,7 @@ int
 output_open(const char *fn)
 {
     char *p, *pfx, *s;
+    const char *mode;
 
     /* Initialize. */
     out_orgdone = 0;
@@ -223,6 +422,8 @@ output_open(const char *fn)
     } else
 	s = out_path;
 
+    out_name = s;
+
     /* Determine the desired format based on suffix. */
     p = strrchr(s, '/');
 #ifdef _WIN32
@@ -237,22 +438,31 @@ output_open(const char *fn)
 
     /* If no suffix at all, attach one. */
     if (p == NULL) {
-	p = "bin";
-	strcat(s, ".bin");
+	p = opt_r ? "obj" : "bin";
+	strcat(s, opt_r ? ".obj" : ".bin");
     }
 
     /* But.. prefixes override a suffix. */
     if (pfx != NULL)
 	p = pfx;
 
-    if (!strcasecmp(p, "ihex") || !strcasecmp(p, "hex")) {
+    if (opt_r) {
+	/* An object file is always that, whatever its name. */
+	if (p == pfx) {
+		fprintf(stderr, "Error: %s (%s)\n", err_msgs[ERR_NO_FMT], p);
+		return 0;
+	}
+	out_max = 0;
+	out_format = 3;
+	mode = "w";
+    } else if (!strcasecmp(p, "ihex") || !strcasecmp(p, "hex")) {
 	out_max = IHEX_MAX;
 	out_format = 1;
-	out_file = fopen(s, "w");
+	mode = "w";
     } else if (!strcasecmp(p, "srec") || !strcasecmp(p, "s19")) {
 	out_max = SREC_MAX;
 	out_format = 2;
-	out_file = fopen(s, "w");
+	mode = "w";
     } else {
 	/* No known format name, assume raw-binary. */
 	out_max = out_format = 0;
@@ -263,10 +473,15 @@ output_open(const char *fn)
 		return 0;
 	}
 
-	/* All good, create the file. */
-	out_file = fopen(s, "wb");
+	mode = "wb";
     }
 
+    /* All good, create the file. */
+    if (opt_w)
+	out_file = tmpfile();
+    else
+	out_file = fopen(s, mode);
+
     if (out_file == NULL) {
 	fprintf(stderr, "Error: %s (%s)\n", err_msgs[ERR_CREATE], s);
 	return 0;
@@ -296,10 +511,13 @@ output_open(const char *fn)
 int
 output_close(int remov)
 {
+    int ret;
+
     if (out_file == NULL)
 	return -1;
 
-    /* Flush any buffered data. */
+    /* Write and flush any remaining data. */
+    output_do_data(output_size);
     out_flush(1);
 
     if (out_format == 1) {
@@ -307,11 +525,25 @@ output_close(int remov)
 	fprintf(out_file, ":00000001FF\n");
     }
 
-    (void)fclose(out_file);
-    out_file = NULL;
+    ret = (int)output_size;
+    if ((out_format == 3) && !remov && !obj_write(out_file)) {
+	/* Do not leave a partial object file around. */
+	remov = 1;
+	ret = -1;
+    }
 
-    if (remov)
-	remove(out_path);
+    if (opt_w) {
+	/* Keep the old file if we failed, or if nothing changed. */
+	if (!remov && !out_update())
+		ret = -1;
+	(void)fclose(out_file);
+    } else {
+	(void)fclose(out_file);
+
+	if (remov)
+		remove(out_name);
+    }
+    out_file = NULL;
 
     if (out_line != NULL) {
 	free(out_line);
@@ -321,23 +553,43 @@ output_close(int remov)
 	free(output_buff);
 	output_buff = NULL;
     }
+    out_pass2.buf = NULL;
+    out_free(&out_pass2);
+    out_free(&out_round);
+    out_free(&out_last);
 
-    return output_size;
+    return ret;
 }
 
 
 void
 output_reset(void)
 {
-    out_base = 0;
+    outimg_t img;
+
+    out_base = out_addr = out_done = 0;
     out_orgdone = 0;
 
+    /* Whatever pass comes next, the last one was (a round of) Pass 1. */
+    img = out_last;
+    out_last = out_round;
+    out_round = img;
+    out_round.size = out_round.nsums = 0;
+    out_ahead = 0;
+
     if (output_size > 0) {
 	/* This is Pass 2, allocate buffer. */
 	output_buff = malloc(output_size);
 	if (output_buff == NULL)
 		error(ERR_MEM, "output buffer");
 	memset(output_buff, 0x00, output_size);
+
+	out_free(&out_pass2);
+	out_pass2.sums = malloc((output_size + 1) * sizeof(uint32_t));
+	if (out_pass2.sums == NULL)
+		error(ERR_MEM, "output buffer");
+	out_pass2.buf = output_buff;
+	out_pass2.max = output_size;
     }
 
     output_size = out_count = 0;
@@ -354,6 +606,8 @@ output_reset(void)
 void
 output_addr(uint32_t addr, int pass)
 {
+    wrec_t r;
+
     if (out_format == 0) {
 	/*
 	 * Optionally, "fill out" the space with $00 bytes.
@@ -374,8 +628,13 @@ output_addr(uint32_t addr, int pass)
 	}
     } else {
 	/* Flush pending data for text formats. */
-	if (pass == 2)
-		out_flush(1);
+	if (pass == 2) {
+		memset(&r, 0x00, sizeof(r));
+		r.type = WR_ORG;
+		r.addr = addr;
+		writer_put(&r, NULL, 0, NULL);
+		ckpt_event(WR_ORG, addr);
+	}
     }
 
     /* Either way, set the new origin. */
@@ -388,17 +647,33 @@ output_addr(uint32_t addr, int pass)
  */
 void
 output_start(uint32_t addr, int pass)
+{
+    wrec_t r;
+
+    if (pass != 2)
+	return;
+
+    memset(&r, 0x00, sizeof(r));
+    r.type = WR_START;
+    r.addr = addr;
+    writer_put(&r, NULL, 0, NULL);
+    ckpt_event(WR_START, addr);
+}
+
+
+/* Flush any buffered data, and write the start address record. */
+void
+output_do_start(uint32_t addr)
 {
     char temp[128], *p;
     int sum;
 
-    /* Flush any buffered data. */
-    if (pass != 2)
+    if (out_file == NULL)
 	return;
 
     out_flush(1);
 
-    if (out_format != 0) {
+    if (out_max > 0) {
 	p = temp;
 
 	if (out_format == 1)	// Intel Hex
@@ -487,3 +762,153 @@ emit_dword_be(uint32_t w, int pass)
     out_store(w >> 8, pass);
     out_store(w & 0xff, pass);
 }
+
+
+/* Take back code counted in Pass 1, which an optimizer dropped. */
+void
+emit_undo(uint32_t n, int pass)
+{
+    if (pass != 1)
+	return;
+
+    output_size -= n;
+    if (out_format == 0)
+	out_base -= n;
+
+    out_round.size = output_size;
+    if (out_round.nsums > output_size)
+	out_round.nsums = output_size;
+}
+
+
+/* Put back the code generated before a checkpoint we restored. */
+void
+output_preload(const uint8_t *data, uint32_t len, int pass)
+{
+    outimg_t *img = (pass == 2) ? &out_pass2 : &out_round;
+
+    while (len > img->max)
+	if (! out_grow(img))
+		return;
+
+    memcpy(img->buf, data, len);
+    img->size = len;
+    img->nsums = 0;
+}
+
+
+/*
+ * Find the image with the code from 'addr' for 'len' bytes. In
+ * Pass 2 this is the output buffer, and in Pass 1 the image of
+ * this round. If we did not get there yet, use the last round.
+ */
+static outimg_t *
+out_image(uint32_t addr, uint32_t len, int pass)
+{
+    outimg_t *img = (pass == 2) ? &out_pass2 : &out_round;
+    uint32_t off = addr - org;
+
+    if (addr < org)
+	return NULL;
+
+    if ((img->buf != NULL) && (len <= img->size) && (off <= (img->size - len)))
+	return img;
+
+    /* It looks ahead, so it has to settle in later rounds. */
+    if (pass == 1)
+	out_ahead = 1;
+
+    /* If that code was still changing when we stopped, it is wrong. */
+    if ((pass == 2) && (off < out_dhi) && ((off + len) > out_dlo))
+	error(ERR_CONVERGE, NULL);
+
+    img = &out_last;
+    if ((img->buf != NULL) && (len <= img->size) && (off <= (img->size - len)))
+	return img;
+
+    return NULL;
+}
+
+
+/*
+ * Return the code from 'addr' for 'len' bytes, or NULL if we do
+ * not have it (yet.)
+ */
+const uint8_t *
+output_data(uint32_t addr, uint32_t len, int pass)
+{
+    outimg_t *img = out_image(addr, len, pass);
+
+    if (img == NULL)
+	return NULL;
+
+    return img->buf + (addr - org);
+}
+
+
+/*
+ * Return the sum of the code from 'addr' for 'len' bytes, using
+ * the running sums of the image. Returns 0 if we do not have it.
+ */
+int
+output_sum(uint32_t addr, uint32_t len, int pass, uint32_t *sum)
+{
+    outimg_t *img = out_image(addr, len, pass);
+    uint32_t off = addr - org;
+    uint32_t i;
+
+    if (img == NULL)
+	return 0;
+
+    /* Extend the running sums as far as needed. */
+    if (img->nsums == 0)
+	img->sums[0] = 0;
+    for (i = img->nsums; i < (off + len); i++)
+	img->sums[i + 1] = img->sums[i] + img->buf[i];
+    if (img->nsums < (off + len))
+	img->nsums = off + len;
+
+    *sum = img->sums[off + len] - img->sums[off];
+
+    return 1;
+}
+
+
+/* A checksum could not be taken yet. */
+void
+output_later(void)
+{
+    out_ahead = 1;
+}
+
+
+/*
+ * Called after each round of Pass 1. If a checksum looked ahead,
+ * we need another round, until the code no longer changes. We keep
+ * the part that changed, in case we run out of rounds.
+ */
+void
+output_round(void)
+{
+    uint32_t lo, hi;
+
+    out_dlo = out_dhi = 0;
+    if (! out_ahead)
+	return;
+
+    hi = (out_round.size < out_last.size) ? out_round.size : out_last.size;
+    for (lo = 0; lo < hi; lo++)
+	if (out_round.buf[lo] != out_last.buf[lo])
+		break;
+    if (out_round.size != out_last.size)
+	hi = (out_round.size > out_last.size) ? out_round.size : out_last.size;
+    else
+	while ((hi > lo) && (out_round.buf[hi - 1] == out_last.buf[hi - 1]))
+		hi--;
+
+    if (lo < hi) {
+	out_dlo = lo;
+	out_dhi = hi;
+	trg_relax_round();
+    }
+}
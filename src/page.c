@@ -0,0 +1,370 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Analyze page crossings.
+ *
+ *		On the 6502, a taken branch to another page, and an indexed
+ *		read that crosses into the next page, take one more cycle.
+ *		With the -a option, Pass 2 records every branch that goes
+ *		to another page, and every labelled table (a label followed
+ *		by nothing but data) that straddles a page boundary.
+ *
+ *		A block of code or data between .pagesafe and .endpagesafe
+ *		is moved to the start of the next page (by padding, just
+ *		like .align does) if it would cross one. As we only know
+ *		that at its end, this takes another round of Pass 1 (see
+ *		trg_relax_round.) Once moved, a block stays moved, so the
+ *		rounds always come to an end.
+ *
+ *		For the moved blocks, we count the taken branches within
+ *		them, and the indexed reads of them, that would otherwise
+ *		have crossed a page, to show the cycles this saves.
+ *
+ * Version:	@(#)page.c	1.0.1	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "error.h"
+#include "target.h"
+#include "page.h"
+
+
+#define PAGE(a)		((a) & 0xff00)
+
+
+static pgblock_t *page_blk;		// all .pagesafe blocks
+static int	page_nblk,
+		page_sblk,
+		page_seq,		// blocks seen in this pass
+		page_open;		// block we are in, or -1
+static pgitem_t	*page_tab;		// things crossing a page
+static int	page_nitem,
+		page_size;
+static uint32_t	page_sbranch,		// cycles saved by the blocks
+		page_sindex;
+
+/* The labelled table we are looking at. */
+static struct {
+    const symbol_t *sym;
+    uint32_t	start,
+		end;
+} page_tbl;
+
+
+/* Record something that crosses a page. */
+static pgitem_t *
+page_add(int kind, uint32_t from, uint32_t to)
+{
+    pgitem_t *item;
+
+    if (page_nitem == page_size) {
+	item = realloc(page_tab, (page_size + 64) * sizeof(pgitem_t));
+	if (item == NULL)
+		error(ERR_MEM, "page crossings");
+	page_tab = item;
+	page_size += 64;
+    }
+
+    item = &page_tab[page_nitem++];
+    memset(item, 0x00, sizeof(pgitem_t));
+    item->kind = kind;
+    item->file = filenames_idx;
+    item->line = line;
+    item->from = from;
+    item->to = to;
+
+    return item;
+}
+
+
+/* We are done with a table, see if it straddles a page. */
+static void
+page_table(void)
+{
+    pgitem_t *item;
+
+    if ((page_tbl.sym != NULL) && (page_tbl.end > page_tbl.start) &&
+	(PAGE(page_tbl.start) != PAGE(page_tbl.end - 1))) {
+	item = page_add(PAGE_TABLE, page_tbl.start, page_tbl.end);
+	item->file = page_tbl.sym->filenr;
+	item->line = page_tbl.sym->linenr;
+	strcpy(item->name, page_tbl.sym->name);
+    }
+
+    page_tbl.sym = NULL;
+}
+
+
+/* Find the moved block that contains an address. */
+static const pgblock_t *
+page_find(uint32_t addr)
+{
+    int i;
+
+    for (i = 0; i < page_nblk; i++) {
+	if (page_blk[i].moved && (page_blk[i].pad > 0) &&
+	    (addr >= page_blk[i].start) && (addr < page_blk[i].end))
+		return &page_blk[i];
+    }
+
+    return NULL;
+}
+
+
+/* Start a pass. */
+void
+page_start(int pass)
+{
+    page_seq = 0;
+    page_open = -1;
+    page_tbl.sym = NULL;
+
+    if (pass == 2) {
+	page_nitem = 0;
+	page_sbranch = page_sindex = 0;
+    }
+}
+
+
+/*
+ * Called after each line of Pass 2, with the global label it
+ * defined (if any), and where its code or data starts and ends.
+ */
+void
+page_line(int pass, const symbol_t *sym,
+	  uint32_t start, uint32_t end, int data)
+{
+    if ((pass != 2) || !opt_a)
+	return;
+
+    if (sym != NULL) {
+	page_table();
+	page_tbl.sym = sym;
+	page_tbl.start = page_tbl.end = start;
+    }
+
+    if (end == start)
+	return;
+
+    if ((page_tbl.sym != NULL) && data && (page_tbl.end == start))
+	page_tbl.end = end;
+    else
+	page_table();
+}
+
+
+/* A branch at 'at', with the next instruction at 'from'. */
+void
+page_branch(int pass, uint32_t at, uint32_t from, uint32_t to)
+{
+    const pgblock_t *blk;
+
+    if (pass != 2)
+	return;
+
+    if (PAGE(from) != PAGE(to)) {
+	if (opt_a) {
+		(void)page_add(PAGE_BRANCH, from, to);
+		if (! relax_line)
+			relax_line = 'P';
+	}
+	return;
+    }
+
+    /* Would it have crossed if its block had not been moved? */
+    blk = page_find(at);
+    if ((blk != NULL) && (to >= blk->start) && (to < blk->end) &&
+	(PAGE(from - blk->pad) != PAGE(to - blk->pad)))
+	page_sbranch++;
+}
+
+
+/* An indexed read (absolute, X or Y) from 'base'. */
+void
+page_index(int pass, uint32_t base)
+{
+    const pgblock_t *blk;
+
+    if (pass != 2)
+	return;
+
+    blk = page_find(base);
+    if ((blk != NULL) &&
+	(PAGE(base - blk->pad) != PAGE(blk->end - 1 - blk->pad)))
+	page_sindex++;
+}
+
+
+/* The .pagesafe directive. */
+void
+page_block(int pass)
+{
+    pgblock_t *blk;
+    uint32_t pad = 0, i;
+    int n;
+
+    if (page_open >= 0)
+	error(ERR_ENDPAGE, NULL);
+
+    n = page_seq++;
+    if (n >= page_sblk) {
+	blk = realloc(page_blk, (page_sblk + 16) * sizeof(pgblock_t));
+	if (blk == NULL)
+		error(ERR_MEM, "page safe blocks");
+	memset(blk + page_sblk, 0x00, 16 * sizeof(pgblock_t));
+	page_blk = blk;
+	page_sblk += 16;
+    }
+    if (n >= page_nblk)
+	page_nblk = n + 1;
+    blk = &page_blk[n];
+
+    /* If it has to be moved, pad up to the next page. */
+    if (blk->moved && (pc & 0xff))
+	pad = 0x100 - (pc & 0xff);
+    for (i = 0; i < pad; i++) {
+	emit_byte(0x00, pass);
+
+	pc++;
+    }
+
+    /* Pass 2 uses where Pass 1 put it, also before we get there. */
+    if (pass == 1) {
+	blk->pad = pad;
+	blk->start = blk->end = pc;
+	blk->file = filenames_idx;
+	blk->line = line;
+    }
+    page_open = n;
+}
+
+
+/* The .endpagesafe directive. */
+void
+page_endblock(int pass)
+{
+    pgblock_t *blk;
+
+    if (page_open < 0)
+	error(ERR_PAGE, NULL);
+    blk = &page_blk[page_open];
+    page_open = -1;
+
+    if ((pc - blk->start) > 0x100)
+	error(ERR_PAGESIZE, NULL);
+    if (pass == 2)
+	return;
+
+    /* It crosses a page, so move it in the next round. */
+    blk->end = pc;
+    if ((blk->end > blk->start) &&
+	(PAGE(blk->start) != PAGE(blk->end - 1)) && !blk->moved) {
+	blk->moved = 1;
+	trg_relax_round();
+    }
+}
+
+
+/* Called at the end of a pass, returns 1 if a block is still open. */
+int
+page_end(int pass)
+{
+    if (pass == 2)
+	page_table();
+
+    return (page_open >= 0);
+}
+
+
+/* Return the number of blocks seen in this pass. */
+int
+page_count(void)
+{
+    return page_seq;
+}
+
+
+/* Return the things crossing a page, for the listing. */
+const pgitem_t *
+page_items(int *n)
+{
+    *n = page_nitem;
+
+    return page_tab;
+}
+
+
+/* Return the .pagesafe blocks, for the listing. */
+const pgblock_t *
+page_blocks(int *n)
+{
+    *n = page_nblk;
+
+    return page_blk;
+}
+
+
+/* Return the cycles saved by moving blocks. */
+void
+page_saved(uint32_t *branches, uint32_t *reads)
+{
+    *branches = page_sbranch;
+    *reads = page_sindex;
+}
+
+
+void
+page_close(void)
+{
+    if (page_blk != NULL)
+	free(page_blk);
+    page_blk = NULL;
+    page_nblk = page_sblk = 0;
+
+    if (page_tab != NULL)
+	free(page_tab);
+    page_tab = NULL;
+    page_nitem = page_size = 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for the page crossing analysis.
+ *
+ * Version:	@(#)page.h	1.0.2	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PAGE_H
+# define PAGE_H
+
+
+/* Something that crosses a page. */
+typedef struct pgitem {
+    uint8_t	kind;
+#define PAGE_BRANCH	1		//  a branch to another page
+#define PAGE_TABLE	2		//  a table straddling a page
+    int		file;			// where it is
+    int		line;
+    uint32_t	from,			// branch, or start of table
+		to;			// target, or end of table
+    char	name[ID_LEN];		// name of the table
+} pgitem_t;
+
+/* A .pagesafe block. */
+typedef struct pgblock {
+    uint32_t	start,			// where it was placed
+		end,
+		pad;			// bytes of padding before it
+    int		moved;			// it must start on a page
+    int		file;			// where it is
+    int		line;
+} pgblock_t;
+
+
+extern void	page_start(int);
+extern void	page_line(int, const symbol_t *, uint32_t, uint32_t, int);
+extern void	page_branch(int, uint32_t, uint32_t, uint32_t);
+extern void	page_index(int, uint32_t);
+extern void	page_block(int);
+extern void	page_endblock(int);
+extern int	page_end(int);
+extern int	page_count(void);
+extern const pgitem_t *page_items(int *);
+extern const pgblock_t *page_blocks(int *);
+extern void	page_saved(uint32_t *, uint32_t *);
+extern void	page_close(void);
+
+
+#endif	/*PAGE_H*/
@@ -8,7 +8,7 @@
  *
  *		Parse the source input, process it, and generate output.
  *
- * Version:	@(#)parse.c	1.0.14	2023/09/28
+ * Version:	@(#)parse.c	1.0.34	2026/10/18
  *
  * Authors:	Fred N. van Kempen, <waltje@varcem.com>
  *		Bernd Bckmann, <https://codeberg.org/boeckmann/asm6502>
@@ -55,7 +55,17 @@
 #include "global.h"
 #define HAVE_SETJMP_H
 #include "error.h"
+#include "writer.h"
+#include "xref.h"
+#include "srcmap.h"
+#include "pch.h"
+#include "ckpt.h"
 #include "target.h"
+#include "zpage.h"
+#include "page.h"
+#include "profile.h"
+#include "object.h"
+#include "jobs.h"
 
 
 int		line,			// currently processed line number
@@ -65,12 +75,19 @@ int8_t		radix,			// current numerical radix
 		auto_local;		// state for creating locals
 symbol_t	*current_label;		// search scope for local labels
 const struct pseudo *psop;		// current pseudo/directive
-int8_t		iflevel,		// current level of conditionals
-		ifstate, newifstate,	// current conditional state
-		ifstack[MAX_IFLEVEL];
-int8_t		rptlevel,
-		rptstate, newrptstate;
-repeat_t	rptstack[MAX_RPTLEVEL];
+int		iflevel;		// current level of conditionals
+int8_t		ifstate, newifstate,	// current conditional state
+		*ifstack;
+int		rptlevel;
+int8_t		rptstate, newrptstate;
+repeat_t	*rptstack;
+int		cyclevel;		// current level of cycle blocks
+int		cyc_line[2];		// cycles of the current line
+uint32_t	cyc_total[2],		// cycles counted so far
+		cyc_base[2];		//  at the start of the block
+int		relax_iter;		// round of Pass 1 when relaxing
+uint32_t	relax_moved;		// labels moved in this round
+int8_t		relax_line;		// line was relaxed or optimized
 
 /*
  * The program counter and output counter may not be in sync
@@ -80,6 +97,51 @@ repeat_t	rptstack[MAX_RPTLEVEL];
 uint32_t	org = 0,		// load address
 		pc = 0,			// addr of currently assembled instr
 		sa = 0;			// start addr for generated code (.end)
+uint16_t	sect = RELOC_NONE;	// section we are in (object mode)
+
+/* The conditional and repeat stacks grow as needed. */
+static int	if_max,
+		rpt_max;
+
+
+/*
+ * Grow a stack (or table) of items of the given size, so that
+ * it has an entry n. New entries are cleared.
+ */
+void *
+stack_grow(void *stk, int *max, int n, size_t size)
+{
+    int old = *max;
+
+    if (n < *max)
+	return stk;
+
+    while (*max <= n)
+	*max = (*max > 0) ? (*max * 2) : 16;
+    stk = realloc(stk, (size_t)*max * size);
+    if (stk == NULL)
+	error(ERR_MEM, NULL);
+    memset((char *)stk + ((size_t)old * size), 0x00, (size_t)(*max - old) * size);
+
+    return stk;
+}
+
+
+/* Enter a conditional block, saving the current state. */
+void
+if_push(int8_t state)
+{
+    ifstack = stack_grow(ifstack, &if_max, iflevel, sizeof(int8_t));
+    ifstack[iflevel++] = state;
+}
+
+
+/* Make room for another repeat block (the one after the top is used, too.) */
+void
+rpt_room(void)
+{
+    rptstack = stack_grow(rptstack, &rpt_max, rptlevel + 1, sizeof(repeat_t));
+}
 
 
 #ifdef _DEBUG
@@ -532,18 +594,137 @@ skip_macro:
 }
 
 
-int
-pass(char **p, int pass)
+/* Check if a word is one of the conditional directives. */
+static int
+is_cond(const char *p)
+{
+    static const char *conds[] = {
+	"IF", "IFDEF", "IFN", "IFNDEF", "ELSE", "ENDIF", "FI", NULL
+    };
+    char id[8];
+    int i;
+
+    if (*p == DOT_CHAR)
+	p++;
+
+    for (i = 0; isalpha(*p); i++) {
+	if (i >= sizeof(id) - 1)
+		return 0;
+	id[i] = (char)toupper(*p++);
+    }
+    id[i] = '\0';
+
+    /* Must be a full word, and not a label. */
+    if (i == 0 || isalnum(*p) || IS_IDENT(*p) || (*p == COLON_CHAR))
+	return 0;
+
+    for (i = 0; conds[i] != NULL; i++)
+	if (! strcmp(id, conds[i]))
+		return 1;
+
+    return 0;
+}
+
+
+/*
+ * Skip over lines in an inactive conditional block.
+ *
+ * While the current conditional is false, nothing on a line is
+ * executed, except for the conditional directives themselves, as
+ * we need those to keep track of the nesting. So, rather than
+ * sending every line through statement(), we scan ahead line by
+ * line, only looking at the first word (or the second one, if the
+ * first one is a label), and stop at the first line that looks like
+ * it has a conditional on it. That line (and the last line of the
+ * current file) is then processed the regular way.
+ *
+ * In Pass 2 we still have to list the skipped lines, so we bump the
+ * line counter per line there. In Pass 1, we just do it in bulk.
+ */
+static void
+skip_inactive(char **p, int pass)
+{
+    char *sp, *ep;
+    int n = 0;
+
+    /* Nothing to list for the skipped lines. */
+    psop = NULL;
+
+    for (sp = *p; ; sp = ep + 1) {
+	/* Find the end of this line. */
+	ep = sp + strcspn(sp, "\n\003\032");
+
+	/* Let the last line of a file or macro be handled normally. */
+	if ((*ep != '\n') || (ep[1] == '\0') ||
+	    (ep[1] == ETX_CHAR) || (ep[1] == EOF_CHAR)) break;
+
+	/* First word, skipping any whitespace. */
+	*p = sp;
+	skip_white(p);
+	if (is_cond(*p))
+		break;
+
+	/* Could be a label, so check the second word as well. */
+	if (isalpha(**p) || (**p == ALPHA_CHAR) || IS_IDENT(**p)) {
+		do {
+			(*p)++;
+		} while (isalnum(**p) || IS_IDENT(**p));
+		if (**p == COLON_CHAR)
+			(*p)++;
+		skip_white(p);
+		if (is_cond(*p))
+			break;
+	}
+
+	/* Nothing of interest, so skip this line. */
+	if (pass == 2) {
+		list_line(sp);
+		line++;
+	} else
+		n++;
+    }
+
+    *p = sp;
+    line += n;
+}
+
+
+/* Record an error at the current location. */
+static void
+pass_error(int err)
 {
     const char *msg;
+
+    if (err < ERR_MAXERR)
+	msg = err_msgs[err];
+    else
+	msg = trg_error(err);
+
+    /* Past the last file, blame the first one. */
+    error_log(filenames[(filenames_idx < filenames_len) ? filenames_idx : 0],
+	      line, msg);
+}
+
+
+/*
+ * Note that p is volatile, as we set it to NULL between the
+ * setjmp() for each line and the longjmp() from error().
+ */
+int
+pass(char ** volatile p, int pass)
+{
     char *newtext, *newp;
     char *list;
-    int err;
+    const char *mname;
+    symbol_t *label0;
+    uint32_t pc0, size0;
+    int err, mline, gave_up;
 
     if (opt_v)
 	printf("Pass %i:\n", pass);
 
     errors = 0;
+    gave_up = 0;
     found_end = 0;
     line = 1;
     auto_local = 1;
@@ -552,33 +733,75 @@ pass(char **p, int pass)
     filenames_idx = 0;
     iflevel = 0;
     ifstate = 1;
-    memset(ifstack, 0x00, sizeof(ifstack));
     rptlevel = 0;
     rptstate = 0;
-    memset(rptstack, 0x00, sizeof(rptstack));
+    rpt_room();
+    memset(rptstack, 0x00, (size_t)rpt_max * sizeof(repeat_t));
+    cyclevel = 0;
+    cyc_total[0] = cyc_total[1] = 0;
+    cyc_base[0] = cyc_base[1] = 0;
+    trg_relax_start(pass);
+    zp_start(pass);
+    page_start(pass);
     maclevel = 0;
     macstate = 0;
 
     pc = 0;
+    jobs_start(pass);
     output_reset();
+    obj_start(pass);
+
+    /* In Pass 2, the writer takes care of the output and listing. */
+    if (pass == 2) {
+	/* Unless we are a worker, which saves its records instead. */
+	if (! jobs_fork())
+		writer_start();
+	xref_start();
+	smap_start();
+    }
 
     list_set_head(NULL);
     list_set_head_sub(NULL);
     list_save(pc);
 
     macro_reset();
+    pch_start(pass);
+    prof_start(pass);
 
+    /* Continue from a checkpoint (or snapshot), if we have one. */
     if ((err = setjmp(error_jmp)) == 0) {
-	while (p && **p) {
-		/* Initialize per-line variables. */
-		psop = NULL;
-		newp = NULL;
-		list = *p;
-		newline = line + 1;
-		newifstate = ifstate;
-		newrptstate = rptstate;
-		newmacstate = macstate;
+	ckpt_restore(pass, *p);
+	jobs_restore(p, pass);
+    } else {
+	pass_error(err);
+	p = NULL;
+    }
 
+    while (p && **p) {
+	/* Fast-forward through inactive conditional blocks. */
+	if (!ifstate && !macstate && !maclevel && !rptlevel)
+		skip_inactive(p, pass);
+
+	/* Initialize per-line variables. */
+	psop = NULL;
+	newp = NULL;
+	list = *p;
+	newline = line + 1;
+	newifstate = ifstate;
+	newrptstate = rptstate;
+	newmacstate = macstate;
+
+	pc0 = pc;
+	size0 = output_size;
+	label0 = current_label;
+	cyc_line[0] = cyc_line[1] = 0;
+	relax_line = 0;
+
+	/* The previous line is done, time this one. */
+	if (prof_on)
+		prof_line(list);
+
+	if ((err = setjmp(error_jmp)) == 0) {
 		/* Parse the current line. */
 		newtext = statement(p, &newp, pass);
 
@@ -587,62 +810,110 @@ pass(char **p, int pass)
 		if (! IS_END(**p))
 			error(ERR_EOL, NULL);
 
-		if ((pass == 2) && ((rptlevel == 0) || rptstate))
-			list_line(list);
+		/* Map the generated code back to this line. */
+		if ((pass == 2) && (output_size > size0)) {
+			mname = macro_current(list, &mline);
+			smap_add(pc0, output_size - size0, mname, mline);
+		}
 
-		/* Update our state. */
-		macstate = newmacstate;
-		ifstate = newifstate;
-		rptstate = newrptstate;
+		/* Look for tables that straddle a page. */
+		page_line(pass, (current_label != label0) ? current_label : NULL,
+			  pc0, pc, (psop != NULL) &&
+				   ((pc - pc0) == (output_size - size0)));
+	} else {
+		/* One more than we may report? Then give up here. */
+		if (error_max && (errors > error_max)) {
+			errors--;
+			gave_up = 1;
+			break;
+		}
 
-		/* OK, skip into the next line. */
-		skip_eol(p);
+		/* Record the error, and carry on with the next line. */
+		pass_error(err);
+		if (err == ERR_MEM)
+			break;
 
-		/* End of macro reached? */
-		if (**p == ETX_CHAR) {
-			/* Close macro and jump back into source. */
-			macro_close(p);
+		newtext = newp = NULL;
+		while (! IS_END(**p))
+			(*p)++;
+	}
 
-			/* Now back in source file, skip EOL here, too. */
-			skip_eol(p);
-		}
+	if ((pass == 2) && ((rptlevel == 0) || rptstate))
+		list_line(list);
 
-		/* End of current file reached? */
-		if (**p == EOF_CHAR) {
-			/* Skip the EOF.. */
-			(*p)++;
+	/* Update our state. */
+	macstate = newmacstate;
+	ifstate = newifstate;
+	rptstate = newrptstate;
+
+	/* OK, skip into the next line. */
+	skip_eol(p);
+
+	/* End of macro reached? */
+	if (**p == ETX_CHAR) {
+		/* Close macro and jump back into source. */
+		macro_close(p);
+
+		/* Now back in source file, skip EOL here, too. */
+		skip_eol(p);
+	}
+
+	/*
+	 * End of current file reached? Nested files that end
+	 * at the same place leave several EOF markers in a row.
+	 */
+	while (**p == EOF_CHAR) {
+		/* Skip the EOF.. */
+		(*p)++;
+		ckpt_leave();
 next_file:
-			/* .. and pop into the new file. */
-			filenames_idx++;
-			line = filelines[filenames_idx];
-		}
+		/* .. and pop into the new file. */
+		filenames_idx++;
+		line = newline = filelines[filenames_idx];
 
-		if (found_end) {
-			found_end = 0;
+		pch_leave(pass);
+		prof_leave();
+	}
 
-			/* If we are in an included file, go down a level. */
-			if (filenames_idx > 0)
-				goto next_file;
+	if (found_end) {
+		found_end = 0;
 
-			/* Otherwise, force to be done. */
-			p = NULL;
-		}
+		/* If we are in an included file, go down a level. */
+		if (filenames_idx > 0)
+			goto next_file;
 
-		/* Source of input may have changed on us! */
-		if (newp != NULL) {
-			*p = newp;
-			newp = NULL;
-			maclevel++;
-		}
-		if (newtext != NULL)
-			text = newtext;
+		/* Otherwise, force to be done. */
+		p = NULL;
+	}
 
-		if (!maclevel && (!rptstate || !rptstack[rptlevel].repeating))
-			line = newline;
+	/* Source of input may have changed on us! */
+	if (newp != NULL) {
+		*p = newp;
+		newp = NULL;
+		maclevel++;
+	}
+	if (newtext != NULL)
+		text = newtext;
+
+	/* An .endrep that loops back has set newline, too. */
+	if (! maclevel)
+		line = newline;
 
-		list_save(pc);
+	list_save(pc);
+
+	/* Back at the top level? Take a checkpoint (or snapshot.) */
+	if (p != NULL) {
+		ckpt_boundary(*p, pass);
+		jobs_boundary(*p, pass);
 	}
+    }
+    if (prof_on)
+	prof_line(NULL);
 
+    /* Only check for the end of input if we actually got there. */
+    if ((p != NULL) && (**p != '\0')) {
+	/* We bailed out early, nothing else to check. */
+    } else if ((err = setjmp(error_jmp)) == 0) {
 	/* Make sure we have matched MACRO..ENDM at the end. */
 	if (maclevel > 0)
 		error(ERR_ENDM, "** end of input**");
@@ -654,18 +925,33 @@ next_file:
 	/* Make sure we have matched REPEAT..ENDREP at the end. */
 	if (rptlevel > 0)
 		error(ERR_ENDREP, "** end of input**");
-    } else {
-	if (err < ERR_MAXERR)
-		msg = err_msgs[err];
-	else
-		msg = trg_error(err);
-
-	printf("%s:%i: error: %s",
-		filenames[filenames_idx], line, msg);
-	if (error_hint[0] != '\0')
-		printf(" (%s)", error_hint);
-	printf("\n");
+
+	/* Make sure we have matched CYCLES..ENDCYCLES at the end. */
+	if (cyclevel > 0)
+		error(ERR_ENDCYC, "** end of input**");
+
+	/* Make sure we have matched PAGESAFE..ENDPAGESAFE at the end. */
+	if (page_end(pass))
+		error(ERR_ENDPAGE, "** end of input**");
+
+	/* Make sure we have everything we export. */
+	obj_end(pass);
+    } else
+	pass_error(err);
+
+    /* A worker is done now. */
+    jobs_end(pass);
+
+    /* Wait for the writer to finish. */
+    if (pass == 2) {
+	xref_stop();
+	smap_stop();
+	writer_stop();
     }
 
+    /* Report everything we found. */
+    if (error_report() && gave_up)
+	printf("too many errors, giving up on pass %i\n", pass);
+
     return errors;
 }
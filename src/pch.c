@@ -0,0 +1,536 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Handle precompiled include files.
+ *
+ *		Large header files, with thousands of EQUs and a bunch of
+ *		macros, are read and parsed again in both passes of every
+ *		assembly that uses them. With the -H option, we take a
+ *		snapshot of the symbols and macros such a file defined at
+ *		the end of Pass 1, and store it in a cache directory. The
+ *		next time the file is included in the same way, we define
+ *		them from the snapshot, and skip the text in both passes.
+ *
+ *		Snapshots are keyed on a hash of the contents of the file,
+ *		and of everything that can change its meaning: the values
+ *		of all symbols defined so far, the current location, the
+ *		processor, radix and current global label. An outdated or
+ *		damaged snapshot is simply not used.
+ *
+ *		We only take a snapshot of files that do nothing but define
+ *		symbols and macros. Files that generate code or data, move
+ *		the location counter, change the processor or radix, use
+ *		undefined symbols, allocate zero page variables, or include
+ *		other files, are always read normally. Note that the text
+ *		of a precompiled file is not shown in the listing.
+ *
+ *		Snapshots use the layout from dbfile.c, with the "VPCH"
+ *		magic, and these sections:
+ *
+ *		  STRS	string table
+ *		  INFO	the key (two uint32_t), and the name of the
+ *			current global label (string offset + 1)
+ *		  SYMS	name, parent (string offset + 1, or 0), and
+ *			value (uint32_t), and type, kind and subkind
+ *		  MACS	name, parameters, and definition (all string
+ *			offsets) of each macro
+ *
+ * Version:	@(#)pch.c	1.0.4	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "error.h"
+#include "target.h"
+#include "dbfile.h"
+#include "pch.h"
+#include "zpage.h"
+
+
+#define PCH_VERSION	1		// version of the file format
+
+
+/* A precompiled file we used, for Pass 2. */
+typedef struct pchent {
+    int		seq;			// number of the .include directive
+    uint8_t	*buf;			// the snapshot file
+    dbsect_t	sect[4];
+    struct pchent *next;
+} pchent_t;
+
+
+static char	*pch_dir;		// the cache directory
+static pchent_t	*pch_list;		// files we used
+static int	pch_seq;		// number of .include directives seen
+
+/* The file we are taking a snapshot of. */
+static struct {
+    int		active;
+    int		idx,			// index of the file
+		flen;			// number of files
+    uint32_t	key[2];
+    uint32_t	pc,
+		osize;
+    int		errors;
+    int8_t	radix;
+    int		iflevel,
+		rptlevel;
+    int		zp;			// zero page directives seen
+    const char	*cpu;
+    char	path[1024];		// name of the snapshot file
+} pch_rec;
+
+
+/* Update a (32-bit FNV-1a) hash with some data. */
+static uint32_t
+pch_hash(uint32_t h, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    while (len-- > 0) {
+	h ^= *p++;
+	h *= 16777619;
+    }
+
+    return h;
+}
+
+
+static uint32_t
+pch_hash32(uint32_t h, uint32_t v)
+{
+    uint8_t b[4];
+
+    db_put32(b, v);
+
+    return pch_hash(h, b, 4);
+}
+
+
+static uint32_t
+pch_hashstr(uint32_t h, const char *str)
+{
+    if (str == NULL)
+	str = "";
+
+    return pch_hash(h, str, strlen(str) + 1);
+}
+
+
+/*
+ * Calculate the key for a file, using two hashes with different
+ * seeds so we get 64 bits. Returns 0 if the file can not be read.
+ */
+static int
+pch_key(const char *fn, uint32_t *key)
+{
+    uint8_t buf[4096];
+    const symbol_t *sym;
+    size_t n;
+    FILE *fp;
+    int i;
+
+    if ((fp = fopen(fn, "rb")) == NULL)
+	return 0;
+
+    key[0] = 2166136261U;
+    key[1] = 0x9e3779b9;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+	key[0] = pch_hash(key[0], buf, n);
+	key[1] = pch_hash(key[1], buf, n);
+    }
+    (void)fclose(fp);
+
+    for (i = 0; i < 2; i++) {
+	key[i] = pch_hash32(key[i], PCH_VERSION);
+	key[i] = pch_hash32(key[i], pc);
+	key[i] = pch_hash32(key[i], radix);
+	key[i] = pch_hash32(key[i], auto_local);
+	key[i] = pch_hash32(key[i], opt_C);
+	key[i] = pch_hashstr(key[i], trg_name());
+	key[i] = pch_hashstr(key[i],
+			(current_label != NULL) ? current_label->name : NULL);
+
+	/* All symbols defined so far. */
+	for (sym = sym_table(); sym != NULL; sym = sym->next) {
+		if (UNDEFINED(sym->value))
+			continue;
+
+		key[i] = pch_hashstr(key[i], sym->name);
+		key[i] = pch_hash32(key[i], sym->value.v);
+		key[i] = pch_hash32(key[i], (sym->value.t << 8) | sym->kind);
+	}
+    }
+
+    return 1;
+}
+
+
+/* Define the symbols and macros from a snapshot. */
+static void
+pch_load(pchent_t *ent, int pass)
+{
+    const char *strs = (const char *)ent->sect[0].data;
+    const char *name, *pname;
+    const uint8_t *p;
+    symbol_t *sym, *parent;
+    uint32_t i, v;
+
+    /* Symbols stay around, so we only need to define them once. */
+    p = ent->sect[2].data;
+    for (i = 0; (pass == 1) && (i < ent->sect[2].count); i++, p += 16) {
+	name = strs + db_get32(p);
+	v = db_get32(p + 8);
+
+	if (db_get32(p + 4) != 0) {
+		pname = strs + db_get32(p + 4) - 1;
+		parent = sym_lookup(pname, NULL);
+		if (parent == NULL)
+			error(ERR_UNDEF, pname);
+		sym = sym_aquire(name, &parent->locals);
+	} else
+		sym = sym_aquire(name, NULL);
+
+	if ((p[13] == KIND_LBL) &&
+	    (IS_VAR(sym) || (DEFINED(sym->value) && (sym->value.v != v))))
+		error(ERR_REDEF, name);
+
+	sym->value.v = v;
+	sym->value.t = p[12];
+	sym->kind = p[13];
+	sym->subkind = p[14];
+	sym->filenr = filenames_idx;
+	sym->linenr = line;
+	sym->stamp = ++sym_stamp;
+    }
+
+    /* Macros are reset in every pass. */
+    p = ent->sect[3].data;
+    for (i = 0; i < ent->sect[3].count; i++, p += 12)
+	macro_define(strs + db_get32(p), strs + db_get32(p + 4),
+		     strs + db_get32(p + 8));
+
+    v = db_get32(ent->sect[1].data + 8);
+    if (v != 0)
+	current_label = sym_lookup(strs + v - 1, NULL);
+}
+
+
+/* Open a snapshot file, and check if it is the one we want. */
+static pchent_t *
+pch_open(const char *fn, const uint32_t *key)
+{
+    static const char *tags[4] = { "STRS", "INFO", "SYMS", "MACS" };
+    pchent_t *ent;
+    const uint8_t *p;
+    uint32_t i, n;
+
+    ent = malloc(sizeof(pchent_t));
+    if (ent == NULL)
+	error(ERR_MEM, "snapshot");
+    memset(ent, 0x00, sizeof(pchent_t));
+    for (i = 0; i < 4; i++)
+	memcpy(ent->sect[i].tag, tags[i], 4);
+
+    ent->buf = db_read(fn, "VPCH", PCH_VERSION, ent->sect, 4);
+    if (ent->buf == NULL) {
+	free(ent);
+	return NULL;
+    }
+
+    /* Check the key and the entry sizes. */
+    p = ent->sect[1].data;
+    if ((ent->sect[1].count != 1) || (ent->sect[1].esize < 12) ||
+	(ent->sect[2].esize < 16) || (ent->sect[3].esize < 12) ||
+	(db_get32(p) != key[0]) || (db_get32(p + 4) != key[1]))
+	goto bad;
+
+    /* Make sure all strings are inside the string table. */
+    n = ent->sect[0].count;
+    if ((n == 0) || (ent->sect[0].data[n - 1] != '\0'))
+	goto bad;
+    if (db_get32(p + 8) > n)
+	goto bad;
+    for (p = ent->sect[2].data, i = 0; i < ent->sect[2].count; i++, p += 16)
+	if ((db_get32(p) >= n) || (db_get32(p + 4) > n))
+		goto bad;
+    for (p = ent->sect[3].data, i = 0; i < ent->sect[3].count; i++, p += 12)
+	if ((db_get32(p) >= n) || (db_get32(p + 4) >= n) ||
+	    (db_get32(p + 8) >= n))
+		goto bad;
+
+    return ent;
+
+bad:
+    free(ent->buf);
+    free(ent);
+
+    return NULL;
+}
+
+
+/* Enable precompiled includes, and set the cache directory. */
+int
+pch_init(const char *dir)
+{
+    pch_dir = strdup(dir);
+
+    return (pch_dir != NULL);
+}
+
+
+/*
+ * Called for every .include directive. Returns 1 if we have a
+ * snapshot for the file, and defined its contents, meaning the
+ * file itself should not be read. Both passes see the same
+ * directives in the same order, so we can simply number them
+ * to find the ones we used in Pass 1.
+ */
+int
+pch_include(const char *fn, int pass)
+{
+    pchent_t *ent;
+    uint32_t key[2];
+
+    if (pch_dir == NULL)
+	return 0;
+
+    pch_seq++;
+
+    if (pass == 2) {
+	for (ent = pch_list; ent != NULL; ent = ent->next) {
+		if (ent->seq == pch_seq) {
+			pch_load(ent, pass);
+			return 1;
+		}
+	}
+
+	return 0;
+    }
+
+    /* An include file that includes others can not be used. */
+    pch_rec.active = 0;
+
+    if (! pch_key(fn, key))
+	return 0;
+
+    sprintf(pch_rec.path, "%.990s/%08x%08x.pch", pch_dir, key[0], key[1]);
+    ent = pch_open(pch_rec.path, key);
+    if (ent != NULL) {
+	if (opt_v)
+		printf("Using precompiled '%s'\n", fn);
+
+	ent->seq = pch_seq;
+	ent->next = pch_list;
+	pch_list = ent;
+
+	pch_load(ent, pass);
+
+	return 1;
+    }
+
+    /* No (good) snapshot, so take one at the end of this file. */
+    pch_rec.active = 1;
+    pch_rec.idx = filenames_idx + 1;
+    pch_rec.flen = filenames_len + 2;
+    pch_rec.key[0] = key[0];
+    pch_rec.key[1] = key[1];
+    pch_rec.pc = pc;
+    pch_rec.osize = output_size;
+    pch_rec.errors = errors;
+    pch_rec.radix = radix;
+    pch_rec.iflevel = iflevel;
+    pch_rec.rptlevel = rptlevel;
+    pch_rec.zp = zp_count();
+    pch_rec.cpu = trg_name();
+
+    return 0;
+}
+
+
+/* Add a symbol to the snapshot, if it was defined in the file. */
+static int
+pch_sym(dbsect_t *sect, const symbol_t *sym, const symbol_t *parent)
+{
+    const char *formal, *def;
+    uint8_t *p;
+
+    if (sym->filenr != pch_rec.idx)
+	return 1;
+    if (UNDEFINED(sym->value))
+	return 0;
+
+    p = sect[2].data + (sect[2].count * 16);
+    sect[2].count++;
+    db_put32(p, db_str(&sect[0], sym->name));
+    if (parent != NULL)
+	db_put32(p + 4, db_str(&sect[0], parent->name) + 1);
+    db_put32(p + 8, sym->value.v);
+    p[12] = sym->value.t;
+    p[13] = sym->kind;
+    p[14] = sym->subkind;
+
+    if (IS_MAC(sym)) {
+	if (! macro_find(sym->name, &formal, &def))
+		return 0;
+
+	p = sect[3].data + (sect[3].count * 12);
+	sect[3].count++;
+	db_put32(p, db_str(&sect[0], sym->name));
+	db_put32(p + 4, db_str(&sect[0], formal));
+	db_put32(p + 8, db_str(&sect[0], def));
+    }
+
+    return 1;
+}
+
+
+/* Write the snapshot of the file we just finished. */
+static void
+pch_save(void)
+{
+    char temp[1024 + 8];
+    dbsect_t sect[4];
+    const symbol_t *sym, *loc;
+    uint8_t *p;
+    int nsyms = 0, ok = 1;
+
+    /* Make sure the file did nothing but define things. */
+    if ((pc != pch_rec.pc) || (output_size != pch_rec.osize) ||
+	(errors != pch_rec.errors) || (radix != pch_rec.radix) ||
+	(iflevel != pch_rec.iflevel) || (rptlevel != pch_rec.rptlevel) ||
+	(zp_count() != pch_rec.zp) ||
+	macstate || (filenames_len != pch_rec.flen) ||
+	(trg_name() != pch_rec.cpu))
+	return;
+
+    for (sym = sym_table(); sym != NULL; sym = sym->next) {
+	nsyms++;
+	for (loc = sym->locals; loc != NULL; loc = loc->next)
+		nsyms++;
+    }
+
+    memset(sect, 0x00, sizeof(sect));
+    (void)db_alloc(&sect[0], "STRS", 0, 1);
+    p = db_alloc(&sect[1], "INFO", 1, 12);
+    db_put32(p, pch_rec.key[0]);
+    db_put32(p + 4, pch_rec.key[1]);
+    (void)db_alloc(&sect[2], "SYMS", nsyms, 16);
+    (void)db_alloc(&sect[3], "MACS", nsyms, 12);
+    sect[2].count = sect[3].count = 0;
+
+    for (sym = sym_table(); ok && (sym != NULL); sym = sym->next) {
+	ok = pch_sym(sect, sym, NULL);
+	for (loc = sym->locals; ok && (loc != NULL); loc = loc->next)
+		ok = pch_sym(sect, loc, sym);
+    }
+
+    if (ok && (current_label != NULL))
+	db_put32(sect[1].data + 8, db_str(&sect[0], current_label->name) + 1);
+
+    /* Write a temporary file first, so nobody reads half of it. */
+    if (ok) {
+	sprintf(temp, "%s.tmp", pch_rec.path);
+	if (db_write(temp, "VPCH", PCH_VERSION, sect, 4)) {
+		(void)remove(pch_rec.path);
+		if (rename(temp, pch_rec.path) != 0)
+			(void)remove(temp);
+		else if (opt_v)
+			printf("Precompiled '%s'\n", filenames[pch_rec.idx]);
+	}
+    }
+
+    db_free(sect, 4);
+}
+
+
+/* Start a new pass. */
+void
+pch_start(int pass)
+{
+    pchent_t *ent;
+
+    pch_seq = 0;
+    pch_rec.active = 0;
+
+    /* Pass 1 may be run more than once, so forget what we used. */
+    while ((pass == 1) && (ent = pch_list) != NULL) {
+	pch_list = ent->next;
+	free(ent->buf);
+	free(ent);
+    }
+}
+
+
+/* Called when we leave a file, to see if we need to take a snapshot. */
+void
+pch_leave(int pass)
+{
+    if ((pass != 1) || !pch_rec.active)
+	return;
+
+    if (filenames_idx == (pch_rec.idx + 1)) {
+	pch_rec.active = 0;
+
+	pch_save();
+    }
+}
+
+
+/* Release all memory. */
+void
+pch_close(void)
+{
+    pchent_t *ent;
+
+    while ((ent = pch_list) != NULL) {
+	pch_list = ent->next;
+	free(ent->buf);
+	free(ent);
+    }
+
+    if (pch_dir != NULL)
+	free(pch_dir);
+    pch_dir = NULL;
+}
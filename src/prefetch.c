@@ -0,0 +1,476 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Read include files and binary blobs ahead of time.
+ *
+ *		On a slow (network) file system, opening and reading all
+ *		the include files of a big source one at a time, when the
+ *		parser gets to them, adds up. So, every source file we get
+ *		is scanned for .include, .blob and .binary directives with
+ *		a file name, and those files are read by a small pool of
+ *		threads, while the parser is busy with other things. Files
+ *		read that way are scanned as well, so a whole tree of them
+ *		gets read in parallel. The scan does not know about macros
+ *		or conditionals, so we may read a file that never gets used,
+ *		but that does no harm.
+ *
+ *		When the parser needs a file, it looks here first. If it
+ *		was not read yet, we do it right away (or wait for the
+ *		thread already reading it.) If it could not be read, the
+ *		caller just tries itself, and reports the error.
+ *
+ *		The threads are stopped after Pass 1, as all the includes
+ *		have been read by then, and Pass 2 may fork. We keep the
+ *		contents until the end, as the blobs get read again in
+ *		Pass 2 (and everything in another round of Pass 1.)
+ *
+ *		This needs a build with USE_THREADS, and is not used in
+ *		watch mode, which has its own cache of the files.
+ *
+ * Version:	@(#)prefetch.c	1.0.2	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef USE_THREADS
+# include <pthread.h>
+#endif
+#include "global.h"
+#include "prefetch.h"
+#include "stats.h"
+
+
+#ifdef USE_THREADS
+
+/* The threads allocate as well, so these can not be counted. */
+#ifdef USE_STATS
+# undef malloc
+# undef strdup
+#endif
+
+
+#define PF_THREADS	4		// size of the thread pool
+
+#define PF_QUEUED	0		// waiting for a thread
+#define PF_LOADING	1		// being read
+#define PF_DONE		2		// contents are ready
+#define PF_FAILED	3		// could not be read
+
+
+typedef struct pfile {
+    struct pfile *next;
+    char	*name;
+    int		kind;			// PF_TEXT or PF_BLOB
+    int		state;
+    int		used;			// the parser got it
+    char	*data;			// contents,
+    size_t	size;			//  and their size
+} pfile_t;
+
+
+static pfile_t	*pf_list,		// all files we know of
+		*pf_last,		// the last one in the list
+		*pf_queue;		// first one that may be queued
+static int	pf_on,			// we have been started
+		pf_quit,		// threads should stop
+		pf_nthreads;
+static pthread_t pf_threads[PF_THREADS];
+static pthread_mutex_t pf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pf_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pf_done = PTHREAD_COND_INITIALIZER;
+
+
+/* Add a file to the queue, unless we already have it. */
+static void
+pf_add(const char *name, int kind)
+{
+    pfile_t *pf;
+
+    pthread_mutex_lock(&pf_mutex);
+
+    if (pf_quit) {
+	pthread_mutex_unlock(&pf_mutex);
+	return;
+    }
+
+    for (pf = pf_list; pf != NULL; pf = pf->next)
+	if ((pf->kind == kind) && !strcmp(pf->name, name))
+		break;
+
+    if ((pf == NULL) && ((pf = malloc(sizeof(pfile_t))) != NULL)) {
+	memset(pf, 0x00, sizeof(pfile_t));
+	if ((pf->name = strdup(name)) == NULL) {
+		free(pf);
+		pthread_mutex_unlock(&pf_mutex);
+		return;
+	}
+	pf->kind = kind;
+	pf->state = PF_QUEUED;
+
+	if (pf_last != NULL)
+		pf_last->next = pf;
+	else
+		pf_list = pf;
+	pf_last = pf;
+	if (pf_queue == NULL)
+		pf_queue = pf;
+
+	pthread_cond_signal(&pf_work);
+    }
+
+    pthread_mutex_unlock(&pf_mutex);
+}
+
+
+/*
+ * Look for .include, .blob and .binary directives in (the cooked)
+ * text of a file. We only look at the first two words of a line,
+ * as the first one can be a label.
+ */
+static void
+pf_scan(const char *parent, const char *p, const char *end)
+{
+    char path[2 * STR_LEN], name[STR_LEN], id[16];
+    const char *pptr;
+    char *dptr;
+    size_t i, n;
+    int kind, word;
+
+    while (p < end) {
+	for (word = 0; word < 2; word++) {
+		while ((p < end) && IS_SPACE(*p))
+			p++;
+		if ((p < end) && (*p == DOT_CHAR))
+			p++;
+		for (n = 0; (p < end) && (isalnum((uint8_t)*p) || (*p == '_')); p++, n++)
+			if (n < sizeof(id) - 1)
+				id[n] = (char)toupper((uint8_t)*p);
+		if ((n == 0) || (n >= sizeof(id)))
+			break;
+		id[n] = '\0';
+		if ((p < end) && (*p == COLON_CHAR))
+			p++;
+
+		if (! strcmp(id, "INCLUDE"))
+			kind = PF_TEXT;
+		else if (!strcmp(id, "BLOB") || !strcmp(id, "BINARY"))
+			kind = PF_BLOB;
+		else
+			continue;
+
+		/* Get the name, like string_lit() does. */
+		while ((p < end) && IS_SPACE(*p))
+			p++;
+		if ((p == end) || (*p++ != '"'))
+			break;
+		for (n = 0; (p < end) && !IS_END(*p) && (*p != '"'); p++)
+			if (n < sizeof(name) - 1)
+				name[n++] = *p;
+		if ((p == end) || (*p != '"') || (n == 0))
+			break;
+		name[n] = '\0';
+
+		/* Blobs are found from here, includes next to their parent. */
+		if (kind == PF_BLOB) {
+			pf_add(name, kind);
+			break;
+		}
+
+		/* Create pathname based on parent path, as do_include() does. */
+		pptr = parent;
+		for (dptr = path, i = 0; *pptr && i < sizeof(path) - 1; dptr++, i++) {
+			*dptr = *pptr++;
+			if (*dptr == '\\')
+				*dptr = '/';
+		}
+		*dptr = '\0';
+		if ((dptr = strrchr(path, '/')) == NULL)
+			dptr = path;
+		if (dptr != path)
+			*dptr++ = '/';
+		*dptr = '\0';
+		if ((strlen(path) + n) < sizeof(path)) {
+			strcat(path, name);
+			pf_add(path, kind);
+		}
+		break;
+	}
+
+	/* On to the next line. */
+	while ((p < end) && (*p != '\n'))
+		p++;
+	p++;
+    }
+}
+
+
+/* Read a file, and for a source file, scan it. */
+static int
+pf_read(pfile_t *pf)
+{
+    char *data, *s, *d;
+    size_t size;
+    long len;
+    FILE *fp;
+
+    if ((fp = fopen(pf->name, "rb")) == NULL)
+	return 0;
+
+    if ((fseek(fp, 0, SEEK_END) != 0) || ((len = ftell(fp)) < 0) ||
+	(fseek(fp, 0, SEEK_SET) != 0) ||
+	((data = malloc((size_t)len + 1)) == NULL)) {
+	(void)fclose(fp);
+	return 0;
+    }
+    size = fread(data, 1, (size_t)len, fp);
+    (void)fclose(fp);
+    if (size != (size_t)len) {
+	free(data);
+	return 0;
+    }
+
+    /* Source text is "cooked", just like input.c does. */
+    if (pf->kind == PF_TEXT) {
+	for (s = d = data; s < (data + size); s++)
+		if (*s != '\r')
+			*d++ = *s;
+	size = (size_t)(d - data);
+    }
+    data[size] = '\0';
+
+    pf->data = data;
+    pf->size = size;
+
+    if (pf->kind == PF_TEXT)
+	pf_scan(pf->name, data, data + size);
+
+    return 1;
+}
+
+
+/* Read a file, with the lock held (but not while reading.) */
+static void
+pf_fetch(pfile_t *pf)
+{
+    int ok;
+
+    pf->state = PF_LOADING;
+    pthread_mutex_unlock(&pf_mutex);
+
+    ok = pf_read(pf);
+
+    pthread_mutex_lock(&pf_mutex);
+    pf->state = ok ? PF_DONE : PF_FAILED;
+    pthread_cond_broadcast(&pf_done);
+}
+
+
+/* One of the threads. */
+static void *
+pf_thread(void *arg)
+{
+    pfile_t *pf;
+
+    pthread_mutex_lock(&pf_mutex);
+
+    while (! pf_quit) {
+	while ((pf_queue != NULL) && (pf_queue->state != PF_QUEUED))
+		pf_queue = pf_queue->next;
+	if ((pf = pf_queue) == NULL) {
+		pthread_cond_wait(&pf_work, &pf_mutex);
+		continue;
+	}
+
+	pf_fetch(pf);
+    }
+
+    pthread_mutex_unlock(&pf_mutex);
+
+    return NULL;
+}
+
+
+/* Start the threads. */
+void
+prefetch_start(void)
+{
+    int i;
+
+    if (pf_on)
+	return;
+
+    pf_quit = 0;
+    for (i = 0; i < PF_THREADS; i++)
+	if (pthread_create(&pf_threads[i], NULL, pf_thread, NULL) != 0)
+		break;
+    pf_nthreads = i;
+    pf_on = (i > 0);
+}
+
+
+/* Scan a source file we read ourselves. */
+void
+prefetch_scan(const char *fn, const char *text, size_t size)
+{
+    if (pf_nthreads > 0)
+	pf_scan(fn, text, text + size);
+}
+
+
+/* Get the contents of a file, if we have (or can get) them. */
+const char *
+prefetch_get(const char *fn, int kind, size_t *sizep)
+{
+    pfile_t *pf;
+
+    if (! pf_on)
+	return NULL;
+
+    pthread_mutex_lock(&pf_mutex);
+
+    for (pf = pf_list; pf != NULL; pf = pf->next)
+	if ((pf->kind == kind) && !strcmp(pf->name, fn))
+		break;
+
+    if (pf != NULL) {
+	if (pf->state == PF_QUEUED) {
+		/* Nobody got to it yet, so do it ourselves. */
+		pf_fetch(pf);
+	} else {
+		if (pf->state == PF_LOADING)
+			STATS_INC(ST_PFWAIT);
+		while (pf->state == PF_LOADING)
+			pthread_cond_wait(&pf_done, &pf_mutex);
+		if ((pf->state == PF_DONE) && !pf->used)
+			STATS_INC(ST_PREFETCH);
+	}
+	pf->used = 1;
+    }
+
+    pthread_mutex_unlock(&pf_mutex);
+
+    if ((pf == NULL) || (pf->state != PF_DONE))
+	return NULL;
+
+    *sizep = pf->size;
+
+    return pf->data;
+}
+
+
+/* Stop the threads, but keep what they read. */
+void
+prefetch_stop(void)
+{
+    int i;
+
+    if (pf_nthreads == 0)
+	return;
+
+    pthread_mutex_lock(&pf_mutex);
+    pf_quit = 1;
+    pthread_cond_broadcast(&pf_work);
+    pthread_mutex_unlock(&pf_mutex);
+
+    for (i = 0; i < pf_nthreads; i++)
+	(void)pthread_join(pf_threads[i], NULL);
+    pf_nthreads = 0;
+}
+
+
+/* Stop the threads, and forget all files. */
+void
+prefetch_close(void)
+{
+    pfile_t *pf;
+
+    prefetch_stop();
+
+    while ((pf = pf_list) != NULL) {
+	pf_list = pf->next;
+	if (pf->data != NULL)
+		free(pf->data);
+	free(pf->name);
+	free(pf);
+    }
+    pf_last = pf_queue = NULL;
+    pf_on = 0;
+}
+
+
+#else	/*USE_THREADS*/
+
+
+void
+prefetch_start(void)
+{
+}
+
+
+void
+prefetch_scan(const char *fn, const char *text, size_t size)
+{
+}
+
+
+const char *
+prefetch_get(const char *fn, int kind, size_t *sizep)
+{
+    return NULL;
+}
+
+
+void
+prefetch_stop(void)
+{
+}
+
+
+void
+prefetch_close(void)
+{
+}
+
+
+#endif	/*USE_THREADS*/
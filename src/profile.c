@@ -0,0 +1,602 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Profile the assembly at the source level (-z option.)
+ *
+ *		At the start of each line, the time since the previous one
+ *		is added to that line. Lines are kept in a tree of where
+ *		they came from: the (included) files, the bodies of .repeat
+ *		blocks, and the macros at their invocation sites, so the
+ *		same line can show up in several places.
+ *
+ *		At the end, a report of the lines and the files, macros and
+ *		repeat blocks that took the most time is shown, and all of
+ *		the tree is written as "folded stacks", which is what tools
+ *		like flamegraph.pl take as input.
+ *
+ * Version:	@(#)profile.c	1.0.2	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "error.h"
+#include "stats.h"
+#include "profile.h"
+
+
+#define PROF_HASH	65536		// size of the hash tables
+#define PROF_NAMES	1024		// size of the name table
+#define PROF_CHUNK	4096		// nodes allocated at a time
+#define PROF_TOP	25		// entries shown in the report
+#define PROF_DEPTH	1024		// deepest stack we write
+
+
+/* The kinds of nodes in the tree. */
+#define PF_FILE		0		// a (top-level or included) file
+#define PF_REPEAT	1		// the body of a .repeat block
+#define PF_MACRO	2		// a macro, at an invocation site
+#define PF_LINE		3		// one source line
+
+typedef struct pnode {
+    struct pnode *parent,
+		*next;			// next in hash chain
+    const char	*name;			// file or macro name
+    const char	*src;			// what its lines belong to
+    int		kind,
+		line;
+    uint64_t	time;			// nanoseconds spent in it
+    uint32_t	lines;			// lines processed
+} pnode_t;
+
+typedef struct pchunk {
+    struct pchunk *next;
+    int		used;
+    pnode_t	nodes[PROF_CHUNK];
+} pchunk_t;
+
+/* The totals for the report. */
+typedef struct ptotal {
+    struct ptotal *next,		// next in hash chain
+		*link;			// next in list of all
+    const char	*name,
+		*file;			// file of macro invocation
+    int		kind,
+		line;
+    uint64_t	time;
+    uint32_t	lines;
+    uint32_t	stamp;			// last line added to it
+} ptotal_t;
+
+/* Names are kept only once, so we can compare pointers. */
+typedef struct pname {
+    struct pname *next;
+    char	name[1];
+} pname_t;
+
+
+int		prof_on;		// we are profiling
+
+static char	*prof_path;
+static pnode_t	**prof_hash;
+static ptotal_t	**prof_tots,
+		*prof_list;
+static int	prof_ntots;
+static pchunk_t	*prof_chunks;
+static pname_t	*prof_names[PROF_NAMES];
+static pnode_t	**prof_files;		// the files we are in
+static int	prof_depth,
+		prof_max;
+static pnode_t	*prof_ctx,		// where the current line is
+		*prof_leaf;		// the current line
+static uint64_t	prof_then;		// when it started
+
+/* What prof_ctx was made from, so we know when it changes. */
+static pnode_t	*sig_file;
+static int	sig_rpt,
+		sig_rfile,
+		sig_rline,
+		sig_mac,
+		sig_mline;
+
+
+/* Return the one copy of a name. */
+static const char *
+prof_name(const char *name)
+{
+    const unsigned char *p;
+    uint32_t h = 0;
+    pname_t *pn;
+
+    for (p = (const unsigned char *)name; *p != '\0'; p++)
+	h = (h * 31) + *p;
+    h %= PROF_NAMES;
+
+    for (pn = prof_names[h]; pn != NULL; pn = pn->next)
+	if (! strcmp(pn->name, name))
+		return pn->name;
+
+    pn = malloc(sizeof(pname_t) + strlen(name));
+    if (pn == NULL)
+	error(ERR_MEM, "profile");
+    strcpy(pn->name, name);
+    pn->next = prof_names[h];
+    prof_names[h] = pn;
+
+    return pn->name;
+}
+
+
+/* Find (or add) a node in the tree. */
+static pnode_t *
+prof_node(pnode_t *parent, int kind, const char *name, int line)
+{
+    pchunk_t *pc;
+    pnode_t *pn;
+    uint32_t h;
+
+    h = (uint32_t)(((uintptr_t)parent >> 4) ^ ((uintptr_t)name >> 4) ^
+		   ((uint32_t)line * 2654435761u) ^ kind) % PROF_HASH;
+
+    for (pn = prof_hash[h]; pn != NULL; pn = pn->next)
+	if ((pn->parent == parent) && (pn->name == name) &&
+	    (pn->line == line) && (pn->kind == kind))
+		return pn;
+
+    pc = prof_chunks;
+    if ((pc == NULL) || (pc->used == PROF_CHUNK)) {
+	pc = malloc(sizeof(pchunk_t));
+	if (pc == NULL)
+		error(ERR_MEM, "profile");
+	pc->next = prof_chunks;
+	pc->used = 0;
+	prof_chunks = pc;
+    }
+
+    pn = &pc->nodes[pc->used++];
+    memset(pn, 0x00, sizeof(pnode_t));
+    pn->parent = parent;
+    pn->kind = kind;
+    pn->name = name;
+    pn->line = line;
+    if ((kind == PF_REPEAT) && (parent != NULL))
+	pn->src = parent->src;
+    else
+	pn->src = name;
+
+    pn->next = prof_hash[h];
+    prof_hash[h] = pn;
+
+    return pn;
+}
+
+
+/* The file we are in now. */
+static pnode_t *
+prof_file(void)
+{
+    if (prof_files[prof_depth] == NULL)
+	prof_files[prof_depth] = prof_node(NULL, PF_FILE,
+					   prof_name(filenames[filenames_idx]), 0);
+
+    return prof_files[prof_depth];
+}
+
+
+int
+prof_init(const char *fn)
+{
+    prof_path = strdup(fn);
+    prof_hash = calloc(PROF_HASH, sizeof(pnode_t *));
+    prof_tots = calloc(PROF_HASH, sizeof(ptotal_t *));
+    prof_max = 16;
+    prof_files = calloc(prof_max, sizeof(pnode_t *));
+    if ((prof_path == NULL) || (prof_hash == NULL) || (prof_tots == NULL) ||
+	(prof_files == NULL))
+	return 0;
+
+    prof_on = 1;
+
+    return 1;
+}
+
+
+/* A pass starts at the top of the first file. */
+void
+prof_start(int pass)
+{
+    if (! prof_on)
+	return;
+
+    prof_depth = 0;
+    prof_files[0] = NULL;
+    prof_leaf = NULL;
+    sig_file = NULL;
+}
+
+
+/* We go into an included file, from the given line. */
+void
+prof_enter(const char *name, int line)
+{
+    pnode_t *pn;
+
+    if (! prof_on)
+	return;
+
+    prof_files = stack_grow(prof_files, &prof_max, prof_depth + 1, sizeof(pnode_t *));
+    pn = prof_file();
+    prof_files[++prof_depth] = prof_node(pn, PF_FILE, prof_name(name), line);
+}
+
+
+/* We are at the end of a file. */
+void
+prof_leave(void)
+{
+    if (! prof_on)
+	return;
+
+    if (prof_depth > 0)
+	prof_depth--;
+    else
+	prof_files[0] = NULL;		// next file on the command line
+}
+
+
+/*
+ * A new line starts, so the previous one is done. A NULL pointer
+ * means we are done with this pass.
+ */
+void
+prof_line(const char *ptr)
+{
+    const char *mname = NULL;
+    uint64_t now = stats_clock();
+    pnode_t *pn;
+    int i, mline = 0;
+
+    if (prof_leaf != NULL)
+	prof_leaf->time += now - prof_then;
+    prof_then = now;
+
+    if (ptr == NULL) {
+	prof_leaf = NULL;
+	return;
+    }
+
+    if (maclevel > 0)
+	mname = macro_current(ptr, &mline);
+
+    /* See if we are still in the same place. */
+    pn = prof_file();
+    if ((pn != sig_file) || (rptlevel != sig_rpt) ||
+	((rptlevel > 0) && ((rptstack[rptlevel - 1].file != sig_rfile) ||
+			    (rptstack[rptlevel - 1].line != sig_rline))) ||
+	(maclevel != sig_mac) || ((maclevel > 0) && (line != sig_mline))) {
+	sig_file = pn;
+	sig_rpt = rptlevel;
+	if (rptlevel > 0) {
+		sig_rfile = rptstack[rptlevel - 1].file;
+		sig_rline = rptstack[rptlevel - 1].line;
+	}
+	sig_mac = maclevel;
+	sig_mline = line;
+
+	for (i = 0; i < rptlevel; i++)
+		pn = prof_node(pn, PF_REPEAT,
+			       prof_name(filenames[rptstack[i].file]),
+			       rptstack[i].line - 1);
+	if (mname != NULL)
+		pn = prof_node(pn, PF_MACRO, prof_name(mname), line);
+
+	prof_ctx = pn;
+    }
+
+    prof_leaf = prof_node(prof_ctx, PF_LINE, prof_ctx->src,
+			  (mname != NULL) ? mline : line);
+    prof_leaf->lines++;
+}
+
+
+/* Write the name of one frame of a stack. */
+static void
+prof_frame(FILE *fp, const pnode_t *pn)
+{
+    const char *sp;
+
+    switch (pn->kind) {
+	case PF_REPEAT:
+		fprintf(fp, ".repeat ");
+		break;
+
+	case PF_MACRO:
+		fprintf(fp, "macro ");
+		break;
+    }
+
+    /* The frames are separated by semicolons. */
+    for (sp = pn->name; *sp != '\0'; sp++)
+	fputc((*sp == ';') ? ',' : *sp, fp);
+
+    if ((pn->kind == PF_REPEAT) || (pn->kind == PF_LINE))
+	fprintf(fp, ":%i", pn->line);
+}
+
+
+/* Order totals by time, the most first. */
+static int
+prof_cmp(const void *a, const void *b)
+{
+    const ptotal_t *x = *(const ptotal_t **)a;
+    const ptotal_t *y = *(const ptotal_t **)b;
+
+    if (x->time != y->time)
+	return (x->time > y->time) ? -1 : 1;
+
+    return (x->lines > y->lines) ? -1 : (x->lines < y->lines) ? 1 : 0;
+}
+
+
+/*
+ * Add the time of a line to a total. A total is for a file, a
+ * repeat block, a macro (at all or at one invocation site), or a
+ * source line, wherever it came from.
+ */
+static void
+prof_total(int kind, const char *name, const char *file, int line,
+	   const pnode_t *leaf, uint32_t stamp)
+{
+    ptotal_t *pt;
+    uint32_t h;
+
+    h = (uint32_t)(((uintptr_t)name >> 4) ^ ((uintptr_t)file >> 4) ^
+		   ((uint32_t)line * 2654435761u) ^ kind) % PROF_HASH;
+
+    for (pt = prof_tots[h]; pt != NULL; pt = pt->next)
+	if ((pt->name == name) && (pt->file == file) &&
+	    (pt->line == line) && (pt->kind == kind))
+		break;
+
+    if (pt == NULL) {
+	pt = calloc(1, sizeof(ptotal_t));
+	if (pt == NULL)
+		error(ERR_MEM, "profile");
+	pt->kind = kind;
+	pt->name = name;
+	pt->file = file;
+	pt->line = line;
+	pt->next = prof_tots[h];
+	prof_tots[h] = pt;
+	pt->link = prof_list;
+	prof_list = pt;
+	prof_ntots++;
+    }
+
+    /* Only once per line, in case of recursion. */
+    if (pt->stamp != stamp) {
+	pt->stamp = stamp;
+	pt->time += leaf->time;
+	pt->lines += leaf->lines;
+    }
+}
+
+
+/* Show the top of a list of totals. */
+static void
+prof_show(ptotal_t **list, int n, const char *head, uint64_t all)
+{
+    const ptotal_t *pt;
+    int i;
+
+    qsort(list, n, sizeof(ptotal_t *), prof_cmp);
+
+    printf("\n  %10s %6s %10s  %s\n", "Seconds", "%", "Lines", head);
+    for (i = 0; (i < n) && (i < PROF_TOP); i++) {
+	pt = list[i];
+	printf("  %10.3f %6.1f %10u  ", (double)pt->time / 1000000000.0,
+	       all ? (100.0 * pt->time) / all : 0.0, pt->lines);
+
+	switch (pt->kind) {
+		case PF_FILE:
+			printf("file %s\n", pt->name);
+			break;
+
+		case PF_REPEAT:
+			printf(".repeat at %s:%i\n", pt->name, pt->line);
+			break;
+
+		case PF_MACRO:
+			if (pt->file != NULL)
+				printf("macro %s at %s:%i\n",
+				       pt->name, pt->file, pt->line);
+			else
+				printf("macro %s\n", pt->name);
+			break;
+
+		case PF_LINE:
+			printf("%s:%i\n", pt->name, pt->line);
+			break;
+	}
+    }
+}
+
+
+/*
+ * Show the report, and write the folded stacks. Only the lines (the
+ * leaves of the tree) have any time of their own, so we go through
+ * these, and add each one to the totals of all its parents.
+ */
+int
+prof_write(void)
+{
+    const pnode_t *stack[PROF_DEPTH];
+    const pnode_t *leaf, *pn;
+    ptotal_t **lines, **blocks, *pt;
+    pchunk_t *pc;
+    uint64_t all = 0;
+    uint32_t stamp = 0;
+    int nlines, nblocks, i, k;
+    FILE *fp;
+
+    if (! prof_on)
+	return 1;
+    prof_on = 0;
+
+    fp = fopen(prof_path, "w");
+    if (fp == NULL)
+	return 0;
+
+    for (pc = prof_chunks; pc != NULL; pc = pc->next) {
+	for (i = 0; i < pc->used; i++) {
+		leaf = &pc->nodes[i];
+		if ((leaf->kind != PF_LINE) || (leaf->time == 0))
+			continue;
+		all += leaf->time;
+		stamp++;
+
+		prof_total(PF_LINE, leaf->src, NULL, leaf->line, leaf, stamp);
+		for (pn = leaf->parent; pn != NULL; pn = pn->parent) {
+			switch (pn->kind) {
+				case PF_FILE:
+					prof_total(PF_FILE, pn->name, NULL, 0,
+						   leaf, stamp);
+					break;
+
+				case PF_REPEAT:
+					prof_total(PF_REPEAT, pn->name, NULL,
+						   pn->line, leaf, stamp);
+					break;
+
+				case PF_MACRO:
+					prof_total(PF_MACRO, pn->name, NULL, 0,
+						   leaf, stamp);
+					prof_total(PF_MACRO, pn->name,
+						   pn->parent->src, pn->line,
+						   leaf, stamp);
+					break;
+			}
+		}
+
+		/* Write its stack, from the top down. */
+		if ((leaf->time / 1000) == 0)
+			continue;
+		k = 0;
+		for (pn = leaf; (pn != NULL) && (k < PROF_DEPTH); pn = pn->parent)
+			stack[k++] = pn;
+		while (k-- > 0) {
+			prof_frame(fp, stack[k]);
+			fputc((k > 0) ? ';' : ' ', fp);
+		}
+		fprintf(fp, "%llu\n", (unsigned long long)(leaf->time / 1000));
+	}
+    }
+
+    /* Split the totals into lines and blocks. */
+    lines = malloc((prof_ntots + 1) * sizeof(ptotal_t *));
+    blocks = malloc((prof_ntots + 1) * sizeof(ptotal_t *));
+    if ((lines == NULL) || (blocks == NULL)) {
+	(void)fclose(fp);
+	return 0;
+    }
+    nlines = nblocks = 0;
+    for (pt = prof_list; pt != NULL; pt = pt->link) {
+	if (pt->kind == PF_LINE)
+		lines[nlines++] = pt;
+	else
+		blocks[nblocks++] = pt;
+    }
+
+    printf("\nProfile: %.3f seconds in %i source lines\n",
+	   (double)all / 1000000000.0, nlines);
+    prof_show(blocks, nblocks, "Files, macros and repeat blocks", all);
+    prof_show(lines, nlines, "Source lines", all);
+
+    free(lines);
+    free(blocks);
+
+    return (fclose(fp) == 0);
+}
+
+
+void
+prof_close(void)
+{
+    pchunk_t *pc;
+    ptotal_t *pt;
+    pname_t *pn;
+    int i;
+
+    while ((pc = prof_chunks) != NULL) {
+	prof_chunks = pc->next;
+	free(pc);
+    }
+
+    while ((pt = prof_list) != NULL) {
+	prof_list = pt->link;
+	free(pt);
+    }
+
+    for (i = 0; i < PROF_NAMES; i++) {
+	while ((pn = prof_names[i]) != NULL) {
+		prof_names[i] = pn->next;
+		free(pn);
+	}
+    }
+
+    if (prof_hash != NULL)
+	free(prof_hash);
+    prof_hash = NULL;
+    if (prof_tots != NULL)
+	free(prof_tots);
+    prof_tots = NULL;
+    if (prof_path != NULL)
+	free(prof_path);
+    prof_path = NULL;
+    if (prof_files != NULL)
+	free(prof_files);
+    prof_files = NULL;
+    prof_max = 0;
+    prof_ntots = 0;
+    prof_on = 0;
+}
@@ -8,7 +8,7 @@
  *
  *		Handle directives and pseudo-ops.
  *
- * Version:	@(#)pseudo.c	1.0.13	2026/07/01
+ * Version:	@(#)pseudo.c	1.0.31	2026/10/18
  *
  * Authors:	Fred N. van Kempen, <waltje@varcem.com>
  *		Bernd Bckmann, <https://codeberg.org/boeckmann/asm6502>
@@ -50,6 +50,16 @@
 #include <ctype.h>
 #include "global.h"
 #include "error.h"
+#include "xref.h"
+#include "pch.h"
+#include "ckpt.h"
+#include "target.h"
+#include "zpage.h"
+#include "page.h"
+#include "stats.h"
+#include "profile.h"
+#include "object.h"
+#include "prefetch.h"
 
 
 typedef struct pseudo {
@@ -60,6 +70,19 @@ typedef struct pseudo {
     char	*(*list)(char *);
 } pseudo_t;
 
+/* An open .cycles block. */
+typedef struct cycles_info {
+    uint32_t	min,			// the budget
+		max;
+    uint32_t	start[2];		// cycles counted before it
+} cycles_t;
+
+
+static cycles_t	*cycstack;
+static int	cyc_max;
+static uint32_t	cyc_block[2];		// cycles taken by the last block
+static symbol_t	*zp_last;		// last variable from .zpvar
+
 
 static int
 string_lit(char **p, char *buf, int bufsize, int quot)
@@ -109,6 +132,7 @@ do_addr(char **p, int pass)
     /* Decrement one, but mind the mod-4096 stuff. */
     v.v = (v.v & ~0x0fff) | ((v.v & 0x0fff) - 1);
 
+    emit_reloc(v, OBJ_WORDBE, pass);
     emit_word_be(v.v & 0xffff, pass);
     pc += 2;
 
@@ -136,6 +160,9 @@ do_align(char **p, int pass)
     if ((count != 1) && (count != 2) && (count != 4) && (count != 8))
 	error(ERR_RNG, NULL);
 
+    /* An object file section must be aligned as well. */
+    obj_align(count);
+
     /* Now "fill out" the space with bytes. */
     count--;
     while ((pc & count) != 0) {
@@ -202,7 +229,8 @@ static char *
 do_blob(char **p, int pass)
 {
     char filename[STR_LEN];
-    size_t count, skip;
+    size_t count, skip, size, pos;
+    const char *data;
     value_t v;
     FILE *fp;
     int b;
@@ -235,17 +263,31 @@ do_blob(char **p, int pass)
 	}
     }
 
-    /* Make sure we can open the file.. */
-    fp = fopen(filename, "rb");
-    if (fp == NULL)
-	error(ERR_OPEN, filename);
+    /* Use the contents if we read them ahead, or open the file. */
+    fp = NULL;
+    if ((data = prefetch_get(filename, PF_BLOB, &size)) == NULL) {
+	fp = fopen(filename, "rb");
+	if (fp == NULL)
+		error(ERR_OPEN, filename);
+    }
+    if ((pass == 1) && !file_dep(filename)) {
+	if (fp != NULL)
+		(void)fclose(fp);
+	error(ERR_MEM, NULL);
+    }
+    if (pass == 1)
+	ckpt_file(filename);
 
     /*
      * Read data from file, and "insert" the bytes into
      * source as if they had been .byte statements.
      */
-    while (!feof(fp) && !ferror(fp)) {
-	b = fgetc(fp);
+    pos = 0;
+    for (;;) {
+	if (data != NULL)
+		b = (pos < size) ? (uint8_t)data[pos++] : EOF;
+	else
+		b = fgetc(fp);
 	if (b == EOF)
 		break;
 
@@ -260,7 +302,8 @@ do_blob(char **p, int pass)
 	}
     }
 
-    (void)fclose(fp);
+    if (fp != NULL)
+	(void)fclose(fp);
 
     return NULL;
 }
@@ -291,6 +334,9 @@ do_byte(char **p, int pass)
 			if ((TYPE(v) != TYPE_BYTE) && (v.v > 0xff))
 				error(ERR_ILLTYPE, NULL);
 		}
+		if ((v.r != RELOC_NONE) && !RELOC_PART(v))
+			error(ERR_RELOC, NULL);
+		emit_reloc(v, OBJ_BYTE, pass);
 		emit_byte((uint8_t)to_byte(v, 0).v, pass);
 
 		pc++;
@@ -326,6 +372,63 @@ do_cpu(char **p, int pass)
 }
 
 
+/* Format a range of cycles. */
+static char *
+cyc_print(char *str, uint32_t min, uint32_t max)
+{
+    if (min == max)
+	sprintf(str, "%u", min);
+    else
+	sprintf(str, "%u-%u", min, max);
+
+    return str;
+}
+
+
+/* The ".cycles [[<min>,]<max>]" directive. */
+static char *
+do_cycles(char **p, int pass)
+{
+    cycles_t *c;
+    value_t v;
+
+    if (! trg_cycles_ok())
+	error(ERR_NOCYC, NULL);
+    cycstack = stack_grow(cycstack, &cyc_max, cyclevel, sizeof(cycles_t));
+    c = &cycstack[cyclevel];
+    c->min = 0;
+    c->max = ~0;
+
+    skip_white_and_comment(p);
+    if (! IS_END(**p)) {
+	v = expr(p);
+	if ((pass == 2) && UNDEFINED(v))
+		error(ERR_UNDEF, NULL);
+	c->max = v.v;
+
+	skip_white(p);
+	if (**p == ',') {
+		skip_curr_and_white(p);
+		v = expr(p);
+		if ((pass == 2) && UNDEFINED(v))
+			error(ERR_UNDEF, NULL);
+		c->min = c->max;
+		c->max = v.v;
+	}
+
+	if ((pass == 2) && (c->min > c->max))
+		error(ERR_RNG, NULL);
+    }
+
+    /* Start counting from here. */
+    c->start[0] = cyc_base[0] = cyc_total[0];
+    c->start[1] = cyc_base[1] = cyc_total[1];
+    cyclevel++;
+
+    return NULL;
+}
+
+
 /* Define a symbol from the command line. */
 static char *
 do_define(char **p, int pass)
@@ -386,6 +489,7 @@ do_dword(char **p, int pass)
 	if ((pass == 2) && UNDEFINED(v))
 		error(ERR_UNDEF, NULL);
 
+	emit_reloc(v, OBJ_DWORD, pass);
 	emit_dword(v.v, pass);
 	pc += 4;
 
@@ -459,8 +563,9 @@ do_else(char **p, int pass)
     if (! IS_END(**p))
 	error(ERR_EOL, NULL);
 
+    /* In a block we skip, the other part is skipped as well. */
     if (iflevel > 0)
-	newifstate = !ifstate;
+	newifstate = ifstack[iflevel - 1] ? !ifstate : 0;
     else
 	error(ERR_ELSE, NULL);
 
@@ -514,6 +619,61 @@ do_end_list(char *str)
 }
 
 
+/* The ".endcycles" directive. */
+static char *
+do_endcycles(char **p, int pass)
+{
+    char temp[80], *s;
+    cycles_t *c;
+
+    if (cyclevel == 0)
+	error(ERR_CYCLES, NULL);
+
+    c = &cycstack[--cyclevel];
+    cyc_block[0] = cyc_total[0] - c->start[0];
+    cyc_block[1] = cyc_total[1] - c->start[1];
+
+    /* Continue counting for the outer block, if any. */
+    if (cyclevel > 0) {
+	cyc_base[0] = cycstack[cyclevel - 1].start[0];
+	cyc_base[1] = cycstack[cyclevel - 1].start[1];
+    } else {
+	cyc_base[0] = cyc_total[0];
+	cyc_base[1] = cyc_total[1];
+    }
+
+    if ((pass == 2) && ((cyc_block[0] < c->min) || (cyc_block[1] > c->max))) {
+	s = cyc_print(temp, cyc_block[0], cyc_block[1]);
+	strcat(s, ", budget ");
+	(void)cyc_print(s + strlen(s), c->min ? c->min : c->max, c->max);
+	error(ERR_BUDGET, temp);
+    }
+
+    return NULL;
+}
+
+
+/* List the results of a .endcycles directive. */
+static char *
+do_endcycles_list(char *str)
+{
+    str[0] = '~';
+    (void)cyc_print(str + 1, cyc_block[0], cyc_block[1]);
+
+    return str;
+}
+
+
+/* The ".endpagesafe" directive. */
+static char *
+do_endpagesafe(char **p, int pass)
+{
+    page_endblock(pass);
+
+    return NULL;
+}
+
+
 /* The ".endif" directive. */
 static char *
 do_endif(char **p, int pass)
@@ -536,19 +696,33 @@ do_endif(char **p, int pass)
 static char *
 do_endrep(char **p, int pass)
 {
+    /* In a block we skip, only the end of an empty one counts. */
+    if (!ifstate && ((rptlevel == 0) || (rptstack[rptlevel - 1].count > 0)))
+	return NULL;
+
     if (rptlevel == 0 || rptstack[rptlevel - 1].file != filenames_idx)
 	error(ERR_REPEAT, NULL);
 
+    /* An empty block is done, and stops skipping. */
+    if (rptstack[rptlevel - 1].count == 0) {
+	rptlevel--;
+	newifstate = ifstack[--iflevel];
+	ifstate = ifstack[iflevel];
+	rptstate = 0;
+	newrptstate = (rptlevel > 0) && (rptstack[rptlevel - 1].count > 0);
+	return NULL;
+    }
+
+    STATS_INC(ST_REPITER);
     if (rptstack[rptlevel - 1].count > 1) {
 	*p = rptstack[rptlevel - 1].pos;
-	line = rptstack[rptlevel - 1].line;
+	newline = rptstack[rptlevel - 1].line;
 	rptstack[rptlevel - 1].count--;
-	rptstack[rptlevel - 1].repeating = 1;
     } else
 	rptlevel--;
 
     rptstate = 0;
-    newrptstate = (rptstack[rptlevel - 1].count > 0);
+    newrptstate = (rptlevel > 0) && (rptstack[rptlevel - 1].count > 0);
 
     return NULL;
 }
@@ -568,6 +742,10 @@ do_error(char **p, int pass)
     do {
 	next = 0;
 
+	/* Each item adds less than STR_LEN. */
+	if ((s - buff) >= (int)(sizeof(buff) - STR_LEN))
+		error(ERR_STRLEN, NULL);
+
 	skip_white(p);
 	if (**p == '"') {
 		string_lit(p, temp, STR_LEN, 1);
@@ -630,6 +808,34 @@ do_equ_list(char *str)
 }
 
 
+/* The ".extern <name>[,<name>,...]" directive. */
+static char *
+do_extern(char **p, int pass)
+{
+    char id[ID_LEN];
+    int next;
+
+    do {
+	next = 0;
+
+	skip_white(p);
+	if (! islabel(**p))
+		error(ERR_ID, NULL);
+	ident(p, id);
+
+	obj_extern(id, pass);
+
+	skip_white(p);
+	if (**p == ',') {
+		skip_curr_and_white(p);
+		next = 1;
+	}
+    } while (next);
+
+    return NULL;
+}
+
+
 /* The ".fill <count> [,<data>]" directive. */
 static char *
 do_fill(char **p, int pass)
@@ -670,6 +876,34 @@ do_fill(char **p, int pass)
 }
 
 
+/* The ".global <name>[,<name>,...]" directive. */
+static char *
+do_global(char **p, int pass)
+{
+    char id[ID_LEN];
+    int next;
+
+    do {
+	next = 0;
+
+	skip_white(p);
+	if (! islabel(**p))
+		error(ERR_ID, NULL);
+	ident(p, id);
+
+	obj_global(id, pass);
+
+	skip_white(p);
+	if (**p == ',') {
+		skip_curr_and_white(p);
+		next = 1;
+	}
+    } while (next);
+
+    return NULL;
+}
+
+
 /* The ".if <expr>" directive. */
 static char *
 do_if(char **p, int pass)
@@ -678,6 +912,14 @@ do_if(char **p, int pass)
 
     skip_white(p);
 
+    /*
+     * Until we have its value, the block is skipped. If the
+     * expression has an error, it stays that way, and the
+     * .endif still pairs up with this.
+     */
+    if_push(ifstate);
+    newifstate = 0;
+
     /* Get the value of the expression. */
     v = expr(p);
 
@@ -693,11 +935,7 @@ do_if(char **p, int pass)
 #endif
     }
 
-    if (iflevel < MAX_IFLEVEL) {
-	ifstack[iflevel++] = ifstate;
-	newifstate = !!v.v;
-    } else
-	error(ERR_IF, NULL);
+    newifstate = !!v.v;
 
     /* If we are skipping, keep skipping! */
     if (! ifstate)
@@ -716,16 +954,17 @@ do_ifdef(char **p, int pass)
 
     skip_white(p);
 
+    /* Skip the block until we have the name (see do_if.) */
+    if_push(ifstate);
+    newifstate = 0;
+
     nident(p, id);
     sym = sym_lookup(id, NULL);
+    xref_add(sym, NULL, XREF_READ);
     if (sym != NULL && sym->kind != KIND_VAR)
 	sym = NULL;
 
-    if (iflevel < MAX_IFLEVEL) {
-	ifstack[iflevel++] = ifstate;
-	newifstate = ((sym != NULL) && DEFINED(sym->value)) ? 1 : 0;
-    } else
-	error(ERR_IF, NULL);
+    newifstate = ((sym != NULL) && DEFINED(sym->value)) ? 1 : 0;
 
     /* If we are skipping, keep skipping! */
     if (! ifstate)
@@ -743,6 +982,10 @@ do_ifn(char **p, int pass)
 
     skip_white(p);
 
+    /* Skip the block until we have its value (see do_if.) */
+    if_push(ifstate);
+    newifstate = 0;
+
     /* Get the value of the expression. */
     v = expr(p);
 
@@ -758,11 +1001,7 @@ do_ifn(char **p, int pass)
 #endif
     }
 
-    if (iflevel < MAX_IFLEVEL) {
-	ifstack[iflevel++] = ifstate;
-	newifstate = !!!v.v;
-    } else
-	error(ERR_IF, NULL);
+    newifstate = !!!v.v;
 
     /* If we are skipping, keep skipping! */
     if (! ifstate)
@@ -781,59 +1020,60 @@ do_ifndef(char **p, int pass)
 
     skip_white(p);
 
+    /* Skip the block until we have the name (see do_if.) */
+    if_push(ifstate);
+    newifstate = 0;
+
     nident(p, id);
     sym = sym_lookup(id, NULL);
+    xref_add(sym, NULL, XREF_READ);
     if (sym != NULL && sym->kind != KIND_VAR)
 	sym = NULL;
 
 //printf(">> IFNDEF(%d) pass=%d state=%d\n", iflevel, pass, ifstate);
-    if (iflevel < MAX_IFLEVEL) {
-	ifstack[iflevel++] = ifstate;
-	newifstate = ((sym != NULL) && DEFINED(sym->value)) ? 0 : 1;
+    newifstate = ((sym != NULL) && DEFINED(sym->value)) ? 0 : 1;
 
-	/*
-	 * HACK.
-	 *
-	 * We are testing for the presence of a defined variable,
-	 * which may or may not exist. If our source code first
-	 * tests for this variable, and then DOES create or delete
-	 * in, things get messed up.
-	 *
-	 * Case in point:
-	 *
-	 *  .ifndef FOOBAR
-	 *    FOOBAR = 1234
-	 *  .endif
-	 *
-	 * In pass 1, FOOBAR does not exist yet, so we will happily
-	 * set IFSTATE here, and execute the enclosed = line, which
-	 * will show up in the listing.
-	 *
-	 * In pass 2, however, this changes: the same variable now
-	 * DOES exist (as we just created it..), and so the .ifndef
-	 * fails - the = line will not be executed.
-	 *
-	 * This is wrong. Although the variable still exists (it will
-	 * be re-defined to the same value and type in pass 2, which
-	 * is OK), it shows up as "not executed"...
-	 *
-	 * So, for the sake of just this, we save the "state" as we
-	 * found it in pass 1 into the variable's definition so it
-	 * can be checked against in pass 2 ...
-	 */
+    /*
+     * HACK.
+     *
+     * We are testing for the presence of a defined variable,
+     * which may or may not exist. If our source code first
+     * tests for this variable, and then DOES create or delete
+     * in, things get messed up.
+     *
+     * Case in point:
+     *
+     *  .ifndef FOOBAR
+     *    FOOBAR = 1234
+     *  .endif
+     *
+     * In pass 1, FOOBAR does not exist yet, so we will happily
+     * set IFSTATE here, and execute the enclosed = line, which
+     * will show up in the listing.
+     *
+     * In pass 2, however, this changes: the same variable now
+     * DOES exist (as we just created it..), and so the .ifndef
+     * fails - the = line will not be executed.
+     *
+     * This is wrong. Although the variable still exists (it will
+     * be re-defined to the same value and type in pass 2, which
+     * is OK), it shows up as "not executed"...
+     *
+     * So, for the sake of just this, we save the "state" as we
+     * found it in pass 1 into the variable's definition so it
+     * can be checked against in pass 2 ...
+     */
 //printf(">>> pass=%d ifstate=%d\n", pass, newifstate);
-	if (pass == 1) {
-		/* Save state. */
-		if (sym != NULL)
-			sym->pass = newifstate;
-	} else {
-		/* Pass 2, check state from pass 1. */
-		if (sym != NULL)
-			newifstate = sym->pass;
-	}
+    if (pass == 1) {
+	/* Save state. */
+	if (sym != NULL)
+	    sym->pass = newifstate;
+    } else {
+	/* Pass 2, check state from pass 1. */
+	if (sym != NULL)
+	    newifstate = sym->pass;
+    }
 //printf("NEWstate = %d\n", newifstate);
-    } else
-	error(ERR_IF, NULL);
 
     /* If we are skipping, keep skipping! */
     if (! ifstate)
@@ -847,16 +1087,16 @@ do_ifndef(char **p, int pass)
 static char *
 do_include(char **p, int pass)
 {
-    char path[1024], *pptr, *dptr;
+    char path[2 * STR_LEN], *pptr, *dptr;
     char filename[STR_LEN];
-    char *ntext = NULL;
+    char *ntext = NULL, *eol;
     size_t last_sz, last_off;
     size_t pos, size;
     int i;
 
-    /* Do we have room for another include file? */
-    if (filenames_len + 2 > MAX_FILENAMES)
-	error(ERR_MAXINC, NULL);
+    /* Make room for two more file entries. */
+    if (! file_room(filenames_len + 1))
+	error(ERR_MEM, NULL);
 
     /* Read filename. */
     skip_white(p);
@@ -864,6 +1104,7 @@ do_include(char **p, int pass)
     skip_white_and_comment(p);
     if (! IS_END(**p))
 	error(ERR_EOL, NULL);
+    eol = *p;
     skip_eol(p);
 
     /* Create pathname based on parent path. */
@@ -879,12 +1120,25 @@ do_include(char **p, int pass)
     if (dptr != path)
 	*dptr++ = '/';
     *dptr = '\0';
+    if ((strlen(path) + strlen(filename)) >= sizeof(path))
+	error(ERR_STRLEN, NULL);
     strcat(path, filename);
 
+    /* If we have a precompiled snapshot of it, we are done. */
+    if ((maclevel == 0) && pch_include(path, pass)) {
+	if ((pass == 1) && !file_dep(path))
+		error(ERR_MEM, NULL);
+	if (pass == 1)
+		ckpt_file(path);
+
+	*p = eol;
+	return NULL;
+    }
+
     ntext = *p;
     if (pass == 1) {
 	/* Point at the first character of the line following the directive. */
-	last_off = (int)(*p - text);
+	last_off = (size_t)(*p - text);
 	last_sz = text_len - last_off;
 
 	size = file_size(path);
@@ -892,8 +1146,10 @@ do_include(char **p, int pass)
 	/* Calculate new source length and aquire memory. */
 	text_len = last_off + 1 + size + 1 + last_sz;
 	ntext = malloc(text_len + 1);	// plus NUL at end
-	if (ntext == NULL)
+	if ((ntext == NULL) || !file_buffer(ntext))
 		error(ERR_MEM, NULL);
+	STATS_INC(ST_INCLOAD);
+	STATS_ADD(ST_INCBYTES, text_len);
 
 	/* Copy pre-include block into buffer and terminate it. */
 	memcpy(ntext, text, last_off);
@@ -903,6 +1159,9 @@ do_include(char **p, int pass)
 	pos = last_off;
 	if (file_read_buf(path, ntext + last_off) == 0)
 		error(ERR_OPEN, path);
+	if (! file_dep(path))
+		error(ERR_MEM, NULL);
+	ckpt_file(path);
 	last_off += size;
 	ntext[last_off++] = EOF_CHAR;
 
@@ -912,24 +1171,39 @@ do_include(char **p, int pass)
 
 	ntext[last_off] = '\0';
 
-	/* Set source pointer to beginning of included file. */
-	*p = ntext + pos;
-    }
+	/*
+	 * Unless a macro or .repeat block still points into it, we
+	 * are done with the old text. Without this, thousands of
+	 * includes would each keep a copy of all the source text.
+	 */
+	if ((maclevel == 0) && (rptlevel == 0))
+		file_drop(text);
 
-    /* Break up current file and make spaces for two new files. */
-    for (i = (filenames_len - 1); i > (filenames_idx + 1); i--) {
-	filenames[i] = filenames[i - 2];
-	filelines[i] = filelines[i - 2];
-    }
-    filenames_len += 2;
-    filenames[filenames_idx + 2] = filenames[filenames_idx];
-    filelines[filenames_idx + 2] = line + 1;
+	/*
+	 * Set source pointer to the EOF in front of the included
+	 * file, just like it will be in Pass 2. If we point at the
+	 * file itself, its first line gets skipped as part of this
+	 * directive.
+	 */
+	*p = ntext + pos - 1;
 
-    /* Add this included file in the middle. */
-    filenames[filenames_idx + 1] = strdup(path);
-    filelines[filenames_idx + 1] = 1;
+	/* Break up current file and make spaces for two new files. */
+	for (i = (filenames_len + 1); i > (filenames_idx + 2); i--) {
+		filenames[i] = filenames[i - 2];
+		filelines[i] = filelines[i - 2];
+	}
+	filenames_len += 2;
+	filenames[filenames_idx + 2] = filenames[filenames_idx];
+	filelines[filenames_idx + 2] = line + 1;
+
+	/* Add this included file in the middle. */
+	filenames[filenames_idx + 1] = strdup(path);
+	filelines[filenames_idx + 1] = 1;
+    }
 
     /* We are now "in" the included file. */
+    prof_enter(filenames[filenames_idx + 1], line);
+    ckpt_enter((pass == 1) ? (uint32_t)(size + 2) : 0);
     filenames_idx++;
     newline = filelines[filenames_idx];
 
@@ -963,6 +1237,10 @@ do_org(char **p, int pass)
 {
     value_t v;
 
+    /* The linker decides where the sections go. */
+    if (opt_r)
+	error(ERR_NOTOBJ, NULL);
+
     skip_white(p);
 
     /* Get the new value for the origin. */
@@ -1035,6 +1313,16 @@ do_page(char **p, int pass)
 }
 
 
+/* The ".pagesafe" directive. */
+static char *
+do_pagesafe(char **p, int pass)
+{
+    page_block(pass);
+
+    return NULL;
+}
+
+
 /* The ".radix [2|8|10|16]" directive. */
 static char *
 do_radix(char **p, int pass)
@@ -1083,30 +1371,44 @@ do_radix(char **p, int pass)
 static char *
 do_repeat(char **p, int pass)
 {
+    repeat_t *r;
     value_t v;
     char *pt;
 
-    if (rptlevel == MAX_RPTLEVEL)
-	error(ERR_MAX_REP, NULL);
+    rpt_room();
+
+    /*
+     * Until we have a count, this is an empty block, which is
+     * skipped like a false .if, up to its .endrep. That is also
+     * what we get in a block we skip, or if the count has an
+     * error in it.
+     */
+    r = &rptstack[rptlevel++];
+    r->count = 0;
+    r->line = line + 1;
+    r->pos = NULL;
+    r->file = filenames_idx;
+    newrptstate = rptstate = 0;
+    if_push(ifstate);
+    newifstate = 0;
+    if (! ifstate)
+	return NULL;
 
     skip_white(p);
     v = expr(p);
     if ((pass == 2) && UNDEFINED(v))
 		error(ERR_UNDEF, NULL);
+    if (v.v == 0)
+	return NULL;
 
     /* Find next line to continue by ENDREP. */
     pt = *p;
     skip_white_and_comment(p);
 
-    rptstack[rptlevel].repeating = 0;
-    rptstack[rptlevel].count = v.v;
-    rptstack[rptlevel].line = line + 1;
-    rptstack[rptlevel].pos = *p;
-    rptstack[rptlevel].file = filenames_idx;
-
-    newrptstate = (rptstack[rptlevel].count > 0);
-    rptstate = newrptstate;
-    rptlevel++;
+    r->count = v.v;
+    r->pos = *p;
+    newrptstate = rptstate = 1;
+    newifstate = ifstack[--iflevel];
 
     *p = pt;
 
@@ -1114,6 +1416,23 @@ do_repeat(char **p, int pass)
 }
 
 
+/* The ".section <name>" directive. */
+static char *
+do_section(char **p, int pass)
+{
+    char id[ID_LEN];
+
+    skip_white(p);
+    if (! islabel(**p))
+	error(ERR_ID, NULL);
+    ident(p, id);
+
+    obj_section(id, pass);
+
+    return NULL;
+}
+
+
 /* The ".subttl <text>" directive. */
 static char *
 do_subttl(char **p, int pass)
@@ -1191,6 +1510,10 @@ do_warn(char **p, int pass)
     do {
 	next = 0;
 
+	/* Each item adds less than STR_LEN. */
+	if ((s - buff) >= (int)(sizeof(buff) - STR_LEN))
+		error(ERR_STRLEN, NULL);
+
 	skip_white(p);
 	if (**p == '"') {
 		string_lit(p, temp, STR_LEN, 1);
@@ -1261,6 +1584,7 @@ do_word(char **p, int pass)
 	v = expr(p);
 	if ((pass == 2) && UNDEFINED(v))
 		error(ERR_UNDEF, NULL);
+	emit_reloc(v, OBJ_WORD, pass);
 	emit_word(v.v & 0xffff, pass);
 	pc += 2;
 
@@ -1289,6 +1613,7 @@ do_wordbe(char **p, int pass)
 	v = expr(p);
 	if ((pass == 2) && UNDEFINED(v))
 		error(ERR_UNDEF, NULL);
+	emit_reloc(v, OBJ_WORDBE, pass);
 	emit_word_be(v.v & 0xffff, pass);
 	pc += 2;
 
@@ -1303,6 +1628,72 @@ do_wordbe(char **p, int pass)
 }
 
 
+/* The ".zpsegment <start>,<end>" directive. */
+static char *
+do_zpsegment(char **p, int pass)
+{
+    value_t v, e;
+
+    /* Variables are placed in Pass 1, so we need the values now. */
+    skip_white(p);
+    v = expr(p);
+    if (UNDEFINED(v))
+	error(ERR_UNDEF, NULL);
+
+    skip_white(p);
+    if (**p != ',')
+	error(ERR_COMMA, NULL);
+    skip_curr_and_white(p);
+    e = expr(p);
+    if (UNDEFINED(e))
+	error(ERR_UNDEF, NULL);
+
+    zp_segment(v.v, e.v, pass);
+
+    return NULL;
+}
+
+
+/* The ".zpvar <name>[,<size>]" directive. */
+static char *
+do_zpvar(char **p, int pass)
+{
+    char id[ID_LEN];
+    value_t v;
+
+    skip_white(p);
+    if (! islabel(**p))
+	error(ERR_ID, NULL);
+    ident(p, id);
+
+    v.v = 1;
+    skip_white(p);
+    if (**p == ',') {
+	skip_curr_and_white(p);
+	v = expr(p);
+	if (UNDEFINED(v))
+		error(ERR_UNDEF, NULL);
+    }
+
+    zp_last = zp_var(id, v.v, pass);
+
+    return NULL;
+}
+
+
+/* List the results of a .zpvar directive. */
+static char *
+do_zpvar_list(char *str)
+{
+    if (zp_last == NULL)
+	return NULL;
+
+    sprintf(str, "= %s", sym_print(zp_last));
+
+    return str;
+}
+
+
 static const pseudo_t pseudos[] = {
   { "ADDR",	0, 1, do_addr,		NULL		},	// SC/MP
   { "ALIGN",	0, 0, do_align,		NULL		},
@@ -1314,6 +1705,7 @@ static const pseudo_t pseudos[] = {
   { "BLOB",	0, 1, do_blob,		NULL		},
   { "BYTE",	0, 0, do_byte,		NULL		},
   { "CPU",	0, 1, do_cpu,		NULL		},
+  { "CYCLES",	0, 1, do_cycles,	NULL		},
   { "DATA",	0, 1, do_byte,		NULL		},
   { "DB",	0, 0, do_byte,		NULL		},
   { "DBYTE",	0, 0, do_wordbe,	NULL		},	// SC/MP
@@ -1325,15 +1717,19 @@ static const pseudo_t pseudos[] = {
   { "ECHO",	0, 1, do_echo,		NULL		},
   { "ELSE",	1, 0, do_else,		NULL		},
   { "END",	0, 0, do_end,		do_end_list	},
+  { "ENDCYCLES",	0, 1, do_endcycles,	do_endcycles_list },
   { "ENDIF",	1, 0, do_endif,		NULL		},
   { "ENDM",	2, 0, do_endm,		NULL		},
   { "ENDMAC",	2, 0, do_endm,		NULL		},
   { "ENDMACRO",	2, 0, do_endm,		NULL		},
-  { "ENDREP",	0, 0, do_endrep,	NULL		},
+  { "ENDPAGESAFE",	0, 1, do_endpagesafe, NULL		},
+  { "ENDREP",	1, 0, do_endrep,	NULL		},
   { "EQU",	0, 0, do_equ,		do_equ_list	},
   { "ERROR",	0, 1, do_error,		NULL		},
+  { "EXTERN",	0, 1, do_extern,	NULL		},
   { "FI",	1, 0, do_endif,		NULL		},
   { "FILL",	0, 1, do_fill,		NULL		},
+  { "GLOBAL",	0, 1, do_global,	NULL		},
   { "IF",	1, 0, do_if,		NULL		},
   { "IFDEF",	1, 0, do_ifdef,		NULL		},
   { "IFN",	1, 0, do_ifn,		NULL		},
@@ -1344,10 +1740,12 @@ static const pseudo_t pseudos[] = {
   { "NOFILL",	0, 0, do_nofill,	NULL		},
   { "ORG",	0, 0, do_org,		do_org_list	},
   { "PAGE",	0, 0, do_page,		NULL		},
+  { "PAGESAFE",	0, 1, do_pagesafe,	NULL		},
   { "RADIX",	0, 0, do_radix,		NULL		},
   { "RADX",	0, 0, do_radix,		NULL		},
-  { "REPEAT",	0, 0, do_repeat,	NULL		},
+  { "REPEAT",	1, 0, do_repeat,	NULL		},
   { "SBTTL",	0, 0, do_subttl,	NULL		},
+  { "SECTION",	0, 1, do_section,	NULL		},
   { "SET",	0, 0, do_equ,		do_equ_list	},
   { "STITLE",	0, 0, do_subttl,	NULL		},
   { "STR",	0, 1, do_byte,		NULL		},
@@ -1361,6 +1759,8 @@ static const pseudo_t pseudos[] = {
   { "WIDTH",	0, 0, do_width,		NULL		},
   { "WORD",	0, 0, do_word,		NULL		},
   { "WORDBE",	0, 0, do_wordbe,	NULL		},
+  { "ZPSEGMENT",	0, 1, do_zpsegment,	NULL		},
+  { "ZPVAR",	0, 1, do_zpvar,		do_zpvar_list	},
   { NULL				     		}
 };
 
@@ -1379,6 +1779,7 @@ is_pseudo(const char *name, int dot)
         *p++ = (char)toupper(*name++);
     *p = '\0';
 
+    STATS_INC(ST_PSLOOK);
     for (ptr = pseudos; ptr->name != NULL; ptr++) {
 	if ((i = strcmp(ptr->name, id)) == 0) {
 		if (ptr->dotted && !dot)
@@ -0,0 +1,374 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Build a table mapping addresses to source lines.
+ *
+ *		When enabled with the -g option, Pass 2 records, for every
+ *		line that generated code, its address and size, the file
+ *		and line it came from, and (for macro expansions) the name
+ *		of the macro and the line within it. This is written as a
+ *		side file, for emulators and debuggers.
+ *
+ *		The rows are delta-encoded into a small "line program",
+ *		much like the one in DWARF. The program keeps registers
+ *		for the address, file, line, macro and macro line, and
+ *		uses these opcodes:
+ *
+ *		  0	END	uleb	advance address, and end the sequence
+ *		  1	ADDR	uleb	start a sequence at this address, and
+ *				reset file, line, macro to 0, 1 and none
+ *		  2	FILE	uleb	set the file
+ *		  3	LINE	sleb	advance the line
+ *		  4	MACRO	uleb,	set the macro (string offset + 1, or
+ *				uleb	0 for none) and the line within it
+ *		  5	PC	uleb	advance the address
+ *		  8..	(special) advance the address by (op - 8) / 12,
+ *				and the line by ((op - 8) % 12) - 3, and
+ *				then add a row
+ *
+ *		Every row covers the addresses up to the next row, or the
+ *		end of its sequence. Sequences are independent, and they
+ *		are listed in an index sorted by address, so a reader can
+ *		find the one for an address with a binary search, or just
+ *		run the whole program once and fill a table with an entry
+ *		per address, for constant-time lookups.
+ *
+ *		The file uses the layout from dbfile.c, with the "VMAP"
+ *		magic, and these sections:
+ *
+ *		  STRS	string table
+ *		  FILE	uint32_t name offset, per source file
+ *		  SEQS	start and end address, and the offset of its
+ *			program (uint32_t), sorted by start address
+ *		  PROG	the line program
+ *
+ * Version:	@(#)srcmap.c	1.0.1	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "error.h"
+#include "dbfile.h"
+#include "srcmap.h"
+
+
+#define SMAP_VERSION	1		// version of the file format
+
+#define SM_END		0
+#define SM_ADDR		1
+#define SM_FILE		2
+#define SM_LINE		3
+#define SM_MACRO	4
+#define SM_PC		5
+#define SM_BASE		8		// first special opcode
+#define SM_LBASE	-3		// smallest line advance
+#define SM_LRANGE	12		// number of line advances
+#define SM_AMAX		((255 - SM_BASE) / SM_LRANGE)
+
+
+typedef struct {
+    uint32_t	start,
+		end,
+		offset;
+} smseq_t;
+
+
+static char	*smap_path;		// name of the map file
+static int	smap_active;		// currently recording
+static dbsect_t	smap_sect[4];		// STRS, FILE, SEQS, PROG
+static smseq_t	*smap_seqs;		// list of sequences
+static int	smap_nseqs,
+		smap_maxseqs;
+
+/* The registers of the line program. */
+static int	smap_inseq;		// in a sequence
+static uint32_t	smap_addr,		// address of the last row
+		smap_next;		// end of the last row
+static int	smap_file,
+		smap_line,
+		smap_mline;
+static uint32_t	smap_macro;
+
+
+/* Add an unsigned LEB128 number to the program. */
+static void
+smap_uleb(uint32_t v)
+{
+    uint8_t b;
+
+    do {
+	b = v & 0x7f;
+	v >>= 7;
+	if (v != 0)
+		b |= 0x80;
+	db_append(&smap_sect[3], &b, 1);
+    } while (v != 0);
+}
+
+
+/* Add a signed LEB128 number to the program. */
+static void
+smap_sleb(int32_t v)
+{
+    uint8_t b;
+    int more;
+
+    do {
+	b = v & 0x7f;
+	v >>= 7;		// assumes arithmetic shift
+	more = !(((v == 0) && !(b & 0x40)) || ((v == -1) && (b & 0x40)));
+	if (more)
+		b |= 0x80;
+	db_append(&smap_sect[3], &b, 1);
+    } while (more);
+}
+
+
+/* Add an opcode to the program. */
+static void
+smap_op(uint8_t op)
+{
+    db_append(&smap_sect[3], &op, 1);
+}
+
+
+/* Find (or add) a macro name in the string table. */
+static uint32_t
+smap_name(const char *name)
+{
+    const char *p = (const char *)smap_sect[0].data;
+    uint32_t off = 0;
+
+    /* Only macro names live here during Pass 2, so this is short. */
+    while (off < smap_sect[0].count) {
+	if (! strcmp(p + off, name))
+		return off;
+	off += (uint32_t)strlen(p + off) + 1;
+    }
+
+    return db_str(&smap_sect[0], name);
+}
+
+
+/* End the current sequence. */
+static void
+smap_endseq(void)
+{
+    if (! smap_inseq)
+	return;
+
+    smap_op(SM_END);
+    smap_uleb(smap_next - smap_addr);
+
+    smap_seqs[smap_nseqs - 1].end = smap_next;
+    smap_inseq = 0;
+}
+
+
+/* Enable the source map, and set the name of its file. */
+int
+smap_init(const char *fn)
+{
+    smap_path = strdup(fn);
+
+    return (smap_path != NULL);
+}
+
+
+/* Start recording (Pass 2 only.) */
+void
+smap_start(void)
+{
+    if (smap_path == NULL)
+	return;
+
+    memset(smap_sect, 0x00, sizeof(smap_sect));
+    (void)db_alloc(&smap_sect[0], "STRS", 0, 1);
+    (void)db_alloc(&smap_sect[3], "PROG", 0, 1);
+    smap_nseqs = 0;
+    smap_inseq = 0;
+
+    smap_active = 1;
+}
+
+
+void
+smap_stop(void)
+{
+    smap_endseq();
+
+    smap_active = 0;
+}
+
+
+/* Add a row for a line that generated size bytes at address addr. */
+void
+smap_add(uint32_t addr, uint32_t size, const char *macro, int mline)
+{
+    uint32_t adv, mac;
+    int ladv;
+
+    if (! smap_active || size == 0)
+	return;
+
+    /* Do we need a new sequence? */
+    if (smap_inseq && (addr != smap_next || addr < smap_addr))
+	smap_endseq();
+
+    if (! smap_inseq) {
+	if (smap_nseqs == smap_maxseqs) {
+		smap_maxseqs = smap_maxseqs ? (smap_maxseqs * 2) : 64;
+		smap_seqs = realloc(smap_seqs, smap_maxseqs * sizeof(smseq_t));
+		if (smap_seqs == NULL)
+			error(ERR_MEM, "source map");
+	}
+	smap_seqs[smap_nseqs].start = addr;
+	smap_seqs[smap_nseqs].offset = smap_sect[3].count;
+	smap_nseqs++;
+
+	smap_op(SM_ADDR);
+	smap_uleb(addr);
+	smap_addr = addr;
+	smap_file = 0;
+	smap_line = 1;
+	smap_macro = 0;
+	smap_mline = 0;
+	smap_inseq = 1;
+    }
+
+    if (filenames_idx != smap_file) {
+	smap_op(SM_FILE);
+	smap_uleb(filenames_idx);
+	smap_file = filenames_idx;
+    }
+
+    mac = (macro != NULL) ? (smap_name(macro) + 1) : 0;
+    if (mac != smap_macro || mline != smap_mline) {
+	smap_op(SM_MACRO);
+	smap_uleb(mac);
+	smap_uleb(mline);
+	smap_macro = mac;
+	smap_mline = mline;
+    }
+
+    /* Encode the address and line advances. */
+    adv = addr - smap_addr;
+    if (adv > SM_AMAX) {
+	smap_op(SM_PC);
+	smap_uleb(adv);
+	adv = 0;
+    }
+    ladv = line - smap_line;
+    if (ladv < SM_LBASE || ladv >= (SM_LBASE + SM_LRANGE)) {
+	smap_op(SM_LINE);
+	smap_sleb(ladv);
+	ladv = 0;
+    }
+    smap_op(SM_BASE + (ladv - SM_LBASE) + (SM_LRANGE * adv));
+
+    smap_addr = addr;
+    smap_line = line;
+    smap_next = addr + size;
+}
+
+
+/* Compare two sequences by start address. */
+static int
+smap_cmp(const void *a, const void *b)
+{
+    const smseq_t *x = (const smseq_t *)a;
+    const smseq_t *y = (const smseq_t *)b;
+
+    if (x->start != y->start)
+	return (x->start < y->start) ? -1 : 1;
+
+    return (x->offset < y->offset) ? -1 : 1;
+}
+
+
+/* Write the source map file. */
+int
+smap_write(void)
+{
+    uint8_t *p;
+    int i, ret;
+
+    if (smap_path == NULL)
+	return 1;
+
+    /* The names of all source files. */
+    p = db_alloc(&smap_sect[1], "FILE", filenames_len, 4);
+    for (i = 0; i < filenames_len; i++)
+	db_put32(p + (i * 4), db_str(&smap_sect[0], filenames[i]));
+
+    /* The sequence index. */
+    qsort(smap_seqs, smap_nseqs, sizeof(smseq_t), smap_cmp);
+    p = db_alloc(&smap_sect[2], "SEQS", smap_nseqs, 12);
+    for (i = 0; i < smap_nseqs; i++, p += 12) {
+	db_put32(p, smap_seqs[i].start);
+	db_put32(p + 4, smap_seqs[i].end);
+	db_put32(p + 8, smap_seqs[i].offset);
+    }
+
+    ret = db_write(smap_path, "VMAP", SMAP_VERSION, smap_sect, 4);
+
+    return ret;
+}
+
+
+/* Release all memory. */
+void
+smap_close(void)
+{
+    db_free(smap_sect, 4);
+
+    if (smap_seqs != NULL)
+	free(smap_seqs);
+    smap_seqs = NULL;
+    smap_nseqs = smap_maxseqs = 0;
+
+    if (smap_path != NULL)
+	free(smap_path);
+    smap_path = NULL;
+}
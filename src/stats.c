@@ -0,0 +1,280 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Keep statistics about the assembly (-S option.)
+ *
+ *		The time spent in each phase is always measured, as this
+ *		is only done a few times per run. The counters for the
+ *		lookups, expansions, allocations and so on are in places
+ *		that run for every line (or symbol), so these are only
+ *		compiled in when built with USE_STATS.
+ *
+ *		Note that with USE_THREADS, the output encoding and the
+ *		listing are done by the writer thread, at the same time
+ *		as Pass 2, so their times overlap with it.
+ *
+ * Version:	@(#)stats.c	1.0.2	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifdef _WIN32
+# define PSAPI_VERSION 2
+# include <windows.h>
+# include <psapi.h>
+#else
+# include <sys/time.h>
+# include <sys/resource.h>
+# include <time.h>
+#endif
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "stats.h"
+
+#ifdef USE_STATS
+# undef malloc
+# undef realloc
+# undef strdup
+#endif
+
+
+#ifdef USE_STATS
+uint64_t	stats[ST_MAX];
+#endif
+
+static uint64_t	ph_time[PH_MAX],	// time spent, in nanoseconds
+		ph_begin[PH_MAX];	// when it was started
+static int	ph_count[PH_MAX];	// how often it was started
+
+
+/* Return a (monotonic) clock, in nanoseconds. */
+uint64_t
+stats_clock(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+
+    if (freq.QuadPart == 0)
+	QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+
+    return (uint64_t)((now.QuadPart / freq.QuadPart) * 1000000000 +
+		      ((now.QuadPart % freq.QuadPart) * 1000000000) / freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+#endif
+}
+
+
+/* Return the peak memory used, in KB. */
+static uint32_t
+stats_peak(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+
+    if (! GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+	return 0;
+
+    return (uint32_t)(pmc.PeakWorkingSetSize / 1024);
+#else
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+	return 0;
+
+# ifdef __APPLE__
+    return (uint32_t)(ru.ru_maxrss / 1024);	// macOS has it in bytes
+# else
+    return (uint32_t)ru.ru_maxrss;
+# endif
+#endif
+}
+
+
+/* Clear everything, for a new run. */
+void
+stats_reset(void)
+{
+    memset(ph_time, 0x00, sizeof(ph_time));
+    memset(ph_count, 0x00, sizeof(ph_count));
+#ifdef USE_STATS
+    memset(stats, 0x00, sizeof(stats));
+#endif
+}
+
+
+/* A phase starts. */
+void
+stats_start(int ph)
+{
+    ph_begin[ph] = stats_clock();
+    ph_count[ph]++;
+}
+
+
+/* A phase ends. */
+void
+stats_stop(int ph)
+{
+    ph_time[ph] += stats_clock() - ph_begin[ph];
+}
+
+
+/*
+ * Add the time since 'then' to a phase, and return the current
+ * time. This is used for work done in small pieces, like that
+ * of the writer.
+ */
+uint64_t
+stats_lap(int ph, uint64_t then)
+{
+    uint64_t now = stats_clock();
+
+    ph_time[ph] += now - then;
+
+    return now;
+}
+
+
+static void
+st_phase(const char *name, int ph)
+{
+    printf("  %-24s %10.3f\n", name, (double)ph_time[ph] / 1000000000.0);
+}
+
+
+#ifdef USE_STATS
+static void
+st_count(const char *name, int st, const char *what, int st2)
+{
+    printf("  %-24s %10llu", name, (unsigned long long)stats[st]);
+    if (what != NULL)
+	printf("  (%llu %s)", (unsigned long long)stats[st2], what);
+    printf("\n");
+}
+#endif
+
+
+/* Show the statistics of this run. */
+void
+stats_report(void)
+{
+    char temp[32];
+    uint64_t total = 0;
+    int i;
+
+    for (i = 0; i < PH_MAX; i++)
+	if ((i != PH_OUTPUT) && (i != PH_LIST))
+		total += ph_time[i];
+
+    printf("\nStatistics:\n");
+    printf("  %-24s %10s\n", "Phase", "Seconds");
+    st_phase("loading", PH_LOAD);
+    sprintf(temp, "pass 1 (%i round%s)",
+	    ph_count[PH_PASS1], (ph_count[PH_PASS1] == 1) ? "" : "s");
+    st_phase(temp, PH_PASS1);
+    st_phase("pass 2", PH_PASS2);
+#ifdef USE_STATS
+    st_phase("  output encoding", PH_OUTPUT);
+    st_phase("  listing", PH_LIST);
+#endif
+    st_phase("reports", PH_REPORT);
+    st_phase("writing files", PH_CLOSE);
+    printf("  %-24s %10.3f\n\n", "total", (double)total / 1000000000.0);
+
+#ifdef USE_STATS
+    st_count("Symbol lookups", ST_SYMLOOK, "symbols compared", ST_SYMPROBE);
+    if (stats[ST_SYMLOOK] > 0)
+	printf("  %-24s %10.1f  (longest %llu)\n", "  average compared",
+	       (double)stats[ST_SYMPROBE] / stats[ST_SYMLOOK],
+	       (unsigned long long)stats[ST_SYMMAX]);
+    st_count("Mnemonic lookups", ST_MNLOOK, NULL, 0);
+    st_count("Directive lookups", ST_PSLOOK, NULL, 0);
+    st_count("Macro expansions", ST_MACEXP, "bytes expanded", ST_MACBYTES);
+    st_count("Repeat iterations", ST_REPITER, NULL, 0);
+    st_count("Include files loaded", ST_INCLOAD, "bytes copied", ST_INCBYTES);
+    st_count("Files prefetched", ST_PREFETCH, "waited for", ST_PFWAIT);
+    st_count("Allocations", ST_ALLOC, "bytes", ST_ALLOCBYTES);
+#else
+    printf("  (no counters, these need a build with STATS=y)\n");
+#endif
+    printf("  %-24s %10u KB\n", "Peak memory", stats_peak());
+}
+
+
+#ifdef USE_STATS
+/* Count an allocation. */
+void *
+stats_malloc(size_t size)
+{
+    stats[ST_ALLOC]++;
+    stats[ST_ALLOCBYTES] += size;
+
+    return malloc(size);
+}
+
+
+void *
+stats_realloc(void *ptr, size_t size)
+{
+    stats[ST_ALLOC]++;
+    stats[ST_ALLOCBYTES] += size;
+
+    return realloc(ptr, size);
+}
+
+
+char *
+stats_strdup(const char *str)
+{
+    stats[ST_ALLOC]++;
+    stats[ST_ALLOCBYTES] += strlen(str) + 1;
+
+    return strdup(str);
+}
+#endif
@@ -0,0 +1,107 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for the statistics (-S option.)
+ *
+ * Version:	@(#)stats.h	1.0.3	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef STATS_H
+# define STATS_H
+
+
+/* The phases we time. */
+typedef enum {
+    PH_LOAD = 0,			// reading the source files
+    PH_PASS1,				// all rounds of Pass 1
+    PH_PASS2,
+    PH_OUTPUT,				// encoding the output (writer)
+    PH_LIST,				// formatting the listing (writer)
+    PH_REPORT,				// symbol table, reports etc
+    PH_CLOSE,				// writing the output file
+    PH_MAX
+} phase_t;
+
+/* The counters, only kept when built with USE_STATS. */
+typedef enum {
+    ST_SYMLOOK = 0,			// symbol lookups
+    ST_SYMPROBE,			// symbols compared for them
+    ST_SYMMAX,				// longest lookup
+    ST_MNLOOK,				// mnemonic lookups
+    ST_PSLOOK,				// directive lookups
+    ST_MACEXP,				// macro expansions
+    ST_MACBYTES,			// bytes expanded
+    ST_REPITER,				// repeat iterations
+    ST_INCLOAD,				// include files loaded
+    ST_INCBYTES,			// bytes copied for them
+    ST_PREFETCH,			// files found prefetched
+    ST_PFWAIT,				// and still being read
+    ST_ALLOC,				// allocations
+    ST_ALLOCBYTES,			// bytes allocated
+    ST_MAX
+} stat_t;
+
+
+#ifdef USE_STATS
+extern uint64_t	stats[ST_MAX];
+
+# define STATS_INC(x)		stats[x]++
+# define STATS_ADD(x, n)	stats[x] += (n)
+# define STATS_MAX(x, n)	do { if ((uint64_t)(n) > stats[x]) \
+				stats[x] = (n); } while (0)
+# define STATS_LAP(ph, t)	t = stats_lap(ph, t)
+#else
+# define STATS_INC(x)
+# define STATS_ADD(x, n)
+# define STATS_MAX(x, n)
+# define STATS_LAP(ph, t)
+#endif
+
+
+extern uint64_t	stats_clock(void);
+extern void	stats_reset(void);
+extern void	stats_start(int);
+extern void	stats_stop(int);
+extern uint64_t	stats_lap(int, uint64_t);
+extern void	stats_report(void);
+
+
+#endif	/*STATS_H*/
@@ -8,7 +8,7 @@
  *
  *		Handle symbols.
  *
- * Version:	@(#)symbol.c	1.0.8	2023/09/26
+ * Version:	@(#)symbol.c	1.0.16	2026/10/18
  *
  * Authors:	Fred N. van Kempen, <waltje@varcem.com>
  *		Bernd Bckmann, <https://codeberg.org/boeckmann/asm6502>
@@ -49,8 +49,15 @@
 #include <string.h>
 #include "global.h"
 #include "error.h"
+#include "xref.h"
+#include "ckpt.h"
+#include "jobs.h"
+#include "stats.h"
 
 
+uint32_t	sym_stamp;		// changes made to the table
+int		sym_track;		// record uses of symbols here
+
 static symbol_t	*symbols = NULL;	// global symbol table
 
 
@@ -59,13 +66,17 @@ static symbol_t *
 sym_new(const char *name)
 {
     symbol_t *sym;
+    size_t len = strlen(name) + 1;
 
-    sym = malloc(sizeof(symbol_t));
+    /* The name goes right after it, so they can be freed together. */
+    sym = malloc(sizeof(symbol_t) + len);
     if (sym == NULL)
 	error(ERR_MEM, name);
     memset(sym, 0x00, sizeof(symbol_t));
 
-    strcpy(sym->name, name);
+    sym->name = (char *)(sym + 1);
+    memcpy(sym->name, name, len);
+    sym->stamp = ++sym_stamp;
 
     return sym;   
 }
@@ -108,19 +119,34 @@ sym_lookup(const char *name, symbol_t **table)
 {
     symbol_t *ptr;
     int i;
+#ifdef USE_STATS
+    uint64_t probes = stats[ST_SYMPROBE];
+#endif
 
     if (table == NULL)
 	table = &symbols;
 
+    STATS_INC(ST_SYMLOOK);
     for (ptr = *table; ptr != NULL; ptr = ptr->next) {
+	STATS_INC(ST_SYMPROBE);
 	if (opt_C)
 		i = strcasecmp(name, ptr->name);
 	else
 		i = strcmp(name, ptr->name);
 
-	if (! i)
+	if (! i) {
+		STATS_MAX(ST_SYMMAX, stats[ST_SYMPROBE] - probes);
+		if (sym_track && !ptr->used) {
+			ptr->used = 1;
+			ckpt_used(ptr, (table == &symbols) ? NULL : table);
+		}
 		return ptr;
+	}
     }
+    STATS_MAX(ST_SYMMAX, stats[ST_SYMPROBE] - probes);
+
+    if (sym_track)
+	ckpt_miss(name, (table == &symbols) ? NULL : table);
 
     return NULL;
 }
@@ -144,43 +170,57 @@ sym_type(const symbol_t *sym)
 }
 
 
+/* Add a new symbol to a table, the caller knows it is not there yet. */
 symbol_t *
-sym_aquire(const char *name, symbol_t **table)
+sym_add(const char *name, symbol_t **table)
 {
     symbol_t *ptr, *sym;
 
     if (table == NULL)
 	table = &symbols;
 
-    sym = sym_lookup(name, table);
-
-    if (sym == NULL) {
-	sym = sym_new(name);
-
-	/* Insert symbol in alphabetical order. */
-	if ((*table == NULL) || (strcasecmp((*table)->name, name) > 0)) {
-		sym->next = *table;
-		*table = sym;
-	} else {
-		for (ptr = *table; ptr->next != NULL; ptr = ptr->next) {
-			if (strcasecmp(ptr->next->name, name) > 0)
-				break;
-		}
+    sym = sym_new(name);
 
-		sym->next = ptr->next;
-		ptr->next = sym;
+    /* Insert symbol in alphabetical order. */
+    if ((*table == NULL) || (strcasecmp((*table)->name, name) > 0)) {
+	sym->next = *table;
+	*table = sym;
+    } else {
+	for (ptr = *table; ptr->next != NULL; ptr = ptr->next) {
+		if (strcasecmp(ptr->next->name, name) > 0)
+			break;
 	}
+
+	sym->next = ptr->next;
+	ptr->next = sym;
     }
 
     return sym;
 }
 
 
+symbol_t *
+sym_aquire(const char *name, symbol_t **table)
+{
+    symbol_t *sym;
+
+    if (table == NULL)
+	table = &symbols;
+
+    sym = sym_lookup(name, table);
+
+    if (sym == NULL)
+	sym = sym_add(name, table);
+
+    return sym;
+}
+
+
 symbol_t *
 define_label(const char *id, uint32_t val, symbol_t *parent, int pass, int t)
 {
     char nid[ID_LEN];
-    symbol_t *sym;
+    symbol_t *sym, *xp = parent;
 
     if (parent != NULL) {
 	if (*id == DOT_CHAR) {
@@ -194,15 +234,28 @@ define_label(const char *id, uint32_t val, symbol_t *parent, int pass, int t)
 		strcpy(nid, parent->name);
 		strcat(nid, id);
 		id = nid;
+		xp = NULL;
 	}
 	sym = sym_aquire(id, &parent->locals);
     } else
 	sym = sym_aquire(id, NULL);
 
+    /* An extern symbol is defined in another module. */
+    if (sym->value.r & RELOC_EXT)
+	error(ERR_REDEF, id);
+
     if (pass == 1) {
-	/* In pass 1, re-definitions are not allowed. */
-	if (IS_VAR(sym) || (DEFINED(sym->value) && (sym->value.v != val)))
-		error(parent ? ERR_LOCAL_REDEF : ERR_REDEF, id);
+	/*
+	 * In pass 1, re-definitions are not allowed. When we are
+	 * relaxing branches, symbols keep their value from the last
+	 * round, and labels may move when the code before them grows.
+	 */
+	if (IS_VAR(sym) || (DEFINED(sym->value) && (sym->value.v != val))) {
+		if (relax_iter < 2)
+			error(parent ? ERR_LOCAL_REDEF : ERR_REDEF, id);
+		if (! IS_VAR(sym))
+			relax_moved++;
+	}
     } else {
 	/*
 	 * In pass 2, we ARE allowed to change a variable back to a label
@@ -218,10 +271,14 @@ define_label(const char *id, uint32_t val, symbol_t *parent, int pass, int t)
     sym->subkind = t;
     sym->filenr = filenames_idx;
     sym->linenr = line;
+    sym->stamp = ++sym_stamp;
     sym->value.v = val;
-    sym->value.t = ((TYPE(sym->value) == TYPE_WORD)
+    sym->value.r = sect;
+    sym->value.t = ((TYPE(sym->value) == TYPE_WORD) || (sect != RELOC_NONE)
 			? TYPE_WORD : NUM_TYPE(val)) | VALUE_DEFINED;
 
+    xref_add(sym, xp, XREF_WRITE);
+
     return sym;
 }
 
@@ -235,12 +292,18 @@ define_variable(const char *id, value_t v, int force)
     if (!force && DEFINED(sym->value) && (sym->value.v != v.v))
 	error(ERR_REDEF, id);
 
+    jobs_var(sym);
+
     sym->kind = KIND_VAR;
     sym->filenr = filenames_idx;
     sym->linenr = line;
+    sym->stamp = ++sym_stamp;
+    xref_add(sym, NULL, XREF_WRITE);
 
     /* if the type is already set do not change it */
     sym->value.v = v.v;
+    sym->value.r = v.r;
+    sym->value.rl = v.rl;
     if (!force && TYPE(sym->value)) {
 #if 0
 	if (NUM_TYPE(v.v) > TYPE(sym->value)) error(ERR_REDEF, id);
@@ -0,0 +1,218 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Export the symbol table as a binary database.
+ *
+ *		The -y option writes all defined symbols to a file using
+ *		the layout from dbfile.c, with the "VSYM" magic, so that
+ *		debuggers and other tools can mmap it, and find symbols
+ *		by name or by address with a binary search:
+ *
+ *		  STRS	string table
+ *		  FILE	uint32_t name offset, per source file
+ *		  SYMS	name offset, value, line, parent, file (uint32_t,
+ *			0xffffffff for the command line), kind and type
+ *			(uint8_t), 2 bytes padding. Locals have their full
+ *			name (like global@local), and the index of their global label
+ *			as parent, which is 0xffffffff for all others
+ *		  NAME	uint32_t index into SYMS, sorted by name
+ *		  ADDR	uint32_t index into SYMS, sorted by value
+ *
+ * Version:	@(#)symfile.c	1.0.2	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "error.h"
+#include "dbfile.h"
+
+
+#define SYMF_VERSION	2		// version of the file format
+#define SYMF_NONE	0xffffffff	// no parent
+
+
+typedef struct {
+    const symbol_t *sym;
+    uint32_t	name,			// offset in string table
+		parent;			// index of parent symbol
+} symf_t;
+
+
+static symf_t	*symf_list;
+static const char *symf_strs;		// string table, for sorting
+
+
+/* Compare two symbols by name. */
+static int
+symf_namecmp(const void *a, const void *b)
+{
+    const symf_t *x = &symf_list[*(const uint32_t *)a];
+    const symf_t *y = &symf_list[*(const uint32_t *)b];
+
+    return strcmp(symf_strs + x->name, symf_strs + y->name);
+}
+
+
+/* Compare two symbols by value, and then by name. */
+static int
+symf_addrcmp(const void *a, const void *b)
+{
+    const symf_t *x = &symf_list[*(const uint32_t *)a];
+    const symf_t *y = &symf_list[*(const uint32_t *)b];
+
+    if (x->sym->value.v != y->sym->value.v)
+	return (x->sym->value.v < y->sym->value.v) ? -1 : 1;
+
+    return strcmp(symf_strs + x->name, symf_strs + y->name);
+}
+
+
+/* Add one symbol to the list. */
+static int
+symf_add(dbsect_t *strs, int n, const symbol_t *sym, const symbol_t *parent, uint32_t pidx)
+{
+    char temp[ID_LEN * 2];
+
+    if (! DEFINED(sym->value))
+	return n;
+
+    if (symf_list != NULL) {
+	symf_list[n].sym = sym;
+	symf_list[n].parent = pidx;
+	if (parent != NULL) {
+		sprintf(temp, "%s%c%s", parent->name, ALPHA_CHAR, sym->name);
+		symf_list[n].name = db_str(strs, temp);
+	} else
+		symf_list[n].name = db_str(strs, sym->name);
+    }
+
+    return n + 1;
+}
+
+
+/* Walk the symbol table, and count or collect all symbols. */
+static int
+symf_walk(dbsect_t *strs)
+{
+    const symbol_t *sym, *loc;
+    uint32_t pidx;
+    int n = 0;
+
+    for (sym = sym_table(); sym != NULL; sym = sym->next) {
+	pidx = n;
+	n = symf_add(strs, n, sym, NULL, SYMF_NONE);
+	if (pidx == n)
+		pidx = SYMF_NONE;	// parent was not added
+
+	for (loc = sym->locals; loc != NULL; loc = loc->next)
+		n = symf_add(strs, n, loc, sym, pidx);
+    }
+
+    return n;
+}
+
+
+/* Write the symbol table to a binary file. */
+int
+sym_export(const char *fn)
+{
+    dbsect_t sect[5];
+    const symbol_t *sym;
+    uint32_t *index;
+    uint8_t *p;
+    int i, n;
+
+    memset(sect, 0x00, sizeof(sect));
+    (void)db_alloc(&sect[0], "STRS", 0, 1);
+
+    /* The names of all source files. */
+    p = db_alloc(&sect[1], "FILE", filenames_len, 4);
+    for (i = 0; i < filenames_len; i++)
+	db_put32(p + (i * 4), db_str(&sect[0], filenames[i]));
+
+    /* Collect all defined symbols. */
+    symf_list = NULL;
+    n = symf_walk(&sect[0]);
+    symf_list = malloc((n + 1) * sizeof(symf_t));
+    index = malloc((n + 1) * sizeof(uint32_t));
+    if (symf_list == NULL || index == NULL)
+	error(ERR_MEM, "symbol file");
+    (void)symf_walk(&sect[0]);
+    symf_strs = (const char *)sect[0].data;
+
+    /* The symbol records. */
+    p = db_alloc(&sect[2], "SYMS", n, 24);
+    for (i = 0; i < n; i++, p += 24) {
+	sym = symf_list[i].sym;
+	db_put32(p, symf_list[i].name);
+	db_put32(p + 4, sym->value.v);
+	db_put32(p + 8, (sym->linenr < 0) ? 0 : sym->linenr);
+	db_put32(p + 12, symf_list[i].parent);
+	db_put32(p + 16, (uint32_t)sym->filenr);
+	p[20] = sym_type(sym);
+	p[21] = sym->value.t;
+    }
+
+    /* The indexes. */
+    for (i = 0; i < n; i++)
+	index[i] = i;
+    qsort(index, n, sizeof(uint32_t), symf_namecmp);
+    p = db_alloc(&sect[3], "NAME", n, 4);
+    for (i = 0; i < n; i++)
+	db_put32(p + (i * 4), index[i]);
+
+    qsort(index, n, sizeof(uint32_t), symf_addrcmp);
+    p = db_alloc(&sect[4], "ADDR", n, 4);
+    for (i = 0; i < n; i++)
+	db_put32(p + (i * 4), index[i]);
+
+    i = db_write(fn, "VSYM", SYMF_VERSION, sect, 5);
+
+    db_free(sect, 5);
+    free(index);
+    free(symf_list);
+    symf_list = NULL;
+
+    return i;
+}
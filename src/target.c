@@ -8,7 +8,7 @@
  *
  *		Handle selection of a target device.
  *
- * Version:	@(#)target.c	1.0.6	2023/08/20
+ * Version:	@(#)target.c	1.0.13	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -45,12 +45,14 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <stdint.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 #include "global.h"
 #include "error.h"
 #include "target.h"
+#include "stats.h"
 
 
 extern const target_t	t_6502_old,
@@ -124,6 +126,21 @@ static const target_t *targets[] = {
 };
 
 static const target_t	*target = NULL;
+static struct {
+    const char	*name;
+    uint32_t	count,
+		bytes,
+		cycles;
+}			saved[16];	// what the optimizer did
+static int		nsaved;
+static uint8_t		*relax_map;	// branch sites using the long form
+static uint32_t		relax_size,
+			relax_site,	// next branch site in this pass
+			insn_site,	// next instruction in this pass
+			relax_count,	// number of relaxed sites
+			relax_unknown;	// sites with an unknown target
+static int		relax_on,	// rounds were asked for
+			relax_force;	// do another round
 
 
 /*
@@ -157,6 +174,236 @@ set_cpu(const char *p, int pass)
 }
 
 
+/* Select a target by name (or none), without any side effects. */
+int
+trg_set_cpu(const char *name)
+{
+    const target_t **t;
+
+    target = NULL;
+    if (name == NULL)
+	return 1;
+
+    for (t = targets; *t != NULL; t++) {
+	if (! strcasecmp((*t)->name, name)) {
+		target = *t;
+		return 1;
+	}
+    }
+
+    return 0;
+}
+
+
+/* Return the name of the current target, if any. */
+const char *
+trg_name(void)
+{
+    return (target != NULL) ? target->name : NULL;
+}
+
+
+/* Check if the current target can count cycles. */
+int
+trg_cycles_ok(void)
+{
+    return (target != NULL) && (target->cycles != NULL);
+}
+
+
+/* Add the cycles taken by an instruction (min and max.) */
+void
+trg_cycles(int min, int max)
+{
+    cyc_line[0] += min;
+    cyc_line[1] += max;
+    cyc_total[0] += min;
+    cyc_total[1] += max;
+}
+
+
+/* Start a pass, and count the branch sites from the top. */
+void
+trg_relax_start(int pass)
+{
+    relax_site = insn_site = 0;
+
+    if (pass == 1) {
+	if (opt_R || opt_O || relax_on)
+		relax_iter++;
+	relax_moved = 0;
+	relax_force = 0;
+	relax_unknown = 0;
+    }
+}
+
+
+/*
+ * Called by a target for each branch it could relax. The far flag
+ * says if the short form can reach the target (0), not (1), or if
+ * we do not know yet (-1.) Returns 1 if the long form must be used.
+ *
+ * Sites are numbered in the order we meet them, which is the same
+ * in every round. Once relaxed, a site never goes back.
+ */
+int
+trg_relax(int pass, int far)
+{
+    uint32_t n = relax_site++;
+    uint8_t *ptr;
+
+    if (! opt_R)
+	return 0;
+
+    if (n >= relax_size) {
+	ptr = realloc(relax_map, relax_size + 1024);
+	if (ptr == NULL)
+		error(ERR_MEM, NULL);
+	memset(ptr + relax_size, 0x00, 1024);
+	relax_map = ptr;
+	relax_size += 1024;
+    }
+
+    if (!relax_map[n] && (pass == 1)) {
+	if (far < 0)
+		relax_unknown++;
+	else if (far > 0) {
+		relax_map[n] = 1;
+		relax_count++;
+	}
+    }
+
+    if (relax_map[n] && (pass == 2))
+	relax_line = 'R';
+
+    return relax_map[n];
+}
+
+
+/* A target can only decide on something in a later round. */
+void
+trg_relax_later(void)
+{
+    relax_unknown++;
+}
+
+
+/*
+ * Something other than a target (like the zero page allocator)
+ * needs another round. From then on, the rounds work just like
+ * they do for relaxing, so this one counts as the first.
+ */
+void
+trg_relax_round(void)
+{
+    if (!opt_R && !opt_O && !relax_on)
+	relax_iter = 1;
+    relax_on = 1;
+    relax_force = 1;
+}
+
+
+/*
+ * Called after Pass 1, to see if we need another round. The first
+ * round does not know the forward targets, and any later round has
+ * to be repeated if labels moved, until the addresses are stable.
+ */
+int
+trg_relax_again(void)
+{
+    if (!opt_R && !opt_O && !relax_on)
+	return 0;
+
+    if ((relax_iter < MAX_RELAX) && relax_force)
+	return 1;
+    if ((relax_iter < MAX_RELAX) &&
+	((relax_iter == 1) ? (relax_unknown > 0) : (relax_moved > 0)))
+	return 1;
+
+    if (opt_v && opt_R)
+	printf("Relaxed %u branches in %i rounds\n", relax_count, relax_iter);
+
+    return 0;
+}
+
+
+/* Number the instructions of a pass, for the optimizers. */
+uint32_t
+trg_site(void)
+{
+    return insn_site++;
+}
+
+
+/* Count what an optimizer rule saved (Pass 2.) */
+void
+trg_saved(const char *name, int count, int bytes, int cycles)
+{
+    int i;
+
+    for (i = 0; i < nsaved; i++)
+	if (saved[i].name == name)
+		break;
+    if (i == nsaved) {
+	if (nsaved == (int)(sizeof(saved) / sizeof(saved[0])))
+		return;
+	saved[nsaved].name = name;
+	saved[nsaved].count = saved[nsaved].bytes = saved[nsaved].cycles = 0;
+	nsaved++;
+    }
+
+    saved[i].count += count;
+    saved[i].bytes += bytes;
+    saved[i].cycles += cycles;
+}
+
+
+/* Show what the optimizer saved, per rule. */
+void
+trg_report(void)
+{
+    uint32_t bytes = 0, cycles = 0;
+    int i;
+
+    if (!opt_O || opt_q)
+	return;
+
+    for (i = 0; i < nsaved; i++)
+	if (saved[i].count > 0)
+		break;
+    if (i == nsaved) {
+	printf("Optimizer: nothing to improve.\n");
+	return;
+    }
+
+    printf("Optimizer:\n");
+    for (i = 0; i < nsaved; i++) {
+	if (saved[i].count == 0)
+		continue;
+	printf("  %-24s %6u times %6u bytes %7u cycles\n", saved[i].name,
+		saved[i].count, saved[i].bytes, saved[i].cycles);
+	bytes += saved[i].bytes;
+	cycles += saved[i].cycles;
+    }
+    printf("  %-24s %12s %6u bytes %7u cycles\n", "Total saved", "",
+							bytes, cycles);
+}
+
+
+/* Forget all relaxed branches. */
+void
+trg_relax_close(void)
+{
+    if (relax_map != NULL)
+	free(relax_map);
+    relax_map = NULL;
+    relax_size = relax_count = 0;
+    relax_iter = 0;
+    relax_on = relax_force = 0;
+    nsaved = 0;
+}
+
+
 /* List all supported targets. */
 void
 trg_list(void)
@@ -225,6 +472,7 @@ trg_instr(char **p, int pass)
     if (target == NULL)
 	error(ERR_NOCPU, NULL);
 
+    STATS_INC(ST_MNLOOK);
     return target->instr(target, p, pass);
 }
 
@@ -240,6 +488,7 @@ trg_instr_ok(const char *p)
 {
     int ret = 0;
 
+    STATS_INC(ST_MNLOOK);
     if (target != NULL)
 	ret = target->instr_ok(target, p);
 
@@ -8,7 +8,7 @@
  *
  *		Definitions for the target backends.
  *
- * Version:	@(#)target.h	1.0.2	2023/05/14
+ * Version:	@(#)target.h	1.0.7	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -59,16 +59,30 @@ typedef struct target {
     const char	*(*error)(int);
     int		(*instr)(const struct target *, char **, int);
     int		(*instr_ok)(const struct target *, const char *);
+
+    const uint8_t *cycles;		// cycle counts, if known
 } target_t;
 
 
 extern int		trg_set_cpu(const char *);
 
+extern const char	*trg_name(void);
 extern void		trg_list(void);
 extern void		trg_symbol(const char *);
 extern const char	*trg_error(int);
 extern int		trg_instr(char **, int);
 extern int		trg_instr_ok(const char *);
+extern int		trg_cycles_ok(void);
+extern void		trg_cycles(int, int);
+extern void		trg_relax_start(int);
+extern int		trg_relax(int, int);
+extern void		trg_relax_later(void);
+extern void		trg_relax_round(void);
+extern int		trg_relax_again(void);
+extern uint32_t		trg_site(void);
+extern void		trg_saved(const char *, int, int, int);
+extern void		trg_report(void);
+extern void		trg_relax_close(void);
 
 
 #endif	/*TARGET_H*/
@@ -21,7 +21,7 @@
  *		less power. Other than instruction timings, everything else
  *		was the same, so for code, nothing changed.
  *
- * Version:	@(#)ins8060.c	1.0.3	2026/07/01
+ * Version:	@(#)ins8060.c	1.0.4	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -65,6 +65,7 @@
 #include "../global.h"
 #include "../error.h"
 #include "../target.h"
+#include "../object.h"
 
 
 #define USE_JS		0	// include "JS" pseudo
@@ -277,6 +278,7 @@ grp_imm(char **p, int pass, const opcode_t *instr)
     x &= 0xff;
 
     emit_byte(instr->opcode, pass);
+    emit_reloc(v, OBJ_BYTE, pass);
     emit_byte((uint8_t)x, pass);
 
     return 2;
@@ -351,10 +353,15 @@ foo = 1;
 else
 foo = 0;
 
-    if (ptr == 0)
+    /* Only an absolute displacement can be used with a pointer. */
+    if (ptr == 0) {
+	emit_relative(v);
 	off = get_ea((uint16_t)v.v, pass);
-    else
+    } else {
+	if (v.r != RELOC_NONE)
+		error(ERR_RELOC, NULL);
 	off = (uint16_t)v.v;
+    }
 
     /* If not DLD or ILD (so, jumps) .. */
     if (instr->opcode != 0xa8 && instr->opcode != 0xb8)
@@ -419,10 +426,15 @@ grp_mem(char **p, int pass, const opcode_t *instr)
 		error(ERR_PTR, NULL);
     }
 
-    if (ptr == 0)
+    /* Only an absolute displacement can be used with a pointer. */
+    if (ptr == 0) {
+	emit_relative(v);
 	off = get_ea((uint16_t)v.v, pass);
-    else
+    } else {
+	if (v.r != RELOC_NONE)
+		error(ERR_RELOC, NULL);
 	off = (uint16_t)v.v;
+    }
 
     op = instr->opcode;
     if (ind)
@@ -455,7 +467,7 @@ grp_mem(char **p, int pass, const opcode_t *instr)
 static int
 grp_js(char **p, int pass, const opcode_t *instr)
 {
-    value_t v;
+    value_t v, hi, lo;
     int ptr;
 
     /* Get the pointer register. */
@@ -480,12 +492,17 @@ grp_js(char **p, int pass, const opcode_t *instr)
     v.v--;
     v.v &= 0xffff;
 
+    hi = value_hi(v);
+    lo = value_lo(v);
+
     /* Generate the code for this. */
     emit_byte(0xc4, pass);		// LDI >(expr-1)
-    emit_byte((v.v >> 8), pass);
+    emit_reloc(hi, OBJ_BYTE, pass);
+    emit_byte(hi.v, pass);
     emit_byte(0x34 + ptr, pass);	// XPAH ptr
     emit_byte(0xc4, pass);		// LDI <(expr-1)
-    emit_byte((v.v & 0xff), pass);
+    emit_reloc(lo, OBJ_BYTE, pass);
+    emit_byte(lo.v, pass);
     emit_byte(0x30 + ptr, pass);	// XPAL ptr
     emit_byte(0x3c + ptr, pass);	// XPPC ptr
 
@@ -512,7 +529,7 @@ grp_js(char **p, int pass, const opcode_t *instr)
 static int
 grp_ldpi(char **p, int pass, const opcode_t *instr)
 {
-    value_t v;
+    value_t v, hi, lo;
     int ptr;
 
     /* Get the pointer register. */
@@ -533,12 +550,17 @@ grp_ldpi(char **p, int pass, const opcode_t *instr)
 		error(ERR_UNDEF, NULL);
     }
 
+    hi = value_hi(v);
+    lo = value_lo(v);
+
     /* Generate the code for this. */
     emit_byte(0xc4, pass);		// LDI >expr
-    emit_byte((v.v >> 8), pass);
+    emit_reloc(hi, OBJ_BYTE, pass);
+    emit_byte(hi.v, pass);
     emit_byte(0x34 + ptr, pass);	// XPAH ptr
     emit_byte(0xc4, pass);		// LDI <expr
-    emit_byte((v.v & 0xff), pass);
+    emit_reloc(lo, OBJ_BYTE, pass);
+    emit_byte(lo.v, pass);
     emit_byte(0x30 + ptr, pass);	// XPAL ptr
 
     return 6;
@@ -14,7 +14,7 @@
  *		version produced later. The CMOS version also has variants
  *		from Rockwell and WDC, with even more changes.
  *
- * Version:	@(#)mos6502.c	1.0.7	2023/05/14
+ * Version:	@(#)mos6502.c	1.0.12	2026/10/18
  *
  * Authors:	Fred N. van Kempen, <waltje@varcem.com>
  *		Bernd Bckmann, <https://codeberg.org/boeckmann/asm6502>
@@ -52,12 +52,15 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <stdint.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 #include "../global.h"
 #include "../error.h"
 #include "../target.h"
+#include "../object.h"
+#include "../page.h"
 
 
 #define AM_NUM          15		// number of addressing modes
@@ -368,6 +371,64 @@ static const opcode_t opc_cmos[] = {
 };
 
 
+/*
+ * Cycle counts, per opcode. The low bits have the base count, and
+ * the flags tell us when to add more: one more if an index crosses
+ * a page boundary, and for branches, one more if the branch is
+ * taken, plus one if that crosses a page. The extra cycle for ADC
+ * and SBC in decimal mode on the CMOS parts is not counted, as we
+ * cannot know that mode at assembly time.
+ */
+#define CY_BASE		0x0f		// base number of cycles
+#define CY_PAGE		0x10		// +1 if page crossed
+#define CY_BRANCH	0x20		// +1 if taken, +1 if page crossed
+#define CY_ALWAYS	0x40		// always taken, +1 if page crossed
+
+#define PG(n)		((n) | CY_PAGE)
+#define BR(n)		((n) | CY_BRANCH)
+#define BA(n)		((n) | CY_ALWAYS)
+
+static const uint8_t cyc_nmos[256] = {
+/*  x0    x1    x2    x3    x4    x5    x6    x7    x8    x9    xA    xB    xC    xD    xE    xF  */
+ 7,    6,    0,    0,    0,    3,    5,    0,    3,    2,    2,    0,    0,    4,    6,    0,	// 0x
+ BR(2),PG(5),0,    0,    0,    4,    6,    0,    2,    PG(4),0,    0,    0,    PG(4),7,    0,	// 1x
+ 6,    6,    0,    0,    3,    3,    5,    0,    4,    2,    2,    0,    4,    4,    6,    0,	// 2x
+ BR(2),PG(5),0,    0,    0,    4,    6,    0,    2,    PG(4),0,    0,    0,    PG(4),7,    0,	// 3x
+ 6,    6,    0,    0,    0,    3,    5,    0,    3,    2,    2,    0,    3,    4,    6,    0,	// 4x
+ BR(2),PG(5),0,    0,    0,    4,    6,    0,    2,    PG(4),0,    0,    0,    PG(4),7,    0,	// 5x
+ 6,    6,    0,    0,    0,    3,    5,    0,    4,    2,    2,    0,    5,    4,    6,    0,	// 6x
+ BR(2),PG(5),0,    0,    0,    4,    6,    0,    2,    PG(4),0,    0,    0,    PG(4),7,    0,	// 7x
+ 0,    6,    0,    0,    3,    3,    3,    0,    2,    0,    2,    0,    4,    4,    4,    0,	// 8x
+ BR(2),6,    0,    0,    4,    4,    4,    0,    2,    5,    2,    0,    0,    5,    0,    0,	// 9x
+ 2,    6,    2,    0,    3,    3,    3,    0,    2,    2,    2,    0,    4,    4,    4,    0,	// Ax
+ BR(2),PG(5),0,    0,    4,    4,    4,    0,    2,    PG(4),2,    0,    PG(4),PG(4),PG(4),0,	// Bx
+ 2,    6,    0,    0,    3,    3,    5,    0,    2,    2,    2,    0,    4,    4,    6,    0,	// Cx
+ BR(2),PG(5),0,    0,    0,    4,    6,    0,    2,    PG(4),0,    0,    0,    PG(4),7,    0,	// Dx
+ 2,    6,    0,    0,    3,    3,    5,    0,    2,    2,    2,    0,    4,    4,    6,    0,	// Ex
+ BR(2),PG(5),0,    0,    0,    4,    6,    0,    2,    PG(4),0,    0,    0,    PG(4),7,    0	// Fx
+};
+
+static const uint8_t cyc_cmos[256] = {
+/*  x0    x1    x2    x3    x4    x5    x6    x7    x8    x9    xA    xB    xC    xD    xE    xF  */
+ 7,    6,    0,    0,    5,    3,    5,    5,    3,    2,    2,    0,    6,    4,    6,    BR(5),	// 0x
+ BR(2),PG(5),5,    0,    5,    4,    6,    5,    2,    PG(4),2,    0,    6,    PG(4),PG(6),BR(5),	// 1x
+ 6,    6,    0,    0,    3,    3,    5,    5,    4,    2,    2,    0,    4,    4,    6,    BR(5),	// 2x
+ BR(2),PG(5),5,    0,    4,    4,    6,    5,    2,    PG(4),2,    0,    PG(4),PG(4),PG(6),BR(5),	// 3x
+ 6,    6,    0,    0,    0,    3,    5,    5,    3,    2,    2,    0,    3,    4,    6,    BR(5),	// 4x
+ BR(2),PG(5),5,    0,    0,    4,    6,    5,    2,    PG(4),3,    0,    0,    PG(4),PG(6),BR(5),	// 5x
+ 6,    6,    0,    0,    3,    3,    5,    5,    4,    2,    2,    0,    6,    4,    6,    BR(5),	// 6x
+ BR(2),PG(5),5,    0,    4,    4,    6,    5,    2,    PG(4),4,    0,    6,    PG(4),PG(6),BR(5),	// 7x
+ BA(3),6,    0,    0,    3,    3,    3,    5,    2,    2,    2,    0,    4,    4,    4,    BR(5),	// 8x
+ BR(2),6,    5,    0,    4,    4,    4,    5,    2,    5,    2,    0,    4,    5,    5,    BR(5),	// 9x
+ 2,    6,    2,    0,    3,    3,    3,    5,    2,    2,    2,    0,    4,    4,    4,    BR(5),	// Ax
+ BR(2),PG(5),5,    0,    4,    4,    4,    5,    2,    PG(4),2,    0,    PG(4),PG(4),PG(4),BR(5),	// Bx
+ 2,    6,    0,    0,    3,    3,    5,    5,    2,    2,    2,    3,    4,    4,    6,    BR(5),	// Cx
+ BR(2),PG(5),5,    0,    0,    4,    6,    5,    2,    PG(4),3,    3,    0,    PG(4),7,    BR(5),	// Dx
+ 2,    6,    0,    0,    3,    3,    5,    5,    2,    2,    2,    0,    4,    4,    6,    BR(5),	// Ex
+ BR(2),PG(5),5,    0,    0,    4,    6,    5,    2,    PG(4),4,    0,    0,    PG(4),7,    BR(5)	// Fx
+};
+
+
 static const uint16_t	am_size[AM_NUM] = { 1,1,2,2,2,2,2,2,2,3,3,3,3,2,2 };
 
 
@@ -382,6 +443,63 @@ static const char *err_msg[ERR_MAXTRG - ERR_MAXERR] = {
 };
 
 
+/*
+ * The peephole optimizer (-O option.)
+ *
+ * Each instruction is looked at together with the one(s) before
+ * it, before any code is emitted. Anything that could be the target
+ * of a jump (a label) and anything that is not an instruction ends
+ * the window. The decisions are made in Pass 1, and kept for each
+ * instruction ("site"), so Pass 2 does exactly the same and the
+ * sizes agree.
+ */
+#define PO_ZP		0x01		// use the zero page form
+#define PO_DROP		0x02		// leave the instruction out
+#define PO_ALT		0x04		// use the rule's other mnemonic
+#define PO_RULE(f)	((f) >> 4)	// rule that was applied
+
+#define PR_ALT		0x01		// change the first instruction
+#define PR_DROP		0x02		// drop the next instruction
+#define PR_STZ		0x04		// clear stores, until A is loaded
+
+#define PEEP_MAXRUN	8		// maximum number of stores to clear
+
+
+typedef struct peep {
+    const char	*name;			// name for the report
+    const char	*first,			// mnemonic of first instruction
+		*next;			// mnemonic of next instruction
+    int		am;			// mode of first instruction
+    int		flags;
+    const char	*alt;			// mnemonic to change to
+} peep_t;
+
+
+static const peep_t peep_rules[] = {
+  { "absolute to zero page",	NULL,  NULL,  AM_INV, 0,	    NULL  },
+  { "JSR, RTS to JMP",		"JSR", "RTS", AM_ABS, PR_ALT|PR_DROP, "JMP" },
+  { "CLC after CLC",		"CLC", "CLC", AM_IMP, PR_DROP,	    NULL  },
+  { "CLC after BCS",		"BCS", "CLC", AM_REL, PR_DROP,	    NULL  },
+  { "SEC after SEC",		"SEC", "SEC", AM_IMP, PR_DROP,	    NULL  },
+  { "SEC after BCC",		"BCC", "SEC", AM_REL, PR_DROP,	    NULL  },
+  { "LDA #0, STA to STZ",	"LDA", "STA", AM_IMM, PR_STZ,	    "STZ" },
+  { NULL							  }
+};
+
+static uint8_t		*peep_map;	// decisions, per site
+static uint32_t		peep_size;
+static struct {
+    const opcode_t	*op;		// last instruction, if any
+    int			am;
+    uint32_t		site,
+			pc,		// where it ended
+			size,
+			stamp;		// symbol table at that time
+} peep_last;
+static uint32_t		peep_run[PEEP_MAXRUN + 1];
+static int		peep_nrun;	// LDA #0 and stores following it
+
+
 /* Handle the Implied and Accumulator modes. */
 static int
 op_imp_acc(char **p, int pass, const opcode_t *instr)
@@ -420,27 +538,21 @@ op_imp_acc(char **p, int pass, const opcode_t *instr)
     else
 	error(ERR_AM, NULL);
 
-    emit_byte(instr->opc[am], pass);
-
     return am;
 }
 
 
 /* Handle the Immediate mode. */
 static int
-op_imm(char **p, int pass, const opcode_t *instr)
+op_imm(char **p, int pass, const opcode_t *instr, value_t *v)
 {
     int am = AM_IMM;
-    value_t v;
 
     (*p)++;
     if (instr->opc[am] == INV) error(ERR_AM, NULL);
-    v = expr(p);
+    *v = expr(p);
     if (pass == 2)
-	if (UNDEFINED(v)) error(ERR_UNDEF, NULL);
-
-    emit_byte(instr->opc[am], pass);
-    emit_byte((uint8_t)to_byte(v, 0).v, pass);
+	if (UNDEFINED(*v)) error(ERR_UNDEF, NULL);
 
     return am;
 }
@@ -452,11 +564,7 @@ op_rel(int pass, const opcode_t *instr, value_t v)
 {
     int am = AM_REL;
     uint16_t pct = pc + 2u;
-    uint16_t off;
 
-    /* relative branch offsets are in 2-complement */
-    /* have to calculate it by hand avoiding implementation defined behaviour */
-    /* using unsigned int because int may not be in 2-complement */
     if (pass == 2) {
 	if (UNDEFINED(v)) error(ERR_UNDEF, NULL);
 
@@ -466,21 +574,68 @@ op_rel(int pass, const opcode_t *instr, value_t v)
 		error(ERR_RELRNG, NULL);
     }
 
-    if (v.v >= pct)
-	off = v.v - pct;
+    return am;
+}
+
+/*
+ * Relax a branch that cannot reach its target, if enabled.
+ *
+ * A conditional branch becomes the inverse branch around a JMP,
+ * and BRA just becomes a JMP. Returns the size of the code, or 0
+ * if the branch fits (or cannot be relaxed), and the short form
+ * is used.
+ */
+static int
+op_far(int pass, const target_t *trg, uint8_t opc, value_t v)
+{
+    uint16_t pct = pc + 2u;
+    int far;
+
+    if ((opc != 0x80) && ((opc & 0x1f) != 0x10))
+	return 0;
+
+    if (UNDEFINED(v)) {
+	if (pass == 2)
+		error(ERR_UNDEF, NULL);
+	far = -1;
+    } else if (v.v >= pct)
+	far = ((uint16_t)(v.v - pct) > 0x7f);
     else
-	off = (uint16_t)((~0) - (pct - v.v - 1));
+	far = ((uint16_t)(pct - v.v) > 0x80);
 
-    emit_byte(instr->opc[am], pass);
-    emit_byte(off & 0xff, pass);
+    if (! trg_relax(pass, far))
+	return 0;
 
-    return am;
+    if (opc == 0x80) {
+	emit_byte(0x4c, pass);
+	emit_reloc(v, OBJ_WORD, pass);
+	emit_word((uint16_t)v.v, pass);
+
+	if (trg->cycles != NULL)
+		trg_cycles(3, 3);
+
+	return 3;
+    }
+
+    emit_byte(opc ^ 0x20, pass);
+    emit_byte(0x03, pass);
+    emit_byte(0x4c, pass);
+    emit_reloc(v, OBJ_WORD, pass);
+    emit_word((uint16_t)v.v, pass);
+
+    /* Taken, it falls into the JMP; if not, it branches over it. */
+    if (trg->cycles != NULL)
+	trg_cycles(3 + ((((pc + 2) ^ (pc + 5)) & 0xff00) != 0), 5);
+
+    return 5;
 }
 
 
+
+
 /* Handle the Indirect mode. */
 static int
-op_ind(char **p, int pass, const opcode_t *instr)
+op_ind(char **p, int pass, const opcode_t *instr, value_t *vp)
 {
     char id[ID_LEN];
     int am = AM_INV;
@@ -528,11 +683,7 @@ op_ind(char **p, int pass, const opcode_t *instr)
 		error(ERR_ILLTYPE, NULL);
     }
 
-    emit_byte(instr->opc[am], pass);
-    if (am == AM_IND)
-	emit_word(v.v, pass);
-    else
-	emit_byte((uint8_t)to_byte(v, 0).v, pass);
+    *vp = v;
 
     return am;
 }
@@ -572,12 +723,6 @@ op_abxy_zpxy(char **p, int pass, const opcode_t *instr, value_t v)
     if (pass == 2)
 	if (UNDEFINED(v)) error(ERR_UNDEF, NULL);
 
-    emit_byte(instr->opc[am], pass);
-    if ((am == AM_ZPX) || (am == AM_ZPY))
-	emit_byte((uint8_t)to_byte(v, 0).v, pass);
-    else
-	emit_word(v.v, pass);
-
     return am;
 }
 
@@ -588,28 +733,67 @@ op_abs_zp(int pass, const opcode_t *instr, value_t v)
 {
     int am = AM_INV;
 
-    if ((TYPE(v) == TYPE_BYTE) && AM_VALID(instr, AM_ZP)) {
+    if ((TYPE(v) == TYPE_BYTE) && AM_VALID(instr, AM_ZP))
 	am = AM_ZP;
+    else if (AM_VALID(instr, AM_ABS))
+	am = AM_ABS;
+    else
+	error(ERR_AM, NULL);
 
-	if (pass == 2) {
-		if (UNDEFINED(v)) error(ERR_UNDEF, NULL);
-	}
+    if (pass == 2) {
+	if (UNDEFINED(v)) error(ERR_UNDEF, NULL);
+    }
 
-	emit_byte(instr->opc[am], pass);
-	emit_byte((uint8_t)to_byte(v, 0).v, pass);
-    } else if (AM_VALID(instr, AM_ABS)) {
-	am = AM_ABS;
+    return am;
+}
 
-	if (pass == 2) {
-		if (UNDEFINED(v)) error(ERR_UNDEF, NULL);
-	}
 
-	emit_byte(instr->opc[am], pass);
+/* Emit the code for an instruction. */
+static void
+op_emit(int pass, uint8_t opc, int am, value_t v)
+{
+    uint16_t pct = pc + 2u;
+    uint16_t off;
+
+    emit_byte(opc, pass);
+
+    if (am == AM_REL) {
+	/* relative branch offsets are in 2-complement */
+	/* have to calculate it by hand avoiding implementation defined behaviour */
+	/* using unsigned int because int may not be in 2-complement */
+	emit_relative(v);
+	if (v.v >= pct)
+		off = v.v - pct;
+	else
+		off = (uint16_t)((~0) - (pct - v.v - 1));
+
+	emit_byte(off & 0xff, pass);
+    } else if (am_size[am] == 3) {
+	emit_reloc(v, OBJ_WORD, pass);
 	emit_word(v.v, pass);
-    } else
-	error(ERR_AM, NULL);
+    } else if (am_size[am] == 2) {
+	emit_reloc(v, OBJ_BYTE, pass);
+	emit_byte((uint8_t)to_byte(v, 0).v, pass);
+    }
+}
 
-    return am;
+
+/* Report the cycles used by an instruction. */
+static void
+op_cycles(const uint8_t *cycles, uint8_t opc, int cross)
+{
+    uint8_t c = cycles[opc];
+    int min, max;
+
+    min = max = (c & CY_BASE);
+    if ((c & CY_PAGE) && cross)
+	max++;
+    if (c & CY_BRANCH)
+	max += 1 + cross;
+    if ((c & CY_ALWAYS) && cross)
+	min = ++max;
+
+    trg_cycles(min, max);
 }
 
 
@@ -631,6 +815,146 @@ get_mnemonic(const opcode_t *table, int size, const char *p)
 }
 
 
+/* Return the zero page form of an absolute mode, if any. */
+static int
+peep_zp(int am)
+{
+    switch (am) {
+	case AM_ABS:
+		return AM_ZP;
+
+	case AM_ABX:
+		return AM_ZPX;
+
+	case AM_ABY:
+		return AM_ZPY;
+    }
+
+    return AM_INV;
+}
+
+
+/* Return the opcode a rule changes an instruction to. */
+static uint8_t
+peep_alt(const target_t *trg, int rule, int am)
+{
+    const opcode_t *op;
+
+    if ((peep_rules[rule].alt == NULL) ||
+	((op = get_mnemonic((const opcode_t *)trg->priv, trg->priv2,
+				peep_rules[rule].alt)) == NULL))
+	return INV;
+
+    return op->opc[am];
+}
+
+
+/* Return the decisions for a site. */
+static uint8_t *
+peep_site(uint32_t site)
+{
+    uint8_t *ptr;
+
+    if (site >= peep_size) {
+	ptr = realloc(peep_map, peep_size + 1024);
+	if (ptr == NULL)
+		error(ERR_MEM, NULL);
+	memset(ptr + peep_size, 0x00, 1024);
+	peep_map = ptr;
+	peep_size += 1024;
+    }
+
+    return &peep_map[site];
+}
+
+
+/* Return the base cycles of an opcode, if we know them. */
+static int
+peep_cycles(const target_t *trg, uint8_t opc)
+{
+    return (trg->cycles != NULL) ? (trg->cycles[opc] & CY_BASE) : 0;
+}
+
+
+/*
+ * Look at this instruction and the ones before it (Pass 1 only.)
+ * Returns the decisions for this site, and may change earlier ones.
+ */
+static int
+peep_check(const target_t *trg, const opcode_t *op, int am, value_t v,
+	   uint32_t site)
+{
+    const peep_t *r;
+    int f = 0, i;
+
+    /*
+     * An absolute address that fits in the zero page. We do not know
+     * where a relocatable one goes, so that one stays absolute.
+     */
+    if (peep_zp(am) != AM_INV && AM_VALID(op, peep_zp(am))) {
+	if (UNDEFINED(v))
+		trg_relax_later();
+	else if ((v.v < 0x0100) && (v.r == RELOC_NONE))
+		f |= PO_ZP;
+    }
+
+    /* Anything in between ends the window. */
+    if ((peep_last.op == NULL) || (peep_last.pc != pc) ||
+	(peep_last.size != output_size) || (peep_last.stamp != sym_stamp)) {
+	peep_last.op = NULL;
+	peep_nrun = 0;
+    }
+
+    for (r = &peep_rules[1]; (peep_last.op != NULL) && (r->name != NULL); r++) {
+	if (r->flags & PR_STZ)
+		continue;
+
+	if (strcmp(peep_last.op->mn, r->first) || (peep_last.am != r->am) ||
+	    strcmp(op->mn, r->next))
+		continue;
+
+	if ((r->flags & PR_ALT) &&
+	    (peep_alt(trg, (int)(r - peep_rules), r->am) == INV))
+		continue;
+
+	if (r->flags & PR_ALT)
+		*peep_site(peep_last.site) |= PO_ALT | ((r - peep_rules) << 4);
+	f |= PO_DROP | ((r - peep_rules) << 4);
+	break;
+    }
+
+    /* Stores of a zero we loaded, which can be STZ if A gets loaded again. */
+    for (r = &peep_rules[1]; r->name != NULL; r++)
+	if (r->flags & PR_STZ)
+		break;
+    if (peep_nrun > 0) {
+	if (!strcmp(op->mn, "LDA") || !strcmp(op->mn, "PLA") ||
+	    !strcmp(op->mn, "TXA") || !strcmp(op->mn, "TYA")) {
+		if (peep_nrun > 1) {
+			*peep_site(peep_run[0]) |= PO_DROP | ((r - peep_rules) << 4);
+			for (i = 1; i < peep_nrun; i++)
+				*peep_site(peep_run[i]) |= PO_ALT | ((r - peep_rules) << 4);
+
+			/* Take back the LDA we already counted. */
+			emit_undo(am_size[AM_IMM], 1);
+			pc -= am_size[AM_IMM];
+		}
+		peep_nrun = 0;
+	} else if (!strcmp(op->mn, r->next) && (peep_nrun <= PEEP_MAXRUN) &&
+		   (peep_alt(trg, (int)(r - peep_rules),
+			     (f & PO_ZP) ? peep_zp(am) : am) != INV))
+		peep_run[peep_nrun++] = site;
+	else
+		peep_nrun = 0;
+    }
+    if ((peep_nrun == 0) && (am == r->am) && !strcmp(op->mn, r->first) &&
+	DEFINED(v) && (v.v == 0) && (v.r == RELOC_NONE) && (peep_alt(trg, (int)(r - peep_rules), AM_ZP) != INV))
+	peep_run[peep_nrun++] = site;
+
+    return f;
+}
+
+
 /*
  * Process one instruction.
  *
@@ -651,8 +975,22 @@ t_instr(const target_t *trg, char **p, int pass)
 {
     char id[ID_LEN];
     const opcode_t *op;
+    uint32_t site;
     int am = AM_INV;
-    value_t v;
+    int cross = 1;
+    int f = 0, n;
+    uint8_t opc;
+    value_t v = { 0 };
+
+    /* Number this instruction, and start over with a new pass. */
+    site = trg_site();
+    if (site == 0) {
+	peep_last.op = NULL;
+
+	/* Have the report list the rules in our order. */
+	for (n = 0; opt_O && (pass == 2) && (peep_rules[n].name != NULL); n++)
+		trg_saved(peep_rules[n].name, 0, 0, 0);
+    }
 
     /* Convert the mnemonic to uppercase. */
     ident_upcase(p, id);
@@ -670,10 +1008,10 @@ t_instr(const target_t *trg, char **p, int pass)
 	/* Good, we handled that. */
     } else if (**p == '#') {
 	/* Immediate mode. */
-	am = op_imm(p, pass, op);
+	am = op_imm(p, pass, op, &v);
     } else if (**p == '(') {
 	/* Indirect addressing modes. */
-	am = op_ind(p, pass, op);
+	am = op_ind(p, pass, op, &v);
     } else {
 	/* Relative and absolute addressing modes. */
 	v = expr(p);
@@ -681,10 +1019,17 @@ t_instr(const target_t *trg, char **p, int pass)
 
 	/* Relative instruction mode if instruction supports it. */
 	if (op->opc[AM_REL] != INV) {
+		cross = ((((pc + 2) ^ v.v) & 0xff00) != 0);
+		if ((n = op_far(pass, trg, op->opc[AM_REL], v)) > 0) {
+			peep_last.op = NULL;
+			return n;
+		}
 		am = op_rel(pass, op, v);
+		page_branch(pass, pc, pc + 2, v.v);
 	} else if (**p == ',') {
 		/* .. else we try the possible absolute addressing modes. */
 		skip_curr_and_white(p);
+		cross = ((v.v & 0xff) != 0);
 		am = op_abxy_zpxy(p, pass, op, v);
 	} else {
 		/* Must be absolute or zeropage addressing. */
@@ -696,6 +1041,58 @@ t_instr(const target_t *trg, char **p, int pass)
     if (am == AM_INV)
 	error(ERR_AM, id);
 
+    /* Let the optimizer decide (Pass 1), or do what it decided. */
+    if (opt_O && (pass == 1)) {
+	f = peep_check(trg, op, am, v, site);
+	*peep_site(site) = f;
+    } else if (opt_O && (site < peep_size))
+	f = peep_map[site];
+    opc = op->opc[am];
+
+    if (f & PO_ZP) {
+	n = opc;
+	am = peep_zp(am);
+	opc = op->opc[am];
+	if (pass == 2)
+		trg_saved(peep_rules[0].name, 1, 1,
+			  peep_cycles(trg, n) - peep_cycles(trg, opc));
+	relax_line = 'O';
+    }
+
+    if (f & PO_DROP) {
+	if (pass == 2)
+		trg_saved(peep_rules[PO_RULE(f)].name, 1, am_size[am],
+			  peep_cycles(trg, opc));
+	relax_line = 'O';
+	peep_last.stamp = sym_stamp;
+	return 0;
+    }
+
+    if (f & PO_ALT) {
+	n = opc;
+	opc = peep_alt(trg, PO_RULE(f), am);
+	if (pass == 2)
+		trg_saved(peep_rules[PO_RULE(f)].name, 0, 0,
+			  peep_cycles(trg, n) - peep_cycles(trg, opc));
+	relax_line = 'O';
+    }
+
+    op_emit(pass, opc, am, v);
+    if ((am == AM_ABX) || (am == AM_ABY))
+	page_index(pass, v.v);
+
+    /* Tell the core how long this takes, if we know. */
+    if (trg->cycles != NULL)
+	op_cycles(trg->cycles, opc, cross);
+
+    /* Remember it, so the optimizer can look back. */
+    peep_last.op = op;
+    peep_last.am = am;
+    peep_last.site = site;
+    peep_last.pc = pc + am_size[am];
+    peep_last.size = output_size;
+    peep_last.stamp = sym_stamp;
+
     /* Return the amount of code generated. */
     return am_size[am];
 }
@@ -743,40 +1140,46 @@ const target_t t_6502_old = {
     "6502_old", CPU_CMOS,
     "MOS6502 (old)",
     opc_nmos, (sizeof(opc_nmos) / sizeof(opcode_t)),
-    t_error, t_instr, t_instr_ok
+    t_error, t_instr, t_instr_ok,
+    cyc_nmos
 };
 
 const target_t t_6502_nmos = {
     "6502", CPU_NMOS_1,
     "MOS6502",
     opc_nmos, (sizeof(opc_nmos) / sizeof(opcode_t)),
-    t_error, t_instr, t_instr_ok
+    t_error, t_instr, t_instr_ok,
+    cyc_nmos
 };
 
 const target_t t_csg6510 = {
     "6510", CPU_NMOS_1,
     "CSG6510",
     opc_nmos, (sizeof(opc_nmos) / sizeof(opcode_t)),
-    t_error, t_instr, t_instr_ok
+    t_error, t_instr, t_instr_ok,
+    cyc_nmos
 };
 
 const target_t t_csg8500 = {
     "8500", CPU_NMOS_1,
     "CSG8500",
     opc_nmos, (sizeof(opc_nmos) / sizeof(opcode_t)),
-    t_error, t_instr, t_instr_ok
+    t_error, t_instr, t_instr_ok,
+    cyc_nmos
 };
 
 const target_t t_r65c02 = {
     "65c02", CPU_CMOS,
     "Rockwell 65C02",
     opc_cmos, (sizeof(opc_cmos) / sizeof(opcode_t)),
-    t_error, t_instr, t_instr_ok
+    t_error, t_instr, t_instr_ok,
+    cyc_cmos
 };
 
 const target_t t_w65c02 = {
     "w65c02", CPU_CMOS | CPU_WDC,
     "WDC 65C02",
     opc_cmos, (sizeof(opc_cmos) / sizeof(opcode_t)),
-    t_error, t_instr, t_instr_ok
+    t_error, t_instr, t_instr_ok,
+    cyc_cmos
 };
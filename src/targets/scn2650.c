@@ -12,7 +12,7 @@
  *		we tried to recognize syntaxes from several assemblers out
  *		there. For the most part, this works.
  *
- * Version:	@(#)scn2650.c	1.0.1	2023/05/15
+ * Version:	@(#)scn2650.c	1.0.2	2026/10/18
  *
  * Author:	Fred N. van Kempen, <waltje@varcem.com>
  *
@@ -56,6 +56,7 @@
 #include "../global.h"
 #include "../error.h"
 #include "../target.h"
+#include "../object.h"
 
 
 typedef enum {
@@ -425,6 +426,7 @@ op_imm(char **p, int pass, const opcode_t *instr)
     }
 
     emit_byte(instr->opcode|reg, pass);
+    emit_reloc(v, OBJ_BYTE, pass);
     emit_byte((uint8_t)to_byte(v, 0).v, pass);
 
     return 2;
@@ -641,7 +643,11 @@ op_abs(char **p, int pass, const opcode_t *instr)
     if (ind)
 	addr |= 0x8000;
 
+    /* The flags just go along with the relocation. */
+    v.v = addr;
+
     emit_byte(instr->opcode|reg, pass);
+    emit_reloc(v, OBJ_WORDBE, pass);
     emit_word_be(addr, pass);
 
     return 3;
@@ -724,6 +730,7 @@ op_rel(char **p, int pass, const opcode_t *instr)
     }
 
     pct = pc + 2;
+    emit_relative(v);
 
     if (pass == 2) {
 	if (UNDEFINED(v))
@@ -838,15 +845,21 @@ op_branch(char **p, int pass, const opcode_t *instr)
 	addr &= 0x7fff;
 	if (ind)
 		addr |= 0x8000;
+	v.v = addr;
 
 	emit_byte(instr->opcode|arg, pass);
+	emit_reloc(v, OBJ_WORDBE, pass);
 	emit_word_be(addr, pass);
     } else {
 	/* ZBRR and ZBSR are relative to 0, others are relative to PC+2. */
-	if (instr->opcode == 0x9b || instr->opcode == 0xbb)
+	if (instr->opcode == 0x9b || instr->opcode == 0xbb) {
+		if (v.r != RELOC_NONE)
+			error(ERR_RELOC, NULL);
 		pct = 0x0000;
-	else
+	} else {
+		emit_relative(v);
 		pct = pc + 2;
+	}
 
 	if (pass == 2) {
 		if (UNDEFINED(v))
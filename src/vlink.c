@@ -0,0 +1,763 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Link the relocatable object files created by "vasm -r"
+ *		into a single binary image.
+ *
+ *		Sections with the same name are put together, in the order
+ *		of the files on the command line, each one aligned as its
+ *		object file asks. Where the sections go is given by a small
+ *		script file (-T), with lines like:
+ *
+ *		  section text $1000	text starts at $1000
+ *		  section data *	data follows the previous one
+ *		  fill $FF		fill the gaps with $FF
+ *
+ *		Sections that are not in the script follow the last one,
+ *		in the order we first saw them. Without a script, the first
+ *		section starts at 0.
+ *
+ *		The image goes from the lowest address used up to the end
+ *		of the highest one, with any gaps filled.
+ *
+ * Usage:	vlink [-v] [-T script] [-m mapfile] [-o outfile] file ...
+ *
+ * Version:	@(#)vlink.c	1.0.1	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifndef _MSC_VER
+# include <getopt.h>
+#endif
+#include "object.h"
+
+
+#define IMAGE_MAX	0x01000000	// max size of an image
+
+
+typedef struct osect {			// an output section
+    char	*name;
+    uint32_t	addr,
+		size;
+    int		fixed;			// address given by the script
+} osect_t;
+
+typedef struct isect {			// a section from an object file
+    char	*name;
+    int		file;
+    uint32_t	size,
+		align,
+		addr;			// where it was put
+    uint8_t	*data;
+} isect_t;
+
+typedef struct gsym {			// an exported symbol
+    char	*name;
+    int		file,
+		sect;			// in isects[], or -1 if absolute
+    uint32_t	value;
+} gsym_t;
+
+typedef struct irel {			// a relocation
+    int		sect;			// in isects[]
+    uint32_t	off,
+		addend;
+    char	kind,
+		type;			// target is a Section or eXtern
+    int		target;
+} irel_t;
+
+typedef struct ifile {			// an object file
+    const char	*name;
+    int		first,			// its first section in isects[]
+		nsects;
+    int		*exts,			// its externs, in gsyms[]
+		nexts,
+		mexts;
+} ifile_t;
+
+
+#ifdef _MSC_VER
+extern int	getopt(int ac, char *av[], const char *),
+		optind, opterr;
+extern char	*optarg;
+#endif
+
+
+static int	opt_v;
+static int	errors;
+static uint8_t	fill = 0x00;		// value for the gaps
+
+static ifile_t	*files;
+static int	nfiles;
+static isect_t	*isects;
+static int	nisects,
+		misects;
+static osect_t	*osects;
+static int	nosects,
+		mosects;
+static gsym_t	*gsyms;
+static int	ngsyms,
+		mgsyms;
+static irel_t	*irels;
+static int	nirels,
+		mirels;
+
+
+static void
+usage(const char *prog)
+{
+    printf("Usage: %s [-v] [-T script] [-m mapfile] [-o outfile] file ...\n", prog);
+
+    exit(1);
+    /*NOTREACHED*/
+}
+
+
+/* Report an error, and keep going. */
+static void
+err(const char *fmt, ...)
+{
+    va_list args;
+
+    fprintf(stderr, "vlink: ");
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+
+    errors++;
+}
+
+
+/* Make room for more entries in a table. */
+static void *
+grow(void *ptr, int *max, size_t size)
+{
+    int n = (*max > 0) ? (*max * 2) : 16;
+
+    ptr = realloc(ptr, n * size);
+    if (ptr == NULL) {
+	fprintf(stderr, "vlink: out of memory!\n");
+	exit(1);
+    }
+    *max = n;
+
+    return ptr;
+}
+
+
+static char *
+save(const char *str)
+{
+    char *s = malloc(strlen(str) + 1);
+
+    if (s == NULL) {
+	fprintf(stderr, "vlink: out of memory!\n");
+	exit(1);
+    }
+
+    return strcpy(s, str);
+}
+
+
+/* Parse a number, in decimal, or in hex with a $ or 0x prefix. */
+static int
+number(const char *str, uint32_t *val)
+{
+    char *ep;
+
+    if (*str == '$')
+	*val = strtoul(str + 1, &ep, 16);
+    else
+	*val = strtoul(str, &ep, 0);
+
+    return ((ep != str) && (*ep == '\0'));
+}
+
+
+static gsym_t *
+sym_find(const char *name)
+{
+    int i;
+
+    for (i = 0; i < ngsyms; i++) {
+	if (! strcmp(gsyms[i].name, name))
+		return &gsyms[i];
+    }
+
+    return NULL;
+}
+
+
+/* Add a symbol, either exported (file >= 0) or just referenced. */
+static int
+sym_add(const char *name, int file, int sect, uint32_t value)
+{
+    gsym_t *g = sym_find(name);
+
+    if (g == NULL) {
+	if (ngsyms == mgsyms)
+		gsyms = grow(gsyms, &mgsyms, sizeof(gsym_t));
+	g = &gsyms[ngsyms++];
+	g->name = save(name);
+	g->file = -1;
+    }
+
+    if (file >= 0) {
+	if (g->file >= 0)
+		err("symbol '%s' defined in %s and %s",
+			name, files[g->file].name, files[file].name);
+	else {
+		g->file = file;
+		g->sect = sect;
+		g->value = value;
+	}
+    }
+
+    return (int)(g - gsyms);
+}
+
+
+static osect_t *
+out_find(const char *name)
+{
+    int i;
+
+    for (i = 0; i < nosects; i++) {
+	if (! strcmp(osects[i].name, name))
+		return &osects[i];
+    }
+
+    if (nosects == mosects)
+	osects = grow(osects, &mosects, sizeof(osect_t));
+    memset(&osects[nosects], 0x00, sizeof(osect_t));
+    osects[nosects].name = save(name);
+
+    return &osects[nosects++];
+}
+
+
+/* Read the linker script. */
+static int
+read_script(const char *fn)
+{
+    char line[256], cmd[32], name[128], arg[32];
+    osect_t *o;
+    uint32_t val;
+    int lnr = 0, n;
+    FILE *fp;
+
+    if ((fp = fopen(fn, "r")) == NULL) {
+	err("cannot open script %s", fn);
+	return 0;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+	lnr++;
+	if (strchr(line, '#') != NULL)
+		*strchr(line, '#') = '\0';
+
+	n = sscanf(line, "%31s %127s %31s", cmd, name, arg);
+	if (n <= 0)
+		continue;
+
+	if (!strcmp(cmd, "section") && (n == 3)) {
+		o = out_find(name);
+		if (strcmp(arg, "*")) {
+			if (! number(arg, &val)) {
+				err("%s(%i): bad address '%s'", fn, lnr, arg);
+				continue;
+			}
+			o->addr = val;
+			o->fixed = 1;
+		}
+	} else if (!strcmp(cmd, "fill") && (n == 2)) {
+		if (!number(name, &val) || (val > 0xff))
+			err("%s(%i): bad fill value '%s'", fn, lnr, name);
+		fill = (uint8_t)val;
+	} else
+		err("%s(%i): syntax error", fn, lnr);
+    }
+
+    (void)fclose(fp);
+
+    return (errors == 0);
+}
+
+
+/* Read one object file. */
+static int
+read_obj(int fnr)
+{
+    char line[256], name[128], kind, type;
+    uint32_t size, align, sect, off, addend, fill_at = 0;
+    ifile_t *f = &files[fnr];
+    isect_t *s = NULL;
+    int lnr = 1, done = 0, ver, target;
+    unsigned int b;
+    irel_t *r;
+    char *p;
+    FILE *fp;
+
+    if ((fp = fopen(f->name, "r")) == NULL) {
+	err("cannot open %s", f->name);
+	return 0;
+    }
+
+    if ((fgets(line, sizeof(line), fp) == NULL) ||
+	(sscanf(line, "%127s %i", name, &ver) != 2) ||
+	strcmp(name, OBJ_MAGIC) || (ver != OBJ_VERSION)) {
+	err("%s is not an object file", f->name);
+	(void)fclose(fp);
+	return 0;
+    }
+
+    f->first = nisects;
+    while (!done && (fgets(line, sizeof(line), fp) != NULL)) {
+	lnr++;
+	switch (line[0]) {
+		case 'S':	// a section
+			if ((sscanf(line + 1, "%127s %x %x", name, &size, &align) != 3) ||
+			    (align == 0) || (size > IMAGE_MAX))
+				goto bad;
+			if (nisects == misects)
+				isects = grow(isects, &misects, sizeof(isect_t));
+			s = &isects[nisects++];
+			memset(s, 0x00, sizeof(isect_t));
+			s->name = save(name);
+			s->file = fnr;
+			s->size = size;
+			s->align = align;
+			s->data = calloc(size + 1, 1);
+			if (s->data == NULL)
+				goto bad;
+			f->nsects++;
+			fill_at = 0;
+			(void)out_find(name);
+			break;
+
+		case 'D':	// data for that section
+			if (s == NULL)
+				goto bad;
+			for (p = line + 1; *p == ' '; p++)
+				;
+			while (sscanf(p, "%2x", &b) == 1) {
+				if (fill_at >= s->size)
+					goto bad;
+				s->data[fill_at++] = (uint8_t)b;
+				p += 2;
+			}
+			break;
+
+		case 'X':	// an extern
+			if (sscanf(line + 1, "%127s", name) != 1)
+				goto bad;
+			if (f->nexts == f->mexts)
+				f->exts = grow(f->exts, &f->mexts, sizeof(int));
+			f->exts[f->nexts++] = sym_add(name, -1, -1, 0);
+			break;
+
+		case 'G':	// an exported symbol
+			if ((sscanf(line + 1, "%127s %x %x", name, &sect, &off) != 3) ||
+			    (sect > (uint32_t)f->nsects))
+				goto bad;
+			(void)sym_add(name, fnr,
+				(sect > 0) ? (int)sect - 1 + f->first : -1, off);
+			break;
+
+		case 'R':	// a relocation
+			if ((sscanf(line + 1, "%x %x %c %c%x %x",
+				&sect, &off, &kind, &type, &target, &addend) != 6) ||
+			    (sect == 0) || (sect > (uint32_t)f->nsects) ||
+			    (strchr("BWVDLH", kind) == NULL) || (target < 1) ||
+			    ((type == 'S') && (target > f->nsects)) ||
+			    ((type == 'X') && (target > f->nexts)) ||
+			    ((type != 'S') && (type != 'X')))
+				goto bad;
+			size = (kind == OBJ_DWORD) ? 4 :
+			       ((kind == OBJ_WORD) || (kind == OBJ_WORDBE)) ? 2 : 1;
+			if ((off + size) > isects[f->first + sect - 1].size)
+				goto bad;
+			if (nirels == mirels)
+				irels = grow(irels, &mirels, sizeof(irel_t));
+			r = &irels[nirels++];
+			r->sect = f->first + sect - 1;
+			r->off = off;
+			r->kind = kind;
+			r->type = type;
+			r->target = target;
+			r->addend = addend;
+			break;
+
+		case 'E':	// the end
+			done = 1;
+			break;
+
+		default:
+			goto bad;
+	}
+    }
+    (void)fclose(fp);
+
+    if (! done) {
+	err("%s: unexpected end of file", f->name);
+	return 0;
+    }
+
+    return 1;
+
+bad:
+    err("%s(%i): bad record", f->name, lnr);
+    (void)fclose(fp);
+
+    return 0;
+}
+
+
+/* Decide where all the sections go. */
+static void
+layout(void)
+{
+    uint32_t at = 0, start;
+    osect_t *o, *q;
+    isect_t *s;
+    int i, k;
+
+    for (i = 0; i < nosects; i++) {
+	o = &osects[i];
+	if (o->fixed)
+		at = o->addr;
+	start = at;
+
+	for (k = 0; k < nisects; k++) {
+		s = &isects[k];
+		if (strcmp(s->name, o->name))
+			continue;
+
+		at = (at + s->align - 1) / s->align * s->align;
+		s->addr = at;
+		at += s->size;
+	}
+
+	o->addr = start;
+	o->size = at - start;
+    }
+
+    /* Sections may not overlap. */
+    for (i = 0; i < nosects; i++) {
+	o = &osects[i];
+	for (k = i + 1; k < nosects; k++) {
+		q = &osects[k];
+		if ((o->size > 0) && (q->size > 0) &&
+		    (o->addr < (q->addr + q->size)) && (q->addr < (o->addr + o->size)))
+			err("sections '%s' and '%s' overlap", o->name, q->name);
+	}
+    }
+}
+
+
+/* The address of a symbol. */
+static uint32_t
+sym_addr(const gsym_t *g)
+{
+    if (g->sect < 0)
+	return g->value;
+
+    return isects[g->sect].addr + g->value;
+}
+
+
+/* Fix up all the relocated fields. */
+static void
+relocate(void)
+{
+    const ifile_t *f;
+    const gsym_t *g;
+    irel_t *r;
+    uint8_t *p;
+    uint32_t val;
+    int i, k;
+
+    /* Make sure we have all the externs, but say so just once. */
+    for (i = 0; i < nfiles; i++) {
+	f = &files[i];
+	for (k = 0; k < f->nexts; k++) {
+		g = &gsyms[f->exts[k]];
+		if (g->file < 0)
+			err("undefined symbol '%s' (in %s)", g->name, f->name);
+	}
+    }
+    if (errors)
+	return;
+
+    for (i = 0; i < nirels; i++) {
+	r = &irels[i];
+	f = &files[isects[r->sect].file];
+	p = isects[r->sect].data + r->off;
+
+	if (r->type == 'S')
+		val = isects[f->first + r->target - 1].addr;
+	else
+		val = sym_addr(&gsyms[f->exts[r->target - 1]]);
+	val += r->addend;
+
+	switch (r->kind) {
+		case OBJ_BYTE:
+			if (val > 0xff)
+				err("%s: value $%X does not fit in a byte (%s+$%X)",
+					f->name, val, isects[r->sect].name, r->off);
+			p[0] = (uint8_t)val;
+			break;
+
+		case OBJ_LO:
+			p[0] = (uint8_t)val;
+			break;
+
+		case OBJ_HI:
+			p[0] = (uint8_t)(val >> 8);
+			break;
+
+		case OBJ_WORD:
+		case OBJ_WORDBE:
+			if (val > 0xffff)
+				err("%s: value $%X does not fit in a word (%s+$%X)",
+					f->name, val, isects[r->sect].name, r->off);
+			p[(r->kind == OBJ_WORD) ? 0 : 1] = (uint8_t)val;
+			p[(r->kind == OBJ_WORD) ? 1 : 0] = (uint8_t)(val >> 8);
+			break;
+
+		case OBJ_DWORD:
+			p[0] = (uint8_t)val;
+			p[1] = (uint8_t)(val >> 8);
+			p[2] = (uint8_t)(val >> 16);
+			p[3] = (uint8_t)(val >> 24);
+			break;
+	}
+    }
+}
+
+
+static int
+sym_cmp(const void *a, const void *b)
+{
+    uint32_t x = sym_addr(*(const gsym_t **)a);
+    uint32_t y = sym_addr(*(const gsym_t **)b);
+
+    if (x != y)
+	return (x < y) ? -1 : 1;
+
+    return strcmp((*(const gsym_t **)a)->name, (*(const gsym_t **)b)->name);
+}
+
+
+/* Write the map file. */
+static int
+write_map(const char *fn)
+{
+    const gsym_t **list;
+    const osect_t *o;
+    const isect_t *s;
+    int i, k, n = 0;
+    FILE *fp;
+
+    if ((fp = fopen(fn, "w")) == NULL)
+	return 0;
+
+    fprintf(fp, "%-24s %-8s %-8s %s\n", "Section", "Address", "Size", "File");
+    for (i = 0; i < nosects; i++) {
+	o = &osects[i];
+	fprintf(fp, "%-24s $%04X    $%04X\n", o->name, o->addr, o->size);
+	for (k = 0; k < nisects; k++) {
+		s = &isects[k];
+		if (! strcmp(s->name, o->name))
+			fprintf(fp, "%-24s $%04X    $%04X    %s\n", "",
+				s->addr, s->size, files[s->file].name);
+	}
+    }
+
+    /* The symbols, by address. */
+    list = malloc((ngsyms + 1) * sizeof(gsym_t *));
+    if (list != NULL) {
+	for (i = 0; i < ngsyms; i++) {
+		if (gsyms[i].file >= 0)
+			list[n++] = &gsyms[i];
+	}
+	qsort(list, n, sizeof(gsym_t *), sym_cmp);
+
+	fprintf(fp, "\n%-24s %-8s %s\n", "Symbol", "Address", "File");
+	for (i = 0; i < n; i++)
+		fprintf(fp, "%-24s $%04X    %s\n", list[i]->name,
+			sym_addr(list[i]), files[list[i]->file].name);
+	free(list);
+    }
+
+    i = (ferror(fp) == 0);
+    (void)fclose(fp);
+
+    return i;
+}
+
+
+/* Create the image, and write it. */
+static int
+write_image(const char *fn)
+{
+    uint32_t lo = 0xffffffff, hi = 0;
+    const osect_t *o;
+    const isect_t *s;
+    uint8_t *buff;
+    FILE *fp;
+    int i;
+
+    for (i = 0; i < nosects; i++) {
+	o = &osects[i];
+	if (o->size == 0)
+		continue;
+	if (o->addr < lo)
+		lo = o->addr;
+	if ((o->addr + o->size) > hi)
+		hi = o->addr + o->size;
+    }
+    if (hi == 0)
+	lo = 0;
+    if ((hi - lo) > IMAGE_MAX) {
+	err("image would be too big ($%X-$%X)", lo, hi - 1);
+	return 0;
+    }
+
+    buff = malloc((hi - lo) + 1);
+    if (buff == NULL) {
+	err("out of memory!");
+	return 0;
+    }
+    memset(buff, fill, hi - lo);
+    for (i = 0; i < nisects; i++) {
+	s = &isects[i];
+	memcpy(buff + (s->addr - lo), s->data, s->size);
+    }
+
+    if ((fp = fopen(fn, "wb")) == NULL) {
+	err("cannot create %s", fn);
+	free(buff);
+	return 0;
+    }
+    if (fwrite(buff, 1, hi - lo, fp) != (hi - lo))
+	err("error writing %s", fn);
+    (void)fclose(fp);
+    free(buff);
+
+    if (opt_v)
+	printf("Linked %i files into %s, %u bytes at $%04X-$%04X.\n",
+		nfiles, fn, hi - lo, lo, (hi > lo) ? hi - 1 : lo);
+
+    return (errors == 0);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    const char *out_name = "a.bin",
+	       *map_name = NULL,
+	       *script = NULL;
+    int c, i;
+
+    opterr = 0;
+    while ((c = getopt(argc, argv, "m:o:T:v")) != EOF) switch(c) {
+	case 'm':	// create a map file
+		map_name = optarg;
+		break;
+
+	case 'o':	// name of the image
+		out_name = optarg;
+		break;
+
+	case 'T':	// the linker script
+		script = optarg;
+		break;
+
+	case 'v':	// be more verbose
+		opt_v++;
+		break;
+
+	default:
+		usage(argv[0]);
+		/*NOTREACHED*/
+    }
+
+    if (optind == argc)
+	usage(argv[0]);
+
+    /* The script goes first, so it decides the order of the sections. */
+    if ((script != NULL) && !read_script(script))
+	return 1;
+
+    nfiles = argc - optind;
+    files = calloc(nfiles, sizeof(ifile_t));
+    if (files == NULL) {
+	fprintf(stderr, "vlink: out of memory!\n");
+	return 1;
+    }
+    for (i = 0; i < nfiles; i++) {
+	files[i].name = argv[optind + i];
+	(void)read_obj(i);
+    }
+    if (errors)
+	return 1;
+
+    layout();
+    if (! errors)
+	relocate();
+    if (errors)
+	return 1;
+
+    if ((map_name != NULL) && !write_map(map_name)) {
+	err("cannot create %s", map_name);
+	return 1;
+    }
+
+    return write_image(out_name) ? 0 : 1;
+}
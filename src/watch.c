@@ -0,0 +1,293 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Watch the source files for changes.
+ *
+ *		With the -w option, the assembler stays resident, and will
+ *		assemble the sources again whenever one of the files used
+ *		(the source files, all included files and binary blobs)
+ *		changes. On Linux, we use inotify(7) on the directories of
+ *		these files, so we also see editors that save a file by
+ *		renaming a new one over it. Elsewhere, we just poll their
+ *		modification times and sizes.
+ *
+ * Version:	@(#)watch.c	1.0.1	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __linux__
+# include <sys/inotify.h>
+# include <poll.h>
+# include <unistd.h>
+#elif defined(_WIN32)
+# include <windows.h>
+#else
+# include <unistd.h>
+#endif
+#include "global.h"
+#include "watch.h"
+
+
+#define WATCH_SETTLE	50		// wait (ms) for more events
+#define WATCH_POLL	500		// poll interval (ms)
+
+
+typedef struct wfile {
+    struct wfile *next;
+    char	*name;			// name as used by the assembler
+    const char	*base;			//  its last component
+    int		wd;			// watch on its directory
+    time_t	mtime;			// when it was last modified,
+    long	size;			//  and its size
+} wfile_t;
+
+
+static wfile_t	*watch_list;		// list of files watched
+static int	watch_num;
+static int	watch_fd = -1;		// inotify instance, if any
+
+
+/* Remember the current state of a file. */
+static void
+watch_stat(wfile_t *wf)
+{
+    struct stat st;
+
+    if (stat(wf->name, &st) == 0) {
+	wf->mtime = st.st_mtime;
+	wf->size = (long)st.st_size;
+    } else {
+	wf->mtime = 0;
+	wf->size = -1;
+    }
+}
+
+
+/* A file changed, so forget what we know about it. */
+static void
+watch_changed(wfile_t *wf)
+{
+    if (opt_v)
+	printf("File '%s' changed\n", wf->name);
+
+    file_uncache(wf->name);
+    watch_stat(wf);
+}
+
+
+/* Check all files for changes in time or size. */
+static int
+watch_check(void)
+{
+    wfile_t *wf;
+    time_t mtime;
+    long size;
+    int n = 0;
+
+    for (wf = watch_list; wf != NULL; wf = wf->next) {
+	mtime = wf->mtime;
+	size = wf->size;
+	watch_stat(wf);
+	if ((wf->mtime != mtime) || (wf->size != size)) {
+		watch_changed(wf);
+		n++;
+	}
+    }
+
+    return n;
+}
+
+
+#ifdef __linux__
+/* Handle all pending events, waiting at most ms milliseconds. */
+static int
+watch_events(int ms)
+{
+    char buf[4096];
+    const struct inotify_event *ev;
+    struct pollfd pfd;
+    wfile_t *wf;
+    ssize_t len;
+    char *p;
+    int n = 0;
+
+    pfd.fd = watch_fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, ms) <= 0)
+	return 0;
+
+    len = read(watch_fd, buf, sizeof(buf));
+    for (p = buf; p < (buf + len); p += sizeof(*ev) + ev->len) {
+	ev = (const struct inotify_event *)p;
+	if (ev->len == 0)
+		continue;
+
+	for (wf = watch_list; wf != NULL; wf = wf->next) {
+		if ((wf->wd == ev->wd) && !strcmp(wf->base, ev->name)) {
+			watch_changed(wf);
+			n++;
+		}
+	}
+    }
+
+    return n;
+}
+#endif
+
+
+/* Enable watching. */
+int
+watch_init(void)
+{
+#ifdef __linux__
+    watch_fd = inotify_init();
+#endif
+
+    return 1;
+}
+
+
+/* Add a file to the list of files to watch. */
+int
+watch_add(const char *fn)
+{
+    wfile_t *wf;
+#ifdef __linux__
+    char dir[1024];
+    int i;
+#endif
+
+    for (wf = watch_list; wf != NULL; wf = wf->next)
+	if (! strcmp(wf->name, fn))
+		return 1;
+
+    wf = malloc(sizeof(wfile_t));
+    if (wf == NULL)
+	return 0;
+    memset(wf, 0x00, sizeof(wfile_t));
+    wf->name = strdup(fn);
+    if (wf->name == NULL) {
+	free(wf);
+	return 0;
+    }
+    wf->base = strrchr(wf->name, '/');
+#ifdef _WIN32
+    if (wf->base == NULL)
+	wf->base = strrchr(wf->name, '\\');
+#endif
+    wf->base = (wf->base != NULL) ? (wf->base + 1) : wf->name;
+    wf->wd = -1;
+    watch_stat(wf);
+
+#ifdef __linux__
+    /* Watch its directory, this returns the same watch for all its files. */
+    if (watch_fd >= 0) {
+	i = (int)(wf->base - wf->name);
+	if (i == 0)
+		strcpy(dir, ".");
+	else if (i < (int)sizeof(dir)) {
+		strncpy(dir, wf->name, i);
+		dir[i] = '\0';
+	} else
+		dir[0] = '\0';
+	if (dir[0] != '\0')
+		wf->wd = inotify_add_watch(watch_fd, dir,
+					   IN_CLOSE_WRITE | IN_MOVED_TO | \
+					   IN_CREATE | IN_DELETE);
+    }
+#endif
+
+    wf->next = watch_list;
+    watch_list = wf;
+    watch_num++;
+
+    return 1;
+}
+
+
+/* Return the number of files being watched. */
+int
+watch_count(void)
+{
+    return watch_num;
+}
+
+
+/*
+ * Wait until one or more of the files changed, and return how many.
+ * We wait a little while for things to settle down, as editors and
+ * tools tend to write their files in several steps.
+ */
+int
+watch_wait(void)
+{
+    int n;
+
+    for (;;) {
+	n = watch_check();
+
+#ifdef __linux__
+	if (watch_fd >= 0) {
+		if (n == 0)
+			n = watch_events(-1);
+		if (n > 0) {
+			while (watch_events(WATCH_SETTLE) > 0)
+				n++;
+			return n + watch_check();
+		}
+		continue;
+	}
+#endif
+	if (n > 0)
+		return n;
+
+#ifdef _WIN32
+	Sleep(WATCH_POLL);
+#else
+	usleep(WATCH_POLL * 1000);
+#endif
+    }
+}
@@ -0,0 +1,424 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Handle the writing of output and listing data.
+ *
+ *		During Pass 2, the parser does not write its results to
+ *		the output and listing files itself. Instead, it queues
+ *		small records describing them (the address, the range of
+ *		bytes generated in the output buffer, the source line and
+ *		so on) and the writer turns those into Intel Hex, SRecord
+ *		or binary output, and formatted listing lines.
+ *
+ *		When built with USE_THREADS, this is done by a separate
+ *		thread, which reads the records from a single-producer,
+ *		single-consumer ring buffer, so the parser never has to
+ *		wait for formatting or file I/O. Otherwise, records are
+ *		handled right away, in the parser's own thread.
+ *
+ *		The workers of a parallel Pass 2 (see jobs.c) save their
+ *		records in a file instead, and these are queued here in
+ *		the right order later.
+ *
+ * Version:	@(#)writer.c	1.0.4	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef USE_THREADS
+# include <pthread.h>
+# include <sched.h>
+#endif
+#include "global.h"
+#include "error.h"
+#include "writer.h"
+#include "stats.h"
+
+
+#define WR_RING		(1024 * 1024)	// size of the ring buffer
+#define WR_WAKE		(64 * 1024)	// wake up writer after this much
+#define WR_MAXTEXT	(WR_RING / 16)	// max length of queued source text
+#define WR_CHUNK	4096		// queue generated code in chunks
+
+#define WR_ALIGN(x)	(((x) + 7) & ~7)
+
+
+static uint32_t	wr_osize;		// output size last queued
+static FILE	*wr_save;		// save the records here
+
+#ifdef USE_THREADS
+static uint8_t	*wr_ring;		// the ring buffer
+static uint32_t	wr_head,		// producer position
+		wr_tail,		// consumer position
+		wr_woke;		// producer position at last wakeup
+static int	wr_sleeping,		// writer is waiting for work
+		wr_done,		// no more records will follow
+		wr_active;		// writer thread is running
+static pthread_t wr_thread;
+static pthread_mutex_t wr_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wr_cond = PTHREAD_COND_INITIALIZER;
+#endif
+
+
+/* Process one record. */
+static void
+wr_run(const wrec_t *r, const char *s, const char *t)
+{
+#ifdef USE_STATS
+    uint64_t then = stats_clock();
+#endif
+
+    /* First, write out any code generated up to this point. */
+    output_do_data(r->osize);
+    STATS_LAP(PH_OUTPUT, then);
+
+    switch (r->type) {
+	case WR_LINE:
+		list_do_line(r, s, t);
+		break;
+
+	case WR_PAGE:
+		list_do_page(r, s, t);
+		break;
+
+	case WR_TITLE:
+	case WR_SUBTTL:
+		list_do_title(r, s);
+		break;
+
+	case WR_ORG:
+		output_do_org(r->addr);
+		break;
+
+	case WR_START:
+		output_do_start(r->addr);
+		break;
+
+	default:
+		break;
+    }
+    STATS_LAP(((r->type == WR_ORG) || (r->type == WR_START)) ? PH_OUTPUT : PH_LIST, then);
+}
+
+
+#ifdef USE_THREADS
+/* Wake up the writer thread if it is waiting for work. */
+static void
+wr_wakeup(void)
+{
+    wr_woke = wr_head;
+
+    if (__atomic_load_n(&wr_sleeping, __ATOMIC_SEQ_CST)) {
+	pthread_mutex_lock(&wr_mutex);
+	pthread_cond_signal(&wr_cond);
+	pthread_mutex_unlock(&wr_mutex);
+    }
+}
+
+
+/* Wait until there is room in the ring for size bytes. */
+static void
+wr_reserve(uint32_t size)
+{
+    while ((wr_head + size - __atomic_load_n(&wr_tail, __ATOMIC_ACQUIRE)) > WR_RING) {
+	/* Ring is full, make sure the writer is working on it. */
+	wr_wakeup();
+	sched_yield();
+    }
+}
+
+
+/* The writer thread. */
+static void *
+wr_thread_func(void *arg)
+{
+    uint32_t head, tail, off;
+    const wrec_t *r;
+    const char *s;
+
+    tail = 0;
+    for (;;) {
+	head = __atomic_load_n(&wr_head, __ATOMIC_ACQUIRE);
+
+	if (head == tail) {
+		/* Nothing to do, so wait for more. */
+		pthread_mutex_lock(&wr_mutex);
+		__atomic_store_n(&wr_sleeping, 1, __ATOMIC_SEQ_CST);
+		while ((__atomic_load_n(&wr_head, __ATOMIC_SEQ_CST) == tail) &&
+		       !__atomic_load_n(&wr_done, __ATOMIC_SEQ_CST))
+			pthread_cond_wait(&wr_cond, &wr_mutex);
+		__atomic_store_n(&wr_sleeping, 0, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&wr_mutex);
+
+		if (__atomic_load_n(&wr_head, __ATOMIC_ACQUIRE) == tail)
+			break;		// done, and nothing left
+		continue;
+	}
+
+	/* Handle all records we have. */
+	while (tail != head) {
+		off = tail % WR_RING;
+		r = (const wrec_t *)(wr_ring + off);
+
+		if (r->type == WR_PAD) {
+			/* Skip to the start of the ring. */
+			tail += WR_RING - off;
+		} else {
+			s = (const char *)(r + 1);
+			wr_run(r, s, s + r->slen + 1);
+			tail += r->size;
+		}
+
+		/* Give the space back to the producer. */
+		__atomic_store_n(&wr_tail, tail, __ATOMIC_RELEASE);
+	}
+    }
+
+    return NULL;
+}
+#endif
+
+
+/* Queue a record, with optional source text and directive text. */
+void
+writer_put(wrec_t *r, const char *s, size_t slen, const char *t)
+{
+#ifdef USE_THREADS
+    uint32_t off, size;
+    size_t tlen;
+    char *p;
+#endif
+
+    r->osize = wr_osize = output_size;
+
+    if (wr_save != NULL) {
+	r->slen = (uint32_t)slen;
+	r->tlen = (t != NULL) ? (uint32_t)strlen(t) : 0;
+	(void)fwrite(r, sizeof(wrec_t), 1, wr_save);
+	if (slen > 0)
+		(void)fwrite(s, 1, slen, wr_save);
+	if (t != NULL)
+		(void)fwrite(t, 1, r->tlen, wr_save);
+	return;
+    }
+
+#ifdef USE_THREADS
+    if (wr_active) {
+	tlen = (t != NULL) ? strlen(t) : 0;
+
+	/*
+	 * A record with very long texts does not go into the ring.
+	 * Once the writer has done all records before it, we run it
+	 * here, so the listing is the same as without the thread.
+	 */
+	if ((slen + tlen) > WR_MAXTEXT) {
+		wr_reserve(WR_RING);
+		goto run;
+	}
+
+	size = WR_ALIGN(sizeof(wrec_t) + slen + 1 + tlen + 1);
+	r->size = size;
+	r->slen = (uint32_t)slen;
+	r->tlen = (uint32_t)tlen;
+
+	/* Records never wrap around the end of the ring. */
+	off = wr_head % WR_RING;
+	if ((off + size) > WR_RING) {
+		wr_reserve(WR_RING - off);
+		((wrec_t *)(wr_ring + off))->type = WR_PAD;
+		__atomic_store_n(&wr_head, wr_head + WR_RING - off, __ATOMIC_SEQ_CST);
+		off = 0;
+	}
+	wr_reserve(size);
+
+	/* Copy the record and its texts into the ring. */
+	p = (char *)(wr_ring + off);
+	memcpy(p, r, sizeof(wrec_t));
+	p += sizeof(wrec_t);
+	if (slen > 0)
+		memcpy(p, s, slen);
+	p[slen] = '\0';
+	p += slen + 1;
+	if (tlen > 0)
+		memcpy(p, t, tlen);
+	p[tlen] = '\0';
+
+	/* Publish it. */
+	__atomic_store_n(&wr_head, wr_head + size, __ATOMIC_SEQ_CST);
+
+	/* Wake up the writer if enough has been queued. */
+	if ((wr_head - wr_woke) >= WR_WAKE)
+		wr_wakeup();
+
+	return;
+    }
+
+run:
+#endif
+    r->slen = (uint32_t)slen;
+    r->tlen = (t != NULL) ? (uint32_t)strlen(t) : 0;
+    wr_run(r, s, t);
+}
+
+
+/* Queue any generated code, if we have enough of it. */
+void
+writer_data(void)
+{
+    wrec_t r;
+
+    if ((output_size - wr_osize) < WR_CHUNK)
+	return;
+
+    memset(&r, 0x00, sizeof(r));
+    r.type = WR_DATA;
+    writer_put(&r, NULL, 0, NULL);
+}
+
+
+/* Save all records to a file from now on, or stop doing that. */
+void
+writer_save(FILE *fp)
+{
+    wr_save = fp;
+    wr_osize = output_size;
+}
+
+
+/* Queue the records saved in a file, up to an end marker. */
+int
+writer_load(FILE *fp)
+{
+    uint32_t size = output_size;
+    char *s = NULL, *t = NULL, *ptr;
+    size_t smax = 0, tmax = 0;
+    wrec_t r;
+    int ret = 0;
+
+    while (fread(&r, sizeof(r), 1, fp) == 1) {
+	if (r.type == WR_PAD) {
+		ret = 1;
+		break;
+	}
+
+	if (r.slen >= smax) {
+		ptr = realloc(s, r.slen + 1);
+		if (ptr == NULL)
+			break;
+		s = ptr;
+		smax = r.slen + 1;
+	}
+	if (r.tlen >= tmax) {
+		ptr = realloc(t, r.tlen + 1);
+		if (ptr == NULL)
+			break;
+		t = ptr;
+		tmax = r.tlen + 1;
+	}
+	if ((fread(s, 1, r.slen, fp) != r.slen) ||
+	    (fread(t, 1, r.tlen, fp) != r.tlen))
+		break;
+	s[r.slen] = '\0';
+	t[r.tlen] = '\0';
+
+	output_size = r.osize;
+	writer_put(&r, s, r.slen, (r.tlen > 0) ? t : NULL);
+    }
+    output_size = size;
+
+    if (s != NULL)
+	free(s);
+    if (t != NULL)
+	free(t);
+
+    return ret;
+}
+
+
+/* Start the writer for Pass 2. */
+void
+writer_start(void)
+{
+    wr_osize = 0;
+
+#ifdef USE_THREADS
+    wr_head = wr_tail = wr_woke = 0;
+    wr_sleeping = wr_done = 0;
+
+    if (wr_ring == NULL) {
+	wr_ring = malloc(WR_RING);
+	if (wr_ring == NULL)
+		return;			// just do it all ourselves
+    }
+
+    if (pthread_create(&wr_thread, NULL, wr_thread_func, NULL) != 0) {
+	if (opt_v)
+		printf("Could not create writer thread, not using it.\n");
+	return;
+    }
+
+    wr_active = 1;
+#endif
+}
+
+
+/* Wait for the writer to finish all queued records. */
+void
+writer_stop(void)
+{
+#ifdef USE_THREADS
+    if (! wr_active)
+	return;
+
+    __atomic_store_n(&wr_done, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&wr_mutex);
+    pthread_cond_signal(&wr_cond);
+    pthread_mutex_unlock(&wr_mutex);
+
+    (void)pthread_join(wr_thread, NULL);
+    wr_active = 0;
+
+    free(wr_ring);
+    wr_ring = NULL;
+#endif
+}
@@ -0,0 +1,103 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for the output and listing writer.
+ *
+ * Version:	@(#)writer.h	1.0.4	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef WRITER_H
+# define WRITER_H
+
+
+/*
+ * One record in the writer queue.
+ *
+ * Pass 2 describes its results with these records, and the writer
+ * turns them into output- and listing file data. A record can be
+ * followed by the (copied) source text and directive text.
+ */
+typedef struct wrec {
+    uint32_t	size;			// size of record in the queue
+    uint8_t	type;
+#define WR_PAD		0		//  skip to start of queue
+#define WR_DATA		1		//  write out generated code
+#define WR_LINE		2		//  one line of listing
+#define WR_PAGE		3		//  start a new listing page
+#define WR_TITLE	4		//  set the listing title
+#define WR_SUBTTL	5		//  set the listing subtitle
+#define WR_ORG		6		//  set a new load address
+#define WR_START	7		//  set the start address
+    char	state;			// state character for listing
+    uint32_t	tlen;			// length of directive text
+    uint32_t	slen;			// length of source text
+    uint32_t	addr;			// address (pc, origin or start)
+    uint32_t	oc;			// first code byte in output buffer
+    uint32_t	osize;			// output size when queued
+    int		line;			// source line number
+    int		plength,		// listing page settings
+		pwidth,
+		awidth,
+		nbytes;
+    int		cycles[2];		// cycles of the line (min, max)
+    uint32_t	running[2];		//  and counted so far
+    const char	*fname;			// current source file
+} wrec_t;
+
+
+extern void	writer_start(void);
+extern void	writer_stop(void);
+extern void	writer_put(wrec_t *, const char *, size_t, const char *);
+extern void	writer_data(void);
+extern void	writer_save(FILE *);
+extern int	writer_load(FILE *);
+
+extern void	output_do_data(uint32_t);
+extern void	output_do_org(uint32_t);
+extern void	output_do_start(uint32_t);
+
+extern void	list_capture(wrec_t *, int);
+extern void	list_do_title(const wrec_t *, const char *);
+extern void	list_do_page(const wrec_t *, const char *, const char *);
+extern void	list_do_line(const wrec_t *, const char *, const char *);
+
+
+#endif	/*WRITER_H*/
@@ -0,0 +1,351 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Build a cross-reference database of all symbols.
+ *
+ *		When enabled with the -x option, every use, definition
+ *		and assignment of a symbol during Pass 2 is recorded in
+ *		a chunked array. At the end, the references are sorted
+ *		by symbol name, and then by file and line, and written
+ *		to the listing (see list_xref) and to a binary file.
+ *
+ *		The binary file uses the layout from dbfile.c, with the
+ *		"VXRF" magic, and these sections:
+ *
+ *		  STRS	string table
+ *		  FILE	uint32_t name offset, per source file
+ *		  SYMS	name, value, first ref, #refs (uint32_t), kind
+ *			and type (uint8_t), 2 bytes padding; sorted by
+ *			name, so they can be found with a binary search
+ *		  REFS	symbol index, line, file (uint32_t), kind
+ *			(uint8_t), 3 bytes padding; sorted by symbol
+ *			and then by file and line
+ *		  LOCS	uint32_t index into REFS, sorted by file and line
+ *
+ * Version:	@(#)xref.c	1.0.3	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "error.h"
+#include "dbfile.h"
+#include "xref.h"
+
+
+#define XREF_CHUNK	4096		// references per chunk
+#define XREF_VERSION	2		// version of the file format
+
+
+typedef struct xchunk {
+    struct xchunk *next;
+    int		count;
+    xref_t	refs[XREF_CHUNK];
+} xchunk_t;
+
+
+int		xref_active;		// currently recording references
+
+static char	*xref_path;		// name of the binary file
+static xchunk_t	*xref_chunks,		// list of chunks
+		*xref_last;		// chunk being filled
+static xref_t	*xref_list;		// sorted list of references
+static int	xref_count;
+
+
+/* Compare two references by name, file and line. */
+static int
+xref_cmp(const void *a, const void *b)
+{
+    const xref_t *x = (const xref_t *)a;
+    const xref_t *y = (const xref_t *)b;
+    char tx[ID_LEN * 2], ty[ID_LEN * 2];
+    int i = 0;
+
+    /* Sort by the full names, so they can be searched for. */
+    if (x->sym != y->sym) {
+	i = strcmp(xref_name(x, tx), xref_name(y, ty));
+	if (i == 0)
+		i = (x->sym < y->sym) ? -1 : 1;
+    }
+    if (i == 0)
+	i = x->file - y->file;
+    if (i == 0)
+	i = x->line - y->line;
+    if (i == 0)
+	i = x->kind - y->kind;
+
+    return i;
+}
+
+
+/* Compare two references by file and line. */
+static int
+xref_loccmp(const void *a, const void *b)
+{
+    const xref_t *x = xref_list + *(const uint32_t *)a;
+    const xref_t *y = xref_list + *(const uint32_t *)b;
+
+    if (x->file != y->file)
+	return x->file - y->file;
+    if (x->line != y->line)
+	return (x->line < y->line) ? -1 : 1;
+
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+
+/* Enable the cross reference, and set the name of the binary file. */
+int
+xref_init(const char *fn)
+{
+    xref_path = strdup(fn);
+
+    return (xref_path != NULL);
+}
+
+
+/* Start recording references (Pass 2 only.) */
+void
+xref_start(void)
+{
+    if (xref_path != NULL)
+	xref_active = 1;
+}
+
+
+void
+xref_stop(void)
+{
+    xref_active = 0;
+}
+
+
+/* Record a reference to a symbol. */
+void
+xref_add(symbol_t *sym, symbol_t *parent, int kind)
+{
+    xchunk_t *xc;
+    xref_t *xr;
+
+    if (sym == NULL)
+	return;
+
+    /* The zero page allocator wants to know this. */
+    if (kind == XREF_READ)
+	sym->refs++;
+
+    if (! xref_active)
+	return;
+
+    if (xref_last == NULL || xref_last->count == XREF_CHUNK) {
+	xc = malloc(sizeof(xchunk_t));
+	if (xc == NULL)
+		error(ERR_MEM, "cross reference");
+	xc->next = NULL;
+	xc->count = 0;
+
+	if (xref_last != NULL)
+		xref_last->next = xc;
+	else
+		xref_chunks = xc;
+	xref_last = xc;
+    }
+
+    xr = &xref_last->refs[xref_last->count++];
+    xr->sym = sym;
+    xr->parent = parent;
+    xr->file = filenames_idx;
+    xr->line = line;
+    xr->kind = kind;
+}
+
+
+/* Return the (full) name of a referenced symbol. */
+const char *
+xref_name(const xref_t *xr, char *buff)
+{
+    if (xr->parent == NULL)
+	return xr->sym->name;
+
+    sprintf(buff, "%s%c%s", xr->parent->name, ALPHA_CHAR, xr->sym->name);
+
+    return buff;
+}
+
+
+/* Return all references, sorted, and without any duplicates. */
+const xref_t *
+xref_sorted(int *count)
+{
+    xchunk_t *xc;
+    int i, n;
+
+    if (xref_list == NULL) {
+	n = 0;
+	for (xc = xref_chunks; xc != NULL; xc = xc->next)
+		n += xc->count;
+
+	xref_list = malloc((n + 1) * sizeof(xref_t));
+	if (xref_list == NULL)
+		error(ERR_MEM, "cross reference");
+
+	n = 0;
+	for (xc = xref_chunks; xc != NULL; xc = xc->next) {
+		memcpy(&xref_list[n], xc->refs, xc->count * sizeof(xref_t));
+		n += xc->count;
+	}
+
+	qsort(xref_list, n, sizeof(xref_t), xref_cmp);
+
+	/* Remove duplicates, like from repeat blocks. */
+	xref_count = 0;
+	for (i = 0; i < n; i++) {
+		if (xref_count > 0 &&
+		    !xref_cmp(&xref_list[xref_count - 1], &xref_list[i]))
+			continue;
+		xref_list[xref_count++] = xref_list[i];
+	}
+    }
+
+    *count = xref_count;
+
+    return xref_list;
+}
+
+
+/* Write the binary cross reference file. */
+int
+xref_write(void)
+{
+    dbsect_t sect[5];
+    const xref_t *list;
+    uint8_t *sp, *rp, *p;
+    uint32_t *locs;
+    char temp[ID_LEN * 2];
+    int i, n, first, nsyms, nfiles, ret;
+
+    if (xref_path == NULL)
+	return 1;
+
+    list = xref_sorted(&n);
+
+    memset(sect, 0x00, sizeof(sect));
+    (void)db_alloc(&sect[0], "STRS", 0, 1);
+
+    /* The names of all source files. */
+    nfiles = filenames_len;
+    p = db_alloc(&sect[1], "FILE", nfiles, 4);
+    for (i = 0; i < nfiles; i++)
+	db_put32(p + (i * 4), db_str(&sect[0], filenames[i]));
+
+    /* Count the symbols. */
+    nsyms = 0;
+    for (i = 0; i < n; i++)
+	if (i == 0 || list[i].sym != list[i - 1].sym)
+		nsyms++;
+
+    sp = db_alloc(&sect[2], "SYMS", nsyms, 20) - 20;
+    rp = db_alloc(&sect[3], "REFS", n, 16);
+    nsyms = first = 0;
+    for (i = 0; i < n; i++, rp += 16) {
+	if (i == 0 || list[i].sym != list[i - 1].sym) {
+		/* New symbol. */
+		sp += 20;
+		db_put32(sp, db_str(&sect[0], xref_name(&list[i], temp)));
+		db_put32(sp + 4, list[i].sym->value.v);
+		db_put32(sp + 8, i);
+		sp[16] = sym_type(list[i].sym);
+		sp[17] = list[i].sym->value.t;
+		first = i;
+		nsyms++;
+	}
+	db_put32(sp + 12, i + 1 - first);
+
+	db_put32(rp, nsyms - 1);
+	db_put32(rp + 4, list[i].line);
+	db_put32(rp + 8, (uint32_t)list[i].file);
+	rp[12] = list[i].kind;
+    }
+
+    /* Index by location. */
+    locs = malloc((n + 1) * sizeof(uint32_t));
+    if (locs == NULL)
+	error(ERR_MEM, "cross reference");
+    for (i = 0; i < n; i++)
+	locs[i] = i;
+    qsort(locs, n, sizeof(uint32_t), xref_loccmp);
+    p = db_alloc(&sect[4], "LOCS", n, 4);
+    for (i = 0; i < n; i++)
+	db_put32(p + (i * 4), locs[i]);
+    free(locs);
+
+    ret = db_write(xref_path, "VXRF", XREF_VERSION, sect, 5);
+
+    db_free(sect, 5);
+
+    return ret;
+}
+
+
+/* Release all memory. */
+void
+xref_close(void)
+{
+    xchunk_t *xc;
+
+    while ((xc = xref_chunks) != NULL) {
+	xref_chunks = xc->next;
+	free(xc);
+    }
+    xref_last = NULL;
+
+    if (xref_list != NULL)
+	free(xref_list);
+    xref_list = NULL;
+    xref_count = 0;
+
+    if (xref_path != NULL)
+	free(xref_path);
+    xref_path = NULL;
+}
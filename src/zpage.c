@@ -0,0 +1,337 @@
+/*
+ * VASM		VARCem Multi-Target Macro Assembler.
+ *		A simple table-driven assembler for several 8-bit target
+ *		devices, like the 6502, 6800, 80x, Z80 et al series. The
+ *		code originated from Bernd Bckmann's "asm6502" project.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Allocate zero page variables.
+ *
+ *		The .zpsegment directive adds a range of memory to the
+ *		pool, and .zpvar takes a number of bytes from it, and
+ *		defines a symbol for it. This happens in Pass 1, so the
+ *		code that uses them gets the short (zero page) forms.
+ *		Segments outside the zero page can be given too, they
+ *		are used once the zero page ones are full.
+ *
+ *		Variables are placed in the order they are declared,
+ *		using the first segment that has room. If some of them
+ *		did not end up in the zero page, we count how often each
+ *		variable is referenced, and place them again with the
+ *		most used ones first. As that changes the code, another
+ *		round of Pass 1 is done (see trg_relax_round.)
+ *
+ * Version:	@(#)zpage.c	1.0.2	2026/10/18
+ *
+ * Author:	Fred N. van Kempen, <waltje@varcem.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "error.h"
+#include "target.h"
+#include "zpage.h"
+
+
+#define MAX_ZPSEG	16		// maximum number of segments
+
+
+static zpseg_t	zp_seg[MAX_ZPSEG];
+static int	zp_nseg;
+static zpvar_t	*zp_tab;
+static int	zp_nvar,
+		zp_size;
+static int	zp_sseq,		// directives seen in this pass
+		zp_vseq;
+static int	zp_planned;		// variables have their final place
+
+
+/* Take a number of bytes from the pools, zero page first. */
+static int
+zp_alloc(uint32_t size, uint32_t *addr)
+{
+    zpseg_t *seg;
+    int i, zp;
+
+    for (zp = 1; zp >= 0; zp--) {
+	for (i = 0; i < zp_nseg; i++) {
+		seg = &zp_seg[i];
+		if ((seg->start < 0x100) != zp)
+			continue;
+
+		if ((seg->next <= seg->end) &&
+		    ((seg->end - seg->next + 1) >= size)) {
+			*addr = seg->next;
+			seg->next += size;
+			return 1;
+		}
+	}
+    }
+
+    return 0;
+}
+
+
+/* Order variables by references, and then by declaration. */
+static int
+zp_cmp(const void *a, const void *b)
+{
+    const zpvar_t *x = &zp_tab[*(const int *)a];
+    const zpvar_t *y = &zp_tab[*(const int *)b];
+
+    if (x->refs != y->refs)
+	return (x->refs > y->refs) ? -1 : 1;
+
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+
+/* Start a pass. */
+void
+zp_start(int pass)
+{
+    int i;
+
+    zp_sseq = zp_vseq = 0;
+
+    if (pass != 1)
+	return;
+
+    /* Without a plan, we start all over. */
+    if (! zp_planned)
+	zp_nseg = zp_nvar = 0;
+
+    /* Count the references in this round. */
+    for (i = 0; i < zp_nvar; i++)
+	if (zp_tab[i].sym != NULL)
+		zp_tab[i].sym->refs = 0;
+}
+
+
+/* The .zpsegment directive, add memory to the pool. */
+void
+zp_segment(uint32_t start, uint32_t end, int pass)
+{
+    zpseg_t *seg;
+    int i, n;
+
+    if ((end < start) || (end > 0xffff))
+	error(ERR_RNG, NULL);
+
+    n = zp_sseq++;
+    if ((pass != 1) || (n < zp_nseg))
+	return;
+
+    if (n == MAX_ZPSEG)
+	error(ERR_MEM, "zero page segments");
+
+    for (i = 0; i < zp_nseg; i++) {
+	if ((start <= zp_seg[i].end) && (end >= zp_seg[i].start))
+		error(ERR_RNG, NULL);
+    }
+
+    seg = &zp_seg[n];
+    seg->start = seg->next = start;
+    seg->end = end;
+    zp_nseg = n + 1;
+}
+
+
+/* The .zpvar directive, allocate a variable and define it. */
+symbol_t *
+zp_var(const char *name, uint32_t size, int pass)
+{
+    zpvar_t *var;
+    value_t v = { 0 };
+    int n;
+
+    if ((size == 0) || (size > 0x10000))
+	error(ERR_RNG, NULL);
+
+    n = zp_vseq++;
+    if (pass == 1) {
+	if (zp_nseg == 0)
+		error(ERR_NOZPSEG, NULL);
+
+	if (n >= zp_size) {
+		var = realloc(zp_tab, (zp_size + 64) * sizeof(zpvar_t));
+		if (var == NULL)
+			error(ERR_MEM, "zero page variables");
+		zp_tab = var;
+		zp_size += 64;
+	}
+	var = &zp_tab[n];
+
+	/* Use the planned place, unless this is not the same variable. */
+	if (!zp_planned || (n >= zp_nvar) ||
+	    strcmp(var->name, name) || (var->size != size)) {
+		strncpy(var->name, name, ID_LEN - 1);
+		var->name[ID_LEN - 1] = '\0';
+		var->size = size;
+		var->refs = 0;
+		if (! zp_alloc(size, &var->addr))
+			error(ERR_ZPFULL, name);
+		if (n >= zp_nvar)
+			zp_nvar = n + 1;
+	}
+    } else {
+	if (n >= zp_nvar)
+		error(ERR_UNDEF, name);
+	var = &zp_tab[n];
+    }
+
+    /*
+     * Until we know how often they are used, variables that did not
+     * fit in the zero page are left undefined (but with the size of
+     * a zero page address), just like forward references.
+     */
+    v.v = var->addr;
+    v.t = NUM_TYPE(var->addr) | VALUE_DEFINED;
+    if (!zp_planned && ((var->addr + var->size) > 0x100)) {
+	v.v = 0;
+	v.t = TYPE_BYTE;
+    }
+    define_variable(var->name, v, 1);
+    var->sym = sym_lookup(var->name, NULL);
+
+    return var->sym;
+}
+
+
+/*
+ * Called after each round of Pass 1. If variables ended up outside
+ * of the zero page, place them again by how often they are used,
+ * and ask for another round if any of them moved.
+ */
+void
+zp_plan(void)
+{
+    zpseg_t save[MAX_ZPSEG];
+    uint32_t *addr;
+    int *order;
+    int i, moved = 0, spill = 0;
+
+    if (zp_nvar == 0)
+	return;
+
+    for (i = 0; i < zp_nvar; i++) {
+	zp_tab[i].refs = (zp_tab[i].sym != NULL) ? zp_tab[i].sym->refs : 0;
+	if ((zp_tab[i].addr + zp_tab[i].size) > 0x100)
+		spill++;
+    }
+
+    /* All of them fit, so keep them where they were declared. */
+    if (spill == 0) {
+	zp_planned = 1;
+	return;
+    }
+
+    order = malloc(zp_nvar * (sizeof(int) + sizeof(uint32_t)));
+    if (order == NULL)
+	error(ERR_MEM, "zero page variables");
+    addr = (uint32_t *)(order + zp_nvar);
+
+    for (i = 0; i < zp_nvar; i++)
+	order[i] = i;
+    qsort(order, zp_nvar, sizeof(int), zp_cmp);
+
+    memcpy(save, zp_seg, sizeof(save));
+    for (i = 0; i < zp_nseg; i++)
+	zp_seg[i].next = zp_seg[i].start;
+
+    for (i = 0; i < zp_nvar; i++) {
+	if (! zp_alloc(zp_tab[order[i]].size, &addr[order[i]]))
+		break;
+    }
+
+    if (i < zp_nvar) {
+	/* Does not fit in that order, keep what we have. */
+	memcpy(zp_seg, save, sizeof(save));
+    } else {
+	for (i = 0; i < zp_nvar; i++) {
+		if (zp_tab[i].addr != addr[i]) {
+			zp_tab[i].addr = addr[i];
+			moved++;
+		}
+	}
+    }
+    free(order);
+
+    zp_planned = 1;
+    if (moved > 0)
+	trg_relax_round();
+}
+
+
+/* Return the number of allocator directives seen in this pass. */
+int
+zp_count(void)
+{
+    return zp_sseq + zp_vseq;
+}
+
+
+/* Return the segments, for the listing. */
+const zpseg_t *
+zp_segs(int *n)
+{
+    *n = zp_nseg;
+
+    return zp_seg;
+}
+
+
+/* Return the variables, for the listing. */
+const zpvar_t *
+zp_vars(int *n)
+{
+    *n = zp_nvar;
+
+    return zp_tab;
+}
+
+
+void
+zp_close(void)
+{
+    if (zp_tab != NULL)
+	free(zp_tab);
+    zp_tab = NULL;
+    zp_nvar = zp_size = zp_nseg = 0;
+    zp_planned = 0;
+}
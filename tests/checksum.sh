@@ -0,0 +1,6 @@
+#
+# Checksums over code further on. Then again with SELF defined, for
+# a checksum that never settles.
+#
+$VASM -q -l $W/checksum.lst -o $W/checksum.bin checksum.asm || exit 1
+$VASM -q -DSELF -o $W/checksum-self.bin checksum.asm
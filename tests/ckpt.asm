@@ -0,0 +1,17 @@
+; Checkpoints (-k.) See ckpt.sh, which changes the code at the end.
+
+	.cpu	6502
+	.org	$1000
+
+start:	jmp	last		; a forward reference
+
+	.include "ckpt.inc"
+	.include "ckpt.inc"
+	.include "ckpt.inc"
+
+tail:	lda	#1
+	rts
+
+last:	rts
+
+	.end
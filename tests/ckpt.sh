@@ -0,0 +1,25 @@
+#
+# Checkpoints (-k.) After the first run, change the code after the
+# last include, which can start at the last checkpoint. Then insert
+# code there, which moves a label used before it, so the assembly
+# has to go back. Each time, the image should be the same as that
+# of a run without -k.
+#
+S=$W/ckpt-src
+mkdir -p $S
+cp ckpt.asm ckpt.inc $S
+cd $S
+
+run() {
+	echo "$1:"
+	$VASM -q -v -k ckpt.ck -o $W/ckpt.bin ckpt.asm || exit 1
+	$VASM -q -o $W/ckpt-full.bin ckpt.asm || exit 1
+	cmp -s $W/ckpt-full.bin $W/ckpt.bin || echo "the image differs from a full run"
+}
+
+run "first run"
+sed 's/lda	#1/lda	#2/' ckpt.asm >ckpt.tmp && mv ckpt.tmp ckpt.asm
+run "changed the code at the end"
+sed 's/^last:/	nop\nlast:/' ckpt.asm >ckpt.tmp && mv ckpt.tmp ckpt.asm
+run "moved a forward label"
+exit 0
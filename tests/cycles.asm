@@ -0,0 +1,29 @@
+; Cycle counts (-c) and .cycles budgets on the 6502.
+
+	.cpu	6502
+	.org	$0200
+
+; A delay loop that fits its budget.
+delay:	.cycles	20
+	ldx	#2
+@loop:	dex
+	bne	@loop
+	rts
+	.endcycles
+
+; Between a minimum and a maximum.
+	.cycles	4,10
+	lda	#0
+	sta	$10
+	.endcycles
+
+; Nested blocks: the inner one is also counted in the outer one.
+	.cycles	30
+	.cycles	8
+	lda	$1234
+	sta	$1235
+	.endcycles
+	jsr	delay
+	.endcycles
+
+	.end
@@ -0,0 +1,15 @@
+; The dependency file (-M) lists the source, the include files and
+; the blobs, each with an empty rule. See deps.sh.
+
+	.cpu	6502
+	.org	$1000
+
+start:	jsr	clear
+	rts
+
+	.include "xref.inc"
+
+buffer	=	$0200
+magic:	.blob	"deps.dat"
+
+	.end
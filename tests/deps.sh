@@ -0,0 +1,8 @@
+#
+# The dependency file (-M.) Its first rule names the output file,
+# which is in $W, so that is taken out.
+#
+$VASM -q -M $W/deps.tmp -l $W/deps.lst -o $W/deps.bin deps.asm
+rc=$?
+sed "s|$W/||" $W/deps.tmp >$W/deps.dep
+exit $rc
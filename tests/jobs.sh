@@ -0,0 +1,37 @@
+#
+# Pass 2 with several workers (-j.) The source made here is big enough
+# to be split up into parts, and has macros, repeat blocks, locals and
+# forward references in all of them. The image, listing and messages
+# should be the same as with -j 1.
+#
+S=$W/jobs-src.asm
+{
+	printf '\t.cpu\t6502\n\t.org\t$1000\n\n'
+	printf 'store\t.macro\taddr,val\n\tlda\t#val\n\tsta\taddr\n\t.endm\n\n'
+	i=0
+	while [ $i -lt 600 ]; do
+		printf 'f%i:\tldx\t#4\n' $i
+		printf '@loop:\tstore\t$0400+%i,%i\n' $((i % 256)) $((i % 256))
+		printf '\tdex\n\tbne\t@loop\n'
+		printf '\t.repeat\t2\n\tnop\n\t.endrep\n'
+		printf '\tjmp\tf%i\n' $((i + 1))
+		i=$((i + 1))
+	done
+	printf 'f%i:\trts\n\n\t.end\n' $i
+} >$S
+
+$VASM -q -j 1 -l $W/jobs.lst -o $W/jobs.bin $S >$W/jobs-1.out 2>&1
+echo "exit $?" >>$W/jobs-1.out
+$VASM -q -v -j 4 -l $W/jobs-4.lst -o $W/jobs-4.bin $S >$W/jobs-4.out 2>&1
+echo "exit $?" >>$W/jobs-4.out
+grep 'Pass 2 in\|normal way' $W/jobs-4.out
+grep -v '^Pass\|^Setting' $W/jobs-4.out >$W/jobs-4.tmp
+for f in jobs jobs-4; do
+	grep -v '^VARCem VASM ' $W/$f.lst >$W/$f.tmp.lst
+	mv $W/$f.tmp.lst $W/$f.lst
+done
+cmp -s $W/jobs.bin $W/jobs-4.bin || echo "the image differs with -j 4"
+cmp -s $W/jobs.lst $W/jobs-4.lst || echo "the listing differs with -j 4"
+cmp -s $W/jobs-1.out $W/jobs-4.tmp || echo "the messages differ with -j 4"
+rm -f $W/jobs.lst
+exit 0
@@ -0,0 +1,20 @@
+; Relocatable object files (-r), linked by vlink. The main module
+; uses a routine and a message from link.inc. See link.sh.
+
+	.cpu	6502
+
+	.extern	print
+	.global	start, msg
+
+	.section text
+start:	lda	#<msg
+	ldx	#>msg
+	jsr	print
+	bne	done
+	nop
+done:	rts
+
+	.section data
+msg:	.byte	"HELLO", 0
+
+	.end
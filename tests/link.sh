@@ -0,0 +1,8 @@
+#
+# Relocatable object files (-r), and linking them with vlink, with a
+# script (-T) and a map (-m.) The second module is in link.inc, so it
+# is not taken as a test of its own.
+#
+$VASM -q -r -l $W/link.lst -o $W/link.obj link.asm || exit 1
+$VASM -q -r -o $W/link-2.obj link.inc || exit 1
+cd $W && $VLINK -T $TESTS/link.ld -m link.map -o link.bin link.obj link-2.obj
@@ -0,0 +1,17 @@
+#
+# Source lines too long to be queued for the writer, which should be
+# listed in full, also with -j 4.
+#
+awk 'BEGIN {
+	s = "cccccccc"
+	for (i = 0; i < 14; i++)
+		s = s s
+	print "\t.cpu\t6502\n\t.org\t$1000"
+	print "\tnop\t; " s
+	print "; " s
+	print "\trts\n\t.end"
+}' >$W/longline-x.asm
+$VASM -q -l $W/longline-1.lst -o $W/longline.bin $W/longline-x.asm || exit 1
+$VASM -q -j 4 -l $W/longline-4.lst -o $W/longline-4.bin $W/longline-x.asm || exit 1
+cmp -s $W/longline-1.lst $W/longline-4.lst || echo "listings differ"
+awk '{ print length($0) }' $W/longline-1.lst | sort -n | tail -2
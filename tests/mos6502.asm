@@ -0,0 +1,218 @@
+; All instructions and addressing modes of the 6502.
+;
+; Zero page operands are $0F, absolute ones $1F0F, and branches
+; go to themselves.
+
+	.cpu	6502
+	.org	$1000
+
+	adc	#$0F
+	adc	$0F
+	adc	$0F,x
+	adc	$1F0F
+	adc	$1F0F,x
+	adc	$1F0F,y
+	adc	($0F,x)
+	adc	($0F),y
+
+	and	#$0F
+	and	$0F
+	and	$0F,x
+	and	$1F0F
+	and	$1F0F,x
+	and	$1F0F,y
+	and	($0F,x)
+	and	($0F),y
+
+	asl	a
+	asl	$0F
+	asl	$0F,x
+	asl	$1F0F
+	asl	$1F0F,x
+
+	bcc	*
+
+	bcs	*
+
+	beq	*
+
+	bit	$0F
+	bit	$1F0F
+
+	bmi	*
+
+	bne	*
+
+	bpl	*
+
+	brk
+
+	bvc	*
+
+	bvs	*
+
+	clc
+
+	cld
+
+	cli
+
+	clv
+
+	cmp	#$0F
+	cmp	$0F
+	cmp	$0F,x
+	cmp	$1F0F
+	cmp	$1F0F,x
+	cmp	$1F0F,y
+	cmp	($0F,x)
+	cmp	($0F),y
+
+	cpx	#$0F
+	cpx	$0F
+	cpx	$1F0F
+
+	cpy	#$0F
+	cpy	$0F
+	cpy	$1F0F
+
+	dec	$0F
+	dec	$0F,x
+	dec	$1F0F
+	dec	$1F0F,x
+
+	dex
+
+	dey
+
+	eor	#$0F
+	eor	$0F
+	eor	$0F,x
+	eor	$1F0F
+	eor	$1F0F,x
+	eor	$1F0F,y
+	eor	($0F,x)
+	eor	($0F),y
+
+	inc	$0F
+	inc	$0F,x
+	inc	$1F0F
+	inc	$1F0F,x
+
+	inx
+
+	iny
+
+	jmp	$1F0F
+	jmp	($1F0F)
+
+	jsr	$1F0F
+
+	lda	#$0F
+	lda	$0F
+	lda	$0F,x
+	lda	$1F0F
+	lda	$1F0F,x
+
+	eor	$1F0F,y
+
+	lda	($0F,x)
+	lda	($0F),y
+
+	ldx	#$0F
+	ldx	$0F
+	ldx	$0F,y
+	ldx	$1F0F
+	ldx	$1F0F,y
+
+	ldy	#$0F
+	ldy	$0F
+	ldy	$0F,x
+	ldy	$1F0F
+	ldy	$1F0F,x
+
+	lsr	a
+	lsr	$0F
+	lsr	$0F,x
+	lsr	$1F0F
+	lsr	$1F0F,x
+
+	nop
+
+	ora	#$0F
+	ora	$0F
+	ora	$0F,x
+	ora	$1F0F
+	ora	$1F0F,x
+	ora	$1F0F,y
+	ora	($0F,x)
+	ora	($0F),y
+
+	pha
+
+	php
+
+	pla
+
+	plp
+
+	rol	a
+	rol	$0F
+	rol	$0F,x
+	rol	$1F0F
+	rol	$1F0F,x
+
+	ror	a
+	ror	$0F
+	ror	$0F,x
+	ror	$1F0F
+	ror	$1F0F,x
+
+	rti
+
+	rts
+
+	sbc	#$0F
+	sbc	$0F
+	sbc	$0F,x
+	sbc	$1F0F
+	sbc	$1F0F,x
+	sbc	$1F0F,y
+	sbc	($0F,x)
+	sbc	($0F),y
+
+	sec
+
+	sed
+
+	sei
+
+	sta	$0F
+	sta	$0F,x
+	sta	$1F0F
+	sta	$1F0F,x
+	sta	$1F0F,y
+	sta	($0F,x)
+	sta	($0F),y
+
+	stx	$0F
+	stx	$0F,y
+	stx	$1F0F
+
+	sty	$0F
+	sty	$0F,x
+	sty	$1F0F
+
+	tax
+
+	tay
+
+	tsx
+
+	txa
+
+	txs
+
+	tya
+
+	.end
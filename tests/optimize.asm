@@ -0,0 +1,27 @@
+; The peephole optimizer (-O) on the 65C02. Labels are barriers.
+
+	.cpu	65c02
+	.org	$0800
+
+start:	jsr	sub		; JSR+RTS becomes JMP
+	rts
+
+sub:	clc
+	clc			; the second CLC goes
+	adc	#1
+	sec
+	sec			; and so does the second SEC
+	sbc	#1
+	lda	#0		; LDA #0 and STA become STZ
+	sta	$0300
+	lda	var		; fits in the zero page (forward)
+	sta	var+1
+	rts
+
+keep:	lda	#0		; a label in between stops it
+here:	sta	$0301
+	rts
+
+var	=	$20
+
+	.end
@@ -0,0 +1,22 @@
+; Page crossing analysis (-a), and .pagesafe blocks.
+
+	.cpu	6502
+	.org	$10F8
+
+; This loop crosses into the next page, so it is moved there.
+start:	ldx	#8
+	.pagesafe
+@loop:	lda	table,x
+	sta	$0400,x
+	dex
+	bne	@loop
+	.endpagesafe
+
+; A branch to another page, marked with a P.
+	beq	start
+
+; A table that straddles a page boundary is reported.
+	.org	$11FE
+table:	.byte	1,2,3,4,5,6,7,8,9
+
+	.end
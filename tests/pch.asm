@@ -0,0 +1,13 @@
+; Precompiled include files (-H). See pch.sh.
+
+	.cpu	6502
+	.org	$0801
+
+	.include "pch.inc"
+
+start:	poke	border,0
+	poke	screen,1
+	poke	color,14
+	rts
+
+	.end
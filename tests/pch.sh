@@ -0,0 +1,8 @@
+#
+# Precompiled include files (-H.) The first run makes a snapshot of
+# pch.inc, and the second one uses it, for the same image.
+#
+mkdir -p $W/pch-cache
+$VASM -q -v -H $W/pch-cache -o $W/pch-1.bin pch.asm || exit 1
+$VASM -q -v -H $W/pch-cache -l $W/pch.lst -o $W/pch.bin pch.asm || exit 1
+cmp -s $W/pch-1.bin $W/pch.bin || echo "the image differs with the snapshot"
@@ -0,0 +1,51 @@
+; After an error in the expression of a .if or .repeat, its block is
+; skipped, and its .endif or .endrep still pairs up with it. So the
+; only errors are those in the expressions, and the one at the end.
+
+	.cpu	6502
+	.org	$1000
+
+start:	lda	#1
+
+; The expression has an error, so the block is skipped.
+	.if	(1 +
+	.byte	1 +		; not assembled, so no error here
+	.endif
+
+	.ifdef	+
+	.byte	1 +
+	.endif
+
+; The same for .repeat, also with a block nested in it.
+	.repeat	2 *
+	.byte	1 +
+	.if	1
+	.repeat	3
+	nop
+	.endrep
+	.else
+	.byte	1 +
+	.endif
+	.endrep
+
+; A block with no repeats is skipped as well.
+	.repeat	0
+	.byte	1 +
+	.endrep
+
+; In a block that is skipped, so is the .else part.
+	.if	0
+	.if	1
+	.byte	1 +
+	.else
+	.byte	1 +
+	.endif
+	.endif
+
+; And after all that, we are back on track, so this is an error.
+	.repeat	2
+	.byte	1 +
+	.endrep
+	rts
+
+	.end
@@ -0,0 +1,20 @@
+; Branch relaxation (-R): branches that can not reach their target
+; become the inverse branch around a JMP, the others stay short.
+
+	.cpu	65c02
+	.org	$0400
+
+start:	lda	$10
+	beq	near		; fits
+	bne	far		; too far, becomes beq *+5 / jmp far
+	bcc	far		; too far, becomes bcs *+5 / jmp far
+	bra	far		; too far, becomes jmp far
+near:	rts
+
+	.org	$0500
+
+far:	lda	$11
+	bpl	start		; too far back as well
+	rts
+
+	.end
@@ -0,0 +1,32 @@
+; Line numbers in the listing of .repeat blocks.
+;
+; Each iteration of a block should show the line numbers of the
+; source lines in it, and the lines after the block should carry
+; on from the .endrep, also for nested blocks.
+
+	.cpu	6502
+	.org	$1000
+
+clear	.macro	addr
+	lda	#0
+	sta	addr
+	.endm
+
+	.repeat	3
+	nop
+	.endrep
+	ldx	#3
+
+	.repeat	2
+	inx
+	.repeat	2
+	clear	$20
+	dey
+	.endrep
+	dex
+	.endrep
+	ldy	#0
+
+done:	jmp	done
+
+	.end
@@ -0,0 +1,269 @@
+#!/bin/bash
+#
+# VASM		VARCem Multi-Target Macro Assembler.
+#		A simple table-driven assembler for several 8-bit target
+#		devices, like the 6502, 6800, 80x, Signetics 2650 and the
+#		SC/MP processor series. The code is originally based on
+#		the "asm6502" project, but has been rewritten since.
+#
+#		Run the regression tests. Each NAME.asm in this directory
+#		is a test, if correct/ has any of its expected results:
+#
+#		  correct/NAME.bin	the output image
+#		  correct/NAME.lst	the listing (without page headers)
+#		  correct/NAME.err	the messages, and the exit status
+#		  correct/NAME.*	any other file the test writes
+#
+#		The options for a test (like "-p 65c02" for its target)
+#		can be put in NAME.opt, where a % stands for the name of
+#		its results without the extension, as in "-x %.xrf".
+#
+#		A test that needs more than one run, or the linker, is a
+#		NAME.sh script instead. It is run with VASM, VLINK and W
+#		set, and should leave its results in $W/NAME.*; what it
+#		prints are its messages.
+#
+#		Each test that creates an image is then done again with
+#		"-j 4", which should give the same image, listing and
+#		messages. The tests are run in parallel, and
+#		for each one we show the time it took, and the time of the
+#		previous run (from the test.times file), so that a slower
+#		assembler shows up right next to a wrong one.
+#
+#		For an image that differs, the first offset that differs
+#		is shown, with the bytes around it in both images.
+#
+#		Use -u to (re)create the expected results from the current
+#		assembler, after checking that they are right!
+#
+#		Usage: tests/run.sh [-u] [-j jobs] [vasm] [test ...]
+#
+# Version:	@(#)run.sh	1.0.2	2026/10/18
+#
+# Author:	Fred N. van Kempen, <waltje@varcem.com>
+#
+#		Copyright 2026 Fred N. van Kempen.
+#
+
+# Show the bytes around an offset in an image.
+context() {
+	local from=$(($2 / 16 * 16 - 16))
+
+	[ $from -lt 0 ] && from=0
+	echo "  $1:"
+	od -A x -t x1 -j $from -N 48 $3 | sed -e '$d' -e 's/^/    /'
+}
+
+# Compare a text result with the expected one.
+compare() {
+	if ! diff $2 $3 >$W/$NAME.diff 2>&1; then
+		echo "  $1 differs:"
+		head -10 $W/$NAME.diff | sed 's/^/    /'
+		FAILED=1
+	fi
+}
+
+# The page headers of a listing have the version and date in them.
+strip_list() {
+	if [ -f $1 ]; then
+		grep -v '^VARCem VASM ' $1 >$1.tmp
+		mv $1.tmp $1
+	fi
+}
+
+# The extension of an expected result, if it is an "other" one.
+other_ext() {
+	local x=${1#correct/$NAME.}
+
+	case $x in
+	bin|lst|err|out|log|diff|res|tmp|j.*)
+		;;
+	*)	echo $x
+		;;
+	esac
+}
+
+# Run one test, leaving its result in $W/NAME.res and the details
+# in $W/NAME.log.
+run_one() {
+	local opts= rc secs off exp got f x
+
+	NAME=$1
+	FAILED=0
+	[ -f $NAME.opt ] && opts=`sed "s|%|$W/$NAME|g" $NAME.opt`
+
+	TIMEFORMAT=%3R
+	if [ -f $NAME.sh ]; then
+		secs=`{ time NAME=$NAME bash $NAME.sh >$W/$NAME.out 2>&1 ; } 2>&1`
+	else
+		secs=`{ time $VASM -q $opts -l $W/$NAME.lst -o $W/$NAME.bin \
+			$NAME.asm >$W/$NAME.out 2>&1 ; } 2>&1`
+	fi
+	rc=$?
+	echo "exit $rc" >>$W/$NAME.out
+	strip_list $W/$NAME.lst
+
+	if [ -n "$UPDATE" ]; then
+		for x in bin lst; do
+			if [ -s $W/$NAME.$x ]; then
+				cp $W/$NAME.$x correct/$NAME.$x
+			else
+				rm -f correct/$NAME.$x
+			fi
+		done
+		cp $W/$NAME.out correct/$NAME.err
+		for f in correct/$NAME.*; do
+			x=`other_ext $f`
+			[ -n "$x" ] && [ ! -f $W/$NAME.$x ] && rm -f $f
+		done
+		for f in $W/$NAME.*; do
+			x=`other_ext correct/${f#$W/}`
+			[ -n "$x" ] && [ -f $f ] && cp $f correct/$NAME.$x
+		done
+		echo "$NAME UPDATED $secs" >$W/$NAME.res
+		return
+	fi
+
+	{
+		if [ -f correct/$NAME.bin ]; then
+			if [ ! -f $W/$NAME.bin ]; then
+				echo "  no image was created"
+				FAILED=1
+			elif ! cmp -s correct/$NAME.bin $W/$NAME.bin; then
+				exp=`wc -c <correct/$NAME.bin`
+				got=`wc -c <$W/$NAME.bin`
+				off=`cmp -l correct/$NAME.bin $W/$NAME.bin 2>/dev/null | awk 'NR == 1 { print $1 - 1 }'`
+				[ -z "$off" ] && off=$((exp < got ? exp : got))
+				printf "  image differs at offset 0x%04X (%i bytes, expected %i)\n" \
+					$off $got $exp
+				context expected $off correct/$NAME.bin
+				context got $off $W/$NAME.bin
+				FAILED=1
+			fi
+		fi
+		[ -f correct/$NAME.lst ] &&
+			compare listing correct/$NAME.lst $W/$NAME.lst
+		[ -f correct/$NAME.err ] &&
+			compare messages correct/$NAME.err $W/$NAME.out
+		for f in correct/$NAME.*; do
+			x=`other_ext $f`
+			[ -z "$x" ] && continue
+			if [ ! -f $W/$NAME.$x ]; then
+				echo "  no $NAME.$x was created"
+				FAILED=1
+			elif ! cmp -s $f $W/$NAME.$x; then
+				echo "  $NAME.$x differs"
+				FAILED=1
+			fi
+		done
+
+		# Splitting up Pass 2 should not change anything.
+		if [ ! -f $NAME.sh ] && [ -s $W/$NAME.bin ]; then
+			$VASM -q -j 4 $opts -l $W/$NAME.j.lst -o $W/$NAME.j.bin \
+				$NAME.asm >$W/$NAME.j.out 2>&1
+			echo "exit $?" >>$W/$NAME.j.out
+			strip_list $W/$NAME.j.lst
+			for x in bin lst out; do
+				[ -f $W/$NAME.$x ] || continue
+				if ! cmp -s $W/$NAME.$x $W/$NAME.j.$x; then
+					echo "  $NAME.$x differs with -j 4"
+					FAILED=1
+				fi
+			done
+		fi
+	} >$W/$NAME.log
+
+	if [ $FAILED = 1 ]; then
+		echo "$NAME FAIL $secs" >$W/$NAME.res
+	else
+		echo "$NAME ok $secs" >$W/$NAME.res
+	fi
+}
+
+# We get called again, for each of the tests.
+if [ "$1" = "--one" ]; then
+	cd $TESTS && run_one $2
+	exit 0
+fi
+
+UPDATE=
+JOBS=
+while getopts "j:u" opt; do
+	case $opt in
+	j)	JOBS=$OPTARG ;;
+	u)	UPDATE=y ;;
+	*)	echo "Usage: $0 [-u] [-j jobs] [vasm] [test ...]" >&2
+		exit 2
+		;;
+	esac
+done
+shift $((OPTIND - 1))
+
+VASM=${1:-src/vasm}
+[ $# -gt 0 ] && shift
+TESTS=`cd \`dirname $0\` && pwd`
+TIMES=${TIMES:-test.times}
+W=${TMPDIR:-/tmp}/vasm-test.$$
+
+case $VASM in
+/*)	;;
+*)	VASM=`pwd`/$VASM ;;
+esac
+if [ ! -x $VASM ]; then
+	echo "$0: no assembler at $VASM" >&2
+	exit 1
+fi
+VLINK=${VLINK:-`dirname $VASM`/vlink}
+
+if [ -z "$JOBS" ]; then
+	JOBS=`nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 2`
+fi
+
+# Find the tests, unless we were told which ones.
+NAMES="$*"
+if [ -z "$NAMES" ]; then
+	for f in $TESTS/*.asm $TESTS/*.sh; do
+		n=`basename $f`
+		n=${n%.*}
+		[ "$n" = "run" ] && continue
+		case " $NAMES " in
+		*" $n "*)	continue ;;
+		esac
+		if [ -n "$UPDATE" ] || [ -f $TESTS/correct/$n.bin ] ||
+		   [ -f $TESTS/correct/$n.lst ] || [ -f $TESTS/correct/$n.err ]; then
+			NAMES="$NAMES $n"
+		fi
+	done
+fi
+
+trap 'rm -rf $W' 0 1 2 15
+mkdir -p $W || exit 1
+
+export VASM VLINK TESTS W UPDATE
+printf "%s\n" $NAMES | xargs -P $JOBS -n 1 bash $0 --one
+
+printf "%-20s %-8s %8s %8s\n" Test Result Seconds Was
+fail=0
+for n in $NAMES; do
+	if [ ! -f $W/$n.res ]; then
+		printf "%-20s %-8s\n" $n MISSING
+		fail=1
+		continue
+	fi
+	read name res secs <$W/$n.res
+	was=`awk -v n=$n '$1 == n { print $2 }' $TIMES 2>/dev/null`
+	printf "%-20s %-8s %8s %8s\n" $n $res $secs "${was:--}"
+	[ -s $W/$n.log ] && cat $W/$n.log
+	[ "$res" = "FAIL" ] && fail=1
+	echo "$n $secs" >>$W/times
+done
+
+# Keep the times of the tests we did not run.
+if [ -f $W/times ]; then
+	[ -f $TIMES ] && awk 'NR == FNR { t[$1] = 1; next } !($1 in t)' \
+		$W/times $TIMES >$W/times.old
+	cat $W/times $W/times.old >$TIMES 2>/dev/null
+fi
+
+[ $fail = 0 ] && exit 0
+exit 1
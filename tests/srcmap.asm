@@ -0,0 +1,23 @@
+; The source line map (-g): code and data from the main file, an
+; include file and a macro.
+
+	.cpu	6502
+	.org	$3000
+
+shift	.macro	reg
+	asl	reg
+	asl	reg
+	.endm
+
+start:	lda	#1
+	shift	a
+	jsr	clear
+	rts
+
+	.include "xref.inc"
+
+data:	.byte	1, 2, 3
+	.word	start
+buffer	=	$0200
+
+	.end
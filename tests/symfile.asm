@@ -0,0 +1,22 @@
+; Exporting the symbol table (-y), with globals, locals, variables
+; and symbols from an include file.
+
+	.cpu	6502
+	.org	$2000
+
+size	=	16
+ptr	=	$FB
+
+start:	ldy	#size
+@loop:	lda	(ptr),y
+	sta	$0400,y
+	dey
+	bpl	@loop
+	jsr	clear
+	rts
+
+	.include "xref.inc"
+
+buffer	=	$0300
+
+	.end
@@ -0,0 +1,12 @@
+; Watch mode (-w.) See watch.sh, which changes watch.inc while the
+; assembler is running.
+
+	.cpu	6502
+	.org	$1000
+
+	.include "watch.inc"
+
+start:	lda	#value
+	rts
+
+	.end
@@ -0,0 +1,48 @@
+#
+# Watch mode (-w.) Start the assembler in the background, wait for
+# its image, then change the include file, and wait for the image to
+# be made again. It should be the same as that of a normal run.
+#
+S=$W/watch-src
+mkdir -p $S
+cp watch.asm watch.inc $S
+cd $S
+
+# Wait (up to 10 seconds) until a command succeeds.
+wait_for() {
+	local n=0
+
+	while ! eval "$1"; do
+		n=$((n + 1))
+		[ $n -ge 100 ] && return 1
+		sleep 0.1
+	done
+	return 0
+}
+
+$VASM -q -v -w -o $W/watch.bin watch.asm >$W/watch-log 2>&1 &
+pid=$!
+trap 'kill $pid 2>/dev/null' 0
+
+if ! wait_for "[ -s $W/watch.bin ]"; then
+	echo "no image was made"
+	exit 1
+fi
+cp $W/watch.bin $W/watch-1.bin
+
+# Make sure the change gets a new modification time.
+sleep 1
+sed 's/1$/2/' watch.inc >watch.tmp && mv watch.tmp watch.inc
+
+# The messages are written out once the new assembly is done.
+if ! wait_for "grep -q 'changed' $W/watch-log"; then
+	echo "the image was not made again"
+	exit 1
+fi
+kill $pid
+wait $pid 2>/dev/null
+grep 'changed' $W/watch-log
+
+$VASM -q -o $W/watch-2.bin watch.asm || exit 1
+cmp -s $W/watch-2.bin $W/watch.bin || echo "the image differs from a normal run"
+exit 0
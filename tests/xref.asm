@@ -0,0 +1,21 @@
+; The cross reference (-x), in the listing and the binary file.
+
+	.cpu	6502
+	.org	$1000
+
+count	=	3
+
+start:	ldx	#count
+@loop:	lda	table,x
+	sta	buffer,x
+	dex
+	bpl	@loop
+	jsr	clear
+	rts
+
+	.include "xref.inc"
+
+table:	.byte	1, 2, 3, 4
+buffer	=	$0200
+
+	.end
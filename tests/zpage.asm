@@ -0,0 +1,26 @@
+; The zero page allocator. The zero page segment is too small for all
+; variables, so the most used ones are placed there.
+
+	.cpu	6502
+
+	.zpsegment	$F0,$F3
+	.zpsegment	$0300,$03FF
+
+	.zpvar	ptr,2
+	.zpvar	count
+	.zpvar	flag
+	.zpvar	temp
+
+	.org	$1000
+
+start:	lda	#0
+	sta	temp
+	sta	temp+1
+	inc	temp
+	lda	(ptr),y
+	dec	count
+	lda	temp
+	sta	flag
+	rts
+
+	.end